@@ -0,0 +1,166 @@
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "builtins.hpp"
+#include "compiler.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+// Tablice: tworzenie, dopisywanie, wycinki i operacje na calej tablicy naraz.
+// Tablica z samymi liczbami trzyma je ciagiem bez znacznikow typu (ArrayObject::numbers), wiec array_sum,
+// array_min i array_max to proste petle po int64_t, ktore kompilator zamienia na instrukcje wektorowe.
+
+static ArrayObject* new_array(size_t reserve) {
+    ArrayObject* array = new ArrayObject();
+    array->numbers.reserve(reserve);
+    return array;
+}
+
+// Czy tablice z tych wartosci mozna trzymac jako same liczby
+static bool all_numbers(const Value* values, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        if (values[i].type() != TYPE_NUMBER) return false;
+    }
+    return true;
+}
+
+static void require_array(const Value& val, const char* message) {
+    if (val.type() != TYPE_ARRAY) throw runtime_error(message);
+}
+
+// Liczbowy argument w zakresie [0, limit] (indeksy wycinka, liczba elementow)
+static size_t require_index(const Value& val, size_t limit, const char* type_message, const char* range_message) {
+    if (val.type() != TYPE_NUMBER) throw runtime_error(type_message);
+    int_fast64_t index = val.as_number();
+    if (index < 0 || (uint64_t)index > limit) throw runtime_error(range_message);
+    return index;
+}
+
+Value builtin_array(const Value* args, size_t count) {
+    ArrayObject* array = new_array(0);
+    if (all_numbers(args, count)) {
+        array->numbers.resize(count);
+        for (size_t i = 0; i < count; ++i) array->numbers[i] = args[i].as_number();
+    } else {
+        array->packed = false;
+        array->values.assign(args, args + count);
+    }
+    return Value::array(array);
+}
+
+Value builtin_array_push(const Value& array, const Value& element) {
+    require_array(array, "Type error: The first argument to 'array_push' must be an array.");
+    Value result = array;
+    result.array_push(element);
+    return result;
+}
+
+// Wycinek [start, end) tablicy albo stringa
+Value builtin_array_slice(const Value& val, const Value& start_val, const Value& end_val) {
+    if (val.type() != TYPE_ARRAY && val.type() != TYPE_STRING) throw runtime_error("Type error: The first argument to 'array_slice' must be an array or string.");
+    size_t length = val.type() == TYPE_ARRAY ? val.array_length() : val.as_string().size();
+    size_t end = require_index(end_val, length, "Type error: The third argument to 'array_slice' must be a number (end index).", "Slice for 'array_slice' is out of bounds.");
+    size_t start = require_index(start_val, end, "Type error: The second argument to 'array_slice' must be a number (start index).", "Slice for 'array_slice' is out of bounds.");
+    if (val.type() == TYPE_STRING) return Value::string(val.as_string().substr(start, end - start));
+
+    const ArrayObject& source = val.as_array();
+    ArrayObject* slice = new_array(0);
+    slice->packed = source.packed;
+    if (source.packed) slice->numbers.assign(source.numbers.begin() + start, source.numbers.begin() + end);
+    else slice->values.assign(source.values.begin() + start, source.values.begin() + end);
+    return Value::array(slice);
+}
+
+// Liczby tablicy do petli po calosci. Blad, jesli jest w niej cos innego niz liczby,
+// a nullptr gdy liczby leza w values i trzeba je czytac po jednej.
+static const int64_t* packed_numbers(const Value& array, const char* message) {
+    require_array(array, message);
+    const ArrayObject& obj = array.as_array();
+    if (!obj.packed) {
+        // Tablica po unpack moze dalej miec same liczby (np. po 'set' stringa i z powrotem liczby)
+        for (size_t i = 0; i < array.array_length(); ++i) {
+            if (obj.values[i].type() != TYPE_NUMBER) throw runtime_error(message);
+        }
+        return nullptr;
+    }
+    return obj.numbers.data();
+}
+
+Value builtin_array_sum(const Value& array) {
+    const char* message = "Type error: 'array_sum' requires an array of numbers.";
+    const int64_t* numbers = packed_numbers(array, message);
+    size_t length = array.array_length();
+    // Bez znaku - przepelnienie zawija sie tak samo jak '+' na liczbach, bez niezdefiniowanego zachowania
+    uint64_t sum = 0;
+    if (numbers) {
+        for (size_t i = 0; i < length; ++i) sum += (uint64_t)numbers[i];
+    } else {
+        for (size_t i = 0; i < length; ++i) sum += (uint64_t)array.as_array().values[i].as_number();
+    }
+    return Value::number((int64_t)sum);
+}
+
+template <bool maximum>
+static Value array_extreme(const Value& array, const char* message, const char* empty_message) {
+    const int64_t* numbers = packed_numbers(array, message);
+    size_t length = array.array_length();
+    if (length == 0) throw runtime_error(empty_message);
+    if (numbers) return Value::number(maximum ? *max_element(numbers, numbers + length) : *min_element(numbers, numbers + length));
+    const Value* values = array.as_array().values.data();
+    int64_t best = values[0].as_number();
+    for (size_t i = 1; i < length; ++i) best = maximum ? max<int64_t>(best, values[i].as_number()) : min<int64_t>(best, values[i].as_number());
+    return Value::number(best);
+}
+
+Value builtin_array_min(const Value& array) {
+    return array_extreme<false>(array, "Type error: 'array_min' requires an array of numbers.", "'array_min' requires a non-empty array.");
+}
+
+Value builtin_array_max(const Value& array) {
+    return array_extreme<true>(array, "Type error: 'array_max' requires an array of numbers.", "'array_max' requires a non-empty array.");
+}
+
+Value builtin_array_fill(const Value& count_val, const Value& element) {
+    size_t count = require_index(count_val, UINT32_MAX, "Type error: The first argument to 'array_fill' must be a number (count).", "Array is too long.");
+    ArrayObject* array = new_array(0);
+    if (element.type() == TYPE_NUMBER) {
+        array->numbers.assign(count, element.as_number());
+    } else {
+        array->packed = false;
+        array->values.assign(count, element);
+    }
+    return Value::array(array);
+}
+
+Value builtin_array_map(const Value& function, const Value& array) {
+    if (function.type() != TYPE_FUNCTION) throw runtime_error("Type error: The first argument to 'array_map' must be a function.");
+    require_array(array, "Type error: The second argument to 'array_map' must be an array.");
+    const BraceFunction& func = function.as_function();
+    size_t expected = func.code ? func.code->parameter_count : func.parameters.size();
+    if (expected != 1) throw runtime_error("Incorrect number of arguments for function call. Expected " + to_string(expected) + ", but got 1.");
+    if (!call_function) throw runtime_error("Critical error: No engine to run functions from 'array_map'.");
+
+    // Wynik zbieramy jak w array_push: liczby ciagiem, dopoki funkcja nie zwroci czegos innego.
+    // Elementy bierzemy po indeksie - funkcja moze dopisac cos do tego samego bufora i go przeniesc.
+    size_t length = array.array_length();
+    Value result = Value::array(new_array(length));
+    for (size_t i = 0; i < length; ++i) {
+        Value element = array.array_at(i);
+        result.array_push(call_function(function, &element, 1));
+    }
+    return result;
+}
@@ -0,0 +1,146 @@
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "batch.hpp"
+#include "parser.hpp"
+#include "optimizer.hpp"
+#include "evaluator.hpp"
+#include "compiler.hpp"
+#include "vm.hpp"
+#include "cache.hpp"
+#include "io.hpp"
+#include "parallel.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+
+// Skrypt przygotowany do wykonania. Drzewo (dla --tree-walk) wskazuje w source, wiec obiekt sie nie przesuwa.
+struct Script {
+    string source;
+    Ast ast;
+    shared_ptr<Chunk> program;
+    string error;   // blad czytania albo kompilacji - wtedy skrypt od razu konczy sie z kodem 1
+};
+
+static unique_ptr<Script> prepare(const string& filename, const BatchOptions& options) {
+    auto script = make_unique<Script>();
+    if (filename.size() < 3 || filename.substr(filename.size() - 3) != ".bl") {
+        script->error = "Error: Only .bl files are allowed";
+        return script;
+    }
+    ifstream file(filename, ios::binary);
+    if (!file.is_open()) {
+        script->error = "Error: Could not open file '" + filename + "'";
+        return script;
+    }
+    file.seekg(0, ios::end);
+    script->source.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0, ios::beg);
+    file.read(script->source.data(), script->source.size());
+
+    try {
+        if (options.use_cache && !options.tree_walk) {
+            script->program = load_cache(cache_path(filename), script->source);
+            if (script->program) return script;
+        }
+        script->ast = parse(script->source);
+        optimize(script->ast);
+        if (!options.tree_walk) {
+            script->program = compile(script->ast);
+            if (options.use_cache) save_cache(cache_path(filename), script->source, *script->program);
+        }
+    } catch (const exception& e) {
+        script->error = string("Execution error: ") + e.what();
+    }
+    // Ten sam kod moze wykonywac kilka watkow naraz
+    if (script->program) freeze_code(*script->program);
+    return script;
+}
+
+// Wynik jednego uruchomienia skryptu
+struct BatchResult {
+    string output;
+    string error;
+    int exit_code = 0;
+    double milliseconds = 0;
+};
+
+static void execute(const Script& script, const BatchOptions& options, BatchResult& result) {
+    auto start = chrono::steady_clock::now();
+    if (!script.error.empty()) {
+        result.error = script.error;
+        result.exit_code = 1;
+        return;
+    }
+    string* outer_output = output_capture;
+    output_capture = &result.output;
+    {
+        // Wyjscie zadan z spawn, na ktore skrypt nie poczekal, tez nalezy do niego
+        SpawnScope scope;
+        try {
+            Environment global_env;  // osobne dla kazdego uruchomienia
+            if (options.tree_walk) {
+                const Node& program = script.ast[script.ast.root];
+                for (size_t i = 0; i < program.count; ++i) evaluate(script.ast, program.child(i), global_env);
+            } else {
+                run(*script.program, global_env);
+            }
+        } catch (const exception& e) {
+            result.error = string("Execution error: ") + e.what();
+            result.exit_code = 1;
+        }
+    }
+    output_capture = outer_output;
+    result.milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+int run_batch(const vector<string>& files, const BatchOptions& options) {
+    auto start = chrono::steady_clock::now();
+    // Kazdy plik raz, nawet jesli jest na liscie wiele razy
+    map<string, unique_ptr<Script>> scripts;
+    vector<const Script*> order;
+    order.reserve(files.size());
+    for (const string& filename : files) {
+        unique_ptr<Script>& script = scripts[filename];
+        if (!script) script = prepare(filename, options);
+        order.push_back(script.get());
+    }
+
+    vector<BatchResult> results(files.size());
+    size_t failed = 0;
+    parallel_ordered(
+        files.size(),
+        [&](size_t i) { execute(*order[i], options, results[i]); },
+        [&](size_t i) {
+            BatchResult& result = results[i];
+            output_write(result.output);
+            output_flush();
+            if (!result.error.empty()) cerr << result.error << '\n';
+            char line[64];
+            snprintf(line, sizeof(line), " exited with %d in %.3f ms", result.exit_code, result.milliseconds);
+            cerr << "Batch: " << files[i] << line << endl;
+            if (result.exit_code != 0) failed++;
+            result = BatchResult();  // wyjscie wypisane - nie trzymamy go do konca
+        });
+
+    double total = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    char line[96];
+    snprintf(line, sizeof(line), "%zu scripts, %zu failed, %.3f ms", files.size(), failed, total);
+    cerr << "Batch: " << line << endl;
+    return failed ? 1 : 0;
+}
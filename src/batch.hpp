@@ -0,0 +1,33 @@
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include "types.hpp"
+
+// --batch: wiele skryptow w jednym procesie.
+//
+// Kazdy plik jest czytany, parsowany i kompilowany raz (takze gdy wystepuje na liscie wiele razy, z .blc jak zwykle),
+// w glownym watku, zanim cokolwiek sie wykona - tablica symboli nie jest przygotowana na watki.
+// Potem skrypty sa zadaniami na puli z parallel.hpp: kazdy ma wlasne globalne srodowisko i wlasny bufor wyjscia.
+// Wyjscie skryptow trafia na standardowe wyjscie w kolejnosci z listy, a po kazdym skrypcie na standardowe wyjscie
+// bledow idzie jego blad (jak bez --batch) i linia z kodem wyjscia i czasem.
+
+struct BatchOptions {
+    bool tree_walk = false;
+    bool use_cache = true;
+};
+
+// Wykonuje skrypty i zwraca kod wyjscia procesu: 0 gdy wszystkie sie udaly, inaczej 1
+int run_batch(const vector<string>& files, const BatchOptions& options);
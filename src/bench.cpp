@@ -0,0 +1,462 @@
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "types.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "optimizer.hpp"
+#include "evaluator.hpp"
+#include "compiler.hpp"
+#include "vm.hpp"
+#include "builtins.hpp"
+#include "jit.hpp"
+#include "io.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <thread>
+
+// bracketLang_bench - pomiary wydajnosci interpretera, wyniki w JSON na standardowe wyjscie.
+//
+//  - "micro/...": lexer i parser na wygenerowanym kodzie (~1 MB) oraz krotkie petle sprawdzajace
+//    jedna rzecz naraz (zmienne, wywolania, lancuchy infiksowe, doklejanie stringow, get/set),
+//  - "macro/...": wszystkie programy .bl z katalogu bench/ (albo podanego w argumencie), od parsowania do konca,
+//  - "scaling/pmap/threads=N": bench/pmap.bl z pula 1, 2, 4... watkow (do liczby rdzeni) - jak pmap skaluje sie z watkami,
+//  - "hashmap/...": slownik (MapObject) i Environment z nazwami skladanymi w locie (intern + unordered_map),
+//    osobno przy wstawianiu i przy szukaniu kluczy.
+//
+// Kazdy pomiar jest powtarzany az zajmie co najmniej --min-time sekund (i nie mniej niz --repeat razy).
+// Podajemy sredni i najlepszy czas jednego powtorzenia, przepustowosc oraz liczbe alokacji na powtorzenie.
+// Wyjscie programow (print) jest wylaczone, a input dostaje pusty tekst.
+//
+// Uzycie: bracketLang_bench [--tree-walk] [--jit] [--filter tekst] [--repeat N] [--min-time sekundy] [katalog]
+//
+// --check-scan N zamiast pomiarow porownuje wersje SIMD lexera (scan.hpp) ze zwyklymi petlami na N losowych
+// kawalkach kodu i konczy sie kodem 1 przy pierwszej roznicy (uruchamia to ctest).
+
+// Liczniki alokacji - globalny operator new liczy kazde wywolanie (tez te z biblioteki standardowej)
+static atomic<uint64_t> allocation_count{0};
+static atomic<uint64_t> allocated_bytes{0};
+
+void* operator new(size_t size) {
+    allocation_count.fetch_add(1, memory_order_relaxed);
+    allocated_bytes.fetch_add(size, memory_order_relaxed);
+    if (void* ptr = malloc(size ? size : 1)) return ptr;
+    throw bad_alloc();
+}
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete[](void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { free(ptr); }
+
+// Strumien, ktory wszystko wyrzuca - zamiast cout na czas pomiarow
+struct NullBuffer : streambuf {
+    int overflow(int c) override { return c; }
+    streamsize xsputn(const char*, streamsize count) override { return count; }
+};
+
+struct Options {
+    bool tree_walk = false;
+    string filter;
+    int repeat = 3;
+    double min_time = 0.2;
+    string corpus = BRACKET_BENCH_DIR;
+};
+
+struct Result {
+    string name;
+    uint64_t iterations = 0;
+    double total_seconds = 0;
+    double best_seconds = 0;
+    double work = 0;            // ile jednostek pracy robi jedno powtorzenie (bajty kodu, obroty petli...)
+    string unit;                // i jakich
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+    string error;
+};
+
+// Mierzy 'body' tyle razy, ile kaza opcje
+static Result measure(const Options& options, const string& name, double work, const string& unit, const function<void()>& body) {
+    Result result;
+    result.name = name;
+    result.work = work;
+    result.unit = unit;
+    result.best_seconds = 1e300;
+    uint64_t start_allocations = allocation_count, start_bytes = allocated_bytes;
+    try {
+        while (result.iterations < (uint64_t)options.repeat || result.total_seconds < options.min_time) {
+            auto start = chrono::steady_clock::now();
+            body();
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            result.total_seconds += seconds;
+            result.best_seconds = min(result.best_seconds, seconds);
+            result.iterations++;
+        }
+    } catch (const exception& e) {
+        result.error = e.what();
+    }
+    if (result.iterations) {
+        result.allocations = (allocation_count - start_allocations) / result.iterations;
+        result.bytes = (allocated_bytes - start_bytes) / result.iterations;
+    }
+    return result;
+}
+
+// Wykonuje caly program wybranym silnikiem
+static void execute(const Options& options, const Ast& ast) {
+    Environment global_env;
+    if (options.tree_walk) {
+        const Node& program = ast[ast.root];
+        for (size_t i = 0; i < program.count; ++i) evaluate(ast, program.child(i), global_env);
+    } else {
+        shared_ptr<Chunk> program = compile(ast);
+        run(*program, global_env);
+    }
+}
+
+static Ast prepare(string_view source) {
+    Ast ast = parse(source);
+    optimize(ast);
+    return ast;
+}
+
+// Kod dla lexera i parsera: definicje funkcji, stringi, komentarze i wciecia jak w prawdziwych skryptach
+static string generated_source() {
+    string source;
+    for (int i = 0; source.size() < (1 << 20); ++i) {
+        string n = to_string(i);
+        source += "; funkcja pomocnicza numer " + n + "\n";
+        source += "(def helper_" + n + " (fun (left right) (do\n";
+        source += "    (def total (left + right * " + n + " - 1))\n";
+        source += "    (if (total > 100) (print \"duzo: \" total \"\\n\"))\n";
+        source += "    (get \"abcdefgh\" (total % 8)))))\n";
+    }
+    return source;
+}
+
+// Krotkie petle - kazda sprawdza glownie jedna operacje. {nazwa, cialo petli}; petla robi MICRO_LOOPS obrotow.
+static const uint32_t MICRO_LOOPS = 100000;
+static const pair<const char*, const char*> MICRO_PROGRAMS[] = {
+    {"var_lookup", "(def a 1) (def b 2) (def c 3) (def i 0)\n"
+                   "(loop (i < N) (do a b c a b c (def i (i + 1))))"},
+    {"call", "(def f (fun (x y) x)) (def i 0)\n"
+             "(loop (i < N) (do (f i 1) (def i (i + 1))))"},
+    {"infix_chain", "(def x 0) (def i 0)\n"
+                    "(loop (i < N) (do (def x (i + 1 - 2 * 3 / 4 % 5 + x)) (def i (i + 1))))"},
+    {"string_concat", "(def s \"\") (def i 0)\n"
+                      "(loop (i < N) (do (def s (s + \"ab\" + i)) (def i (i + 1))))"},
+    {"get_set", "(def s \"abcdefgh\") (def i 0)\n"
+                "(loop (i < N) (do (set s (i % 8) (get s ((i + 3) % 8))) (def i (i + 1))))"},
+    {"closure", "(def a 1) (def b 2) (def c 3) (def d 4) (def e 5) (def i 0)\n"
+                "(loop (i < N) (do ((fun (x) (x + a)) i) (def i (i + 1))))"},
+    {"map_put", "(def m (map)) (def i 0)\n"
+                "(loop (i < N) (do (def m (map_put m i i)) (def i (i + 1))))"},
+    {"map_get", "(def m (map)) (def i 0)\n"
+                "(loop (i < 1000) (do (def m (map_put m i i)) (def i (i + 1))))\n"
+                "(def i 0) (loop (i < N) (do (map_get m (i % 1000)) (def i (i + 1))))"},
+};
+
+static bool selected(const Options& options, const string& name) {
+    return options.filter.empty() || name.find(options.filter) != string::npos;
+}
+
+static vector<Result> run_micro(const Options& options) {
+    vector<Result> results;
+    string source = generated_source();
+    double megabytes = source.size() / 1e6;
+    if (selected(options, "micro/tokenize")) {
+        results.push_back(measure(options, "micro/tokenize", megabytes, "MB", [&] {
+            Lexer lexer(source);
+            Token token;
+            while (lexer.next(token)) {}
+        }));
+    }
+    if (selected(options, "micro/parse")) {
+        results.push_back(measure(options, "micro/parse", megabytes, "MB", [&] { parse(source); }));
+    }
+    for (const auto& [name, body] : MICRO_PROGRAMS) {
+        string full_name = string("micro/evaluate/") + name;
+        if (!selected(options, full_name)) continue;
+        string code = body;
+        code.replace(code.find("N"), 1, to_string(MICRO_LOOPS));
+        Ast ast = prepare(code);
+        results.push_back(measure(options, full_name, MICRO_LOOPS, "loops", [&] { execute(options, ast); }));
+    }
+    return results;
+}
+
+static vector<Result> run_macro(const Options& options) {
+    vector<Result> results;
+    vector<filesystem::path> files;
+    for (const auto& entry : filesystem::directory_iterator(options.corpus)) {
+        if (entry.path().extension() == ".bl") files.push_back(entry.path());
+    }
+    sort(files.begin(), files.end());
+    for (const auto& path : files) {
+        string name = "macro/" + path.stem().string();
+        if (!selected(options, name)) continue;
+        ifstream file(path, ios::binary);
+        string source((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        results.push_back(measure(options, name, 1, "runs", [&] { execute(options, prepare(source)); }));
+    }
+    return results;
+}
+
+// pmap.bl z rosnaca pula watkow. Pula startuje przy pierwszym zadaniu, wiec miedzy pomiarami ja zatrzymujemy.
+static vector<Result> run_scaling(const Options& options) {
+    vector<Result> results;
+    filesystem::path path = filesystem::path(options.corpus) / "pmap.bl";
+    if (options.tree_walk || !filesystem::exists(path)) return results;
+    ifstream file(path, ios::binary);
+    string source((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+    size_t cores = max(1u, thread::hardware_concurrency());
+    for (size_t threads = 1;; threads = min(threads * 2, cores)) {
+        string name = "scaling/pmap/threads=" + to_string(threads);
+        if (selected(options, name)) {
+            thread_count = threads;
+            results.push_back(measure(options, name, 1, "runs", [&] { execute(options, prepare(source)); }));
+            parallel_shutdown();
+        }
+        if (threads == cores) break;
+    }
+    thread_count = 0;
+    return results;
+}
+
+// Slownik z jezyka przeciw Environment, w ktorym skrypt trzymalby dane pod nazwami zmiennych skladanymi w locie.
+// Klucze to stringi "key0", "key1"... - kazdy wpis w Environment to najpierw intern nazwy.
+static const uint32_t HASHMAP_KEYS = 100000;
+static volatile uint64_t hashmap_found;  // zeby kompilator nie wyrzucil szukania
+
+static vector<Result> run_hashmap(const Options& options) {
+    vector<Result> results;
+    vector<string> names;
+    vector<Value> keys;
+    for (uint32_t i = 0; i < HASHMAP_KEYS; ++i) {
+        names.push_back("key" + to_string(i));
+        keys.push_back(Value::string(names.back()));
+    }
+    auto fill_map = [&] {
+        Value map = Value::map(new MapObject());
+        for (uint32_t i = 0; i < HASHMAP_KEYS; ++i) map.map_put(keys[i], Value::number(i));
+        return map;
+    };
+    auto fill_environment = [&] {
+        Environment env;
+        for (uint32_t i = 0; i < HASHMAP_KEYS; ++i) env[intern(names[i])] = Value::number(i);
+        return env;
+    };
+
+    if (selected(options, "hashmap/insert/map")) {
+        results.push_back(measure(options, "hashmap/insert/map", HASHMAP_KEYS, "keys", [&] { fill_map(); }));
+    }
+    if (selected(options, "hashmap/insert/environment")) {
+        results.push_back(measure(options, "hashmap/insert/environment", HASHMAP_KEYS, "keys", [&] { fill_environment(); }));
+    }
+    // Szukanie: co drugi klucz jest, co drugi nie (te same stringi z innym poczatkiem)
+    vector<string> probe_names;
+    vector<Value> probe_keys;
+    for (uint32_t i = 0; i < HASHMAP_KEYS; ++i) {
+        probe_names.push_back((i % 2 ? "key" : "nokey") + to_string(i));
+        probe_keys.push_back(Value::string(probe_names.back()));
+    }
+    if (selected(options, "hashmap/lookup/map")) {
+        Value map = fill_map();
+        results.push_back(measure(options, "hashmap/lookup/map", HASHMAP_KEYS, "lookups", [&] {
+            uint64_t found = 0;
+            for (const Value& key : probe_keys) found += map.as_map().find(key) != nullptr;
+            hashmap_found = found;
+        }));
+    }
+    if (selected(options, "hashmap/lookup/environment")) {
+        Environment env = fill_environment();
+        results.push_back(measure(options, "hashmap/lookup/environment", HASHMAP_KEYS, "lookups", [&] {
+            uint64_t found = 0;
+            for (const string& name : probe_names) found += env.count(intern(name));
+            hashmap_found = found;
+        }));
+    }
+    return results;
+}
+
+static string json_string(const string& text) {
+    string out = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') out += '\\', out += c;
+        else if (c == '\n') out += "\\n";
+        else if ((unsigned char)c < 0x20) out += ' ';
+        else out += c;
+    }
+    return out + "\"";
+}
+
+// Losowy kod dla --check-scan. Duzo dlugich ciagow jednej klasy znakow (wiecej niz 32 znaki, zeby przejsc
+// przez cale bloki SSE2/AVX2) i znaki, na ktorych wersje SIMD najlatwiej sie pomylic: bajty >= 0x80,
+// \v i \f, znaki tuz obok zakresow liter i cyfr.
+static string random_source(mt19937& random) {
+    static const string classes[] = {
+        " \t\n\v\f\r",
+        "abcxyzABCXYZ_09",
+        "0123456789",
+        "\"\\",
+        "()+-*/%=!<>;'",
+        "@[`{/:\x7f\x01",
+        "\x80\xa0\xc3\xff",
+    };
+    string source;
+    size_t length = random() % 300;
+    while (source.size() < length) {
+        const string& chars = classes[random() % size(classes)];
+        size_t run = random() % 4 == 0 ? random() % 80 : random() % 4 + 1;
+        for (size_t i = 0; i < run; ++i) source += chars[random() % chars.size()];
+    }
+    source.resize(length);
+    return source;
+}
+
+// Tokeny jako tekst do porownania: typ, miejsce w kodzie, symbol i zdekodowana wartosc (albo blad lexera)
+static string token_stream(string_view source, const ScanKernels& scan) {
+    string out;
+    try {
+        Lexer lexer(source, scan);
+        Token token;
+        while (lexer.next(token)) {
+            out += to_string(token.type) + ":" + to_string(token.text.data() - source.data()) + "+" + to_string(token.text.size());
+            out += ":" + to_string(token.symbol);
+            if (token.constant.type() == TYPE_STRING) out += ":" + string(token.constant.as_string());
+            out += "\n";
+        }
+    } catch (const exception& e) {
+        out += string("error: ") + e.what();
+    }
+    return out;
+}
+
+// Kazda wersja z available_scan_kernels() przeciw zwyklym petlom (ostatnia na liscie):
+// kazda funkcja z kazdej pozycji i caly strumien tokenow
+static int check_scan(size_t sources) {
+    size_t count;
+    const ScanKernels* const* kernels = available_scan_kernels(count);
+    const ScanKernels& scalar = *kernels[count - 1];
+    mt19937 random(12345);
+    for (size_t n = 0; n < sources; ++n) {
+        // Dokladnie tyle pamieci ile kodu - czytanie za koniec wylapie ASan
+        string text = random_source(random);
+        unique_ptr<char[]> owned(new char[text.size()]);
+        memcpy(owned.get(), text.data(), text.size());
+        string_view source(owned.get(), text.size());
+        string expected = token_stream(source, scalar);
+        for (size_t k = 0; k + 1 < count; ++k) {
+            const ScanKernels& scan = *kernels[k];
+            for (size_t pos = 0; pos <= source.size(); ++pos) {
+                const char* data = source.data();
+                size_t size = source.size();
+                const char* failed = nullptr;
+                if (scan.whitespace(data, pos, size) != scalar.whitespace(data, pos, size)) failed = "whitespace";
+                else if (scan.identifier(data, pos, size) != scalar.identifier(data, pos, size)) failed = "identifier";
+                else if (scan.digits(data, pos, size) != scalar.digits(data, pos, size)) failed = "digits";
+                else if (scan.string_body(data, pos, size) != scalar.string_body(data, pos, size)) failed = "string_body";
+                if (failed) {
+                    cerr << "scan check: " << scan.name << " " << failed << " differs from " << scalar.name
+                         << " at position " << pos << " of source #" << n << " (" << json_string(text) << ")" << endl;
+                    return 1;
+                }
+            }
+            if (token_stream(source, scan) != expected) {
+                cerr << "scan check: tokens from " << scan.name << " differ from " << scalar.name
+                     << " for source #" << n << " (" << json_string(text) << ")" << endl;
+                return 1;
+            }
+        }
+    }
+    cerr << "scan check: " << sources << " sources, kernels:";
+    for (size_t k = 0; k < count; ++k) cerr << " " << kernels[k]->name;
+    cerr << " - OK" << endl;
+    return 0;
+}
+
+static void print_json(const Options& options, const vector<Result>& results, ostream& out) {
+    out << "{\n  \"engine\": " << json_string(options.tree_walk ? "tree-walk" : "vm") << ",\n";
+    out << "  \"jit\": " << (jit_enabled ? "true" : "false") << ",\n";
+    out << "  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        double mean = r.iterations ? r.total_seconds / r.iterations : 0;
+        out << (i ? "," : "") << "\n    {\"name\": " << json_string(r.name)
+            << ", \"iterations\": " << r.iterations
+            << ", \"mean_ms\": " << mean * 1e3
+            << ", \"best_ms\": " << (r.iterations ? r.best_seconds * 1e3 : 0)
+            << ", \"throughput\": " << (r.iterations ? r.work / r.best_seconds : 0)
+            << ", \"throughput_unit\": " << json_string(r.unit + "/s")
+            << ", \"allocations\": " << r.allocations
+            << ", \"allocated_bytes\": " << r.bytes;
+        if (!r.error.empty()) out << ", \"error\": " << json_string(r.error);
+        out << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        string option = argv[i];
+        if (option == "--check-scan" && i + 1 < argc) return check_scan(strtoul(argv[i + 1], nullptr, 10));
+        else if (option == "--tree-walk") options.tree_walk = true;
+        else if (option == "--jit") jit_enabled = true;
+        else if (option == "--filter" && i + 1 < argc) options.filter = argv[++i];
+        else if (option == "--repeat" && i + 1 < argc) options.repeat = max(1, atoi(argv[++i]));
+        else if (option == "--min-time" && i + 1 < argc) options.min_time = atof(argv[++i]);
+        else if (option.rfind("--", 0) != 0) options.corpus = option;
+        else {
+            cerr << "Usage: " << argv[0] << " [--tree-walk] [--jit] [--filter text] [--repeat N] [--min-time seconds] [directory]" << endl
+                 << "       " << argv[0] << " --check-scan N" << endl;
+            return 1;
+        }
+    }
+
+    // Programy nie pisza na ekran i nie czekaja na klawiature
+    NullBuffer null_buffer;
+    streambuf* real_cout = cout.rdbuf(&null_buffer);
+    output_stream = &cout;
+    istringstream no_input;
+    cin.rdbuf(no_input.rdbuf());
+
+    // Evaluator drzewa wykonuje zadania pmap i spawn po kolei (jak bracketLang --tree-walk)
+    call_function = options.tree_walk ? evaluate_function : run_function;
+    if (options.tree_walk) thread_count = 1;
+
+    vector<Result> results = run_micro(options);
+    for (Result& r : run_macro(options)) results.push_back(std::move(r));
+    for (Result& r : run_scaling(options)) results.push_back(std::move(r));
+    for (Result& r : run_hashmap(options)) results.push_back(std::move(r));
+
+    parallel_shutdown();
+    output_flush();
+    cout.rdbuf(real_cout);
+    print_json(options, results, cout);
+    return 0;
+}
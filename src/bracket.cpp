@@ -0,0 +1,102 @@
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "bracket.hpp"
+#include "parser.hpp"
+#include "optimizer.hpp"
+#include "compiler.hpp"
+#include "vm.hpp"
+#include "io.hpp"
+#include "parallel.hpp"
+
+#include <mutex>
+
+BracketProgram bracket_compile(string_view source) {
+    // Tokeny w drzewie wskazuja w zrodlo, ale skompilowany kod juz nie - zrodlo nie musi zyc dluzej niz ta funkcja
+    Ast ast = parse(source);
+    optimize(ast);
+    // Program moze wykonywac naraz kilka kontekstow w roznych watkach - maszyna wirtualna nie bedzie go zmieniac
+    shared_ptr<Chunk> program = compile(ast);
+    freeze_code(*program);
+    return BracketProgram{std::move(program)};
+}
+
+BracketContext::BracketContext() {
+    // pmap i spawn w osadzonych programach wykonuje maszyna wirtualna. Raz, bo konteksty moga powstawac w kilku watkach naraz.
+    // Od teraz wspolne zasoby (wyjscie, pliki, komendy, uchwyty zadan) biora blokady, a wartosci dla zadan sa zamrazane.
+    static once_flag engine;
+    call_once(engine, [] {
+        if (!call_function) call_function = run_function;
+        host_threads = true;
+    });
+}
+
+void BracketContext::set(string_view name, Value value) {
+    globals[intern(name)] = std::move(value);
+}
+
+Value BracketContext::get(string_view name) const {
+    auto it = globals.find(intern(name));
+    if (it == globals.end() || it->second.type() == TYPE_UNDEFINED) return Value{};
+    return it->second;
+}
+
+bool BracketContext::has(string_view name) const {
+    auto it = globals.find(intern(name));
+    return it != globals.end() && it->second.type() != TYPE_UNDEFINED;
+}
+
+void BracketContext::define(string_view name, uint32_t arity, BracketNative body) {
+    // Cialo to jedna instrukcja OP_NATIVE, wiec wywolanie, limit --max-depth i bledy liczby argumentow
+    // dzialaja tak samo jak dla funkcji z programu
+    auto chunk = make_shared<Chunk>();
+    chunk->code = {OP_NATIVE, OP_RETURN};
+    chunk->parameter_count = arity;
+    chunk->name = string(name);
+    chunk->native = std::move(body);
+    BraceFunction* func = new BraceFunction();
+    func->code = std::move(chunk);
+    set(name, Value::function(func));
+}
+
+Value BracketContext::run(const BracketProgram& program, string* output) {
+    string* outer_output = output_capture;
+    if (output) output_capture = output;
+    try {
+        Value result;
+        {
+            SpawnScope scope;
+            result = ::run(*program.code, globals);
+        }
+        output_capture = outer_output;
+        output_flush();
+        return result;
+    } catch (...) {
+        output_capture = outer_output;
+        output_flush();
+        throw;
+    }
+}
+
+Value BracketContext::call(const Value& function, initializer_list<Value> args) {
+    return call(function, args.begin(), args.size());
+}
+
+Value BracketContext::call(const Value& function, const Value* args, size_t count) {
+    if (function.type() != TYPE_FUNCTION) throw runtime_error("Type error: BracketContext::call expects a function.");
+    Value result = run_function(function, args, count);
+    output_flush();
+    return result;
+}
@@ -0,0 +1,77 @@
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include "types.hpp"
+#include "builtins.hpp"
+
+#include <functional>
+#include <initializer_list>
+
+// libbracket - interpreter do osadzania w innych programach.
+//
+//     BracketProgram program = bracket_compile("(def wynik (x * 2))");   // raz: lexer, parser, kompilator
+//     BracketContext context;                                             // zmienne globalne jednego uruchomienia
+//     context.set("x", Value::number(21));
+//     context.define("log", 1, [](const Value* args, size_t) { cerr << value_to_string(args[0]); return Value{}; });
+//     context.run(program);                                               // ile razy trzeba, bez parsowania
+//     context.get("wynik").as_number();                                   // 42
+//
+// Program to tylko wskaznik na skompilowany kod, wiec kopiuje sie tanio i moze go uzywac wiele kontekstow.
+// Kontekst trzyma zmienne globalne: run zaczyna od tych, ktore sa w kontekscie, i zapisuje do niego te,
+// ktore program zdefiniowal, wiec kolejne uruchomienia w tym samym kontekscie je widza. Nowy kontekst to czyste konto.
+// Bledy (skladni i wykonania) sa zglaszane jako runtime_error z tym samym tekstem co w bracketLang.
+//
+// Watki: kompilowac i uzywac roznych kontekstow mozna w wielu watkach naraz (tablica symboli ma wlasna blokade,
+// a od pierwszego kontekstu wyjscie, pliki, komendy i uchwyty zadan zawsze biora swoje - parallel.hpp).
+// Program z bracket_compile jest zamrozony (freeze_code), wiec jeden program moze wykonywac naraz wiele kontekstow -
+// maszyna wirtualna nie podmienia w nim instrukcji na wersje dla typow, a --jit go nie kompiluje.
+// Jeden kontekst w danej chwili obsluguje jeden watek. print bez 'output' pisze do wspolnego wyjscia procesu
+// (kazde wywolanie w calosci, ale wywolania z roznych watkow sie przeplataja), wiec lepiej podawac 'output'.
+
+// Skompilowany program
+struct BracketProgram {
+    shared_ptr<const Chunk> code;
+};
+
+// Funkcja z C++ widziana w programie jak kazda inna. Dostaje tyle argumentow, ile podano w define.
+using BracketNative = function<Value(const Value* args, size_t count)>;
+
+// Kompiluje zrodlo do programu, ktory mozna potem wykonywac wiele razy
+BracketProgram bracket_compile(string_view source);
+
+class BracketContext {
+public:
+    BracketContext();
+
+    // Zmienne globalne. get zwraca nil, gdy zmiennej nie ma.
+    void set(string_view name, Value value);
+    Value get(string_view name) const;
+    bool has(string_view name) const;
+
+    // Funkcja z C++ pod nazwa 'name', przyjmujaca 'arity' argumentow
+    void define(string_view name, uint32_t arity, BracketNative body);
+
+    // Wykonuje program i zwraca wartosc ostatniego wyrazenia. Gdy 'output' jest podane, print pisze do niego
+    // zamiast na standardowe wyjscie.
+    Value run(const BracketProgram& program, string* output = nullptr);
+
+    // Wywoluje funkcje programu (np. zapisana wczesniej przez get) z podanymi argumentami
+    Value call(const Value& function, initializer_list<Value> args);
+    Value call(const Value& function, const Value* args, size_t count);
+
+private:
+    Environment globals;
+};
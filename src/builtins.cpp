@@ -0,0 +1,325 @@
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "builtins.hpp"
+#include "io.hpp"
+#include "parallel.hpp"
+
+#include <stdexcept>
+#include <iostream>
+#include <cstdio>
+#include <random>
+#include <charconv>
+
+size_t max_call_depth = DEFAULT_MAX_CALL_DEPTH;
+
+void throw_stack_overflow() {
+    throw runtime_error("Stack overflow: maximum call depth of " + to_string(max_call_depth) + " exceeded.");
+}
+
+// 0, pusty string, pusta tablica i pusty slownik to falsz, reszta (takze nil i funkcje) to prawda.
+bool is_truthy(const Value& val) {
+    if (val.type() == TYPE_NUMBER && val.as_number() == 0) return false;
+    if (val.type() == TYPE_STRING && val.as_string().empty()) return false;
+    if (val.type() == TYPE_ARRAY && val.array_length() == 0) return false;
+    if (val.type() == TYPE_MAP && val.as_map().count == 0) return false;
+    return true;
+}
+
+InfixOp infix_op_from_text(string_view text) {
+    if (text == "+") return INFIX_ADD;
+    if (text == "-") return INFIX_SUB;
+    if (text == "*") return INFIX_MUL;
+    if (text == "/") return INFIX_DIV;
+    if (text == "%") return INFIX_MOD;
+    if (text == "==") return INFIX_EQ;
+    if (text == "!=") return INFIX_NE;
+    if (text == ">") return INFIX_GT;
+    if (text == "<") return INFIX_LT;
+    if (text == ">=") return INFIX_GE;
+    if (text == "<=") return INFIX_LE;
+    return INFIX_UNKNOWN;
+}
+
+static void append_collection(string& out, const Value& val);
+
+// Pomocnicza funkcja do zamiany naszej wartosci Value na string
+string value_to_string(const Value& val) {
+    if (val.type() == TYPE_NUMBER) return to_string(val.as_number());
+    if (val.type() == TYPE_STRING) return string(val.as_string());
+    if (val.type() == TYPE_ARRAY || val.type() == TYPE_MAP) {
+        string out;
+        append_collection(out, val);
+        return out;
+    }
+    return "nil";
+}
+
+// Element tablicy albo slownika. Stringi w srodku sa w cudzyslowach, zeby bylo widac gdzie sie koncza.
+static void append_element(string& out, const Value& element) {
+    if (element.type() == TYPE_STRING) {
+        out += '"';
+        out += element.as_string();
+        out += '"';
+    } else if (element.type() == TYPE_ARRAY || element.type() == TYPE_MAP) {
+        append_collection(out, element);
+    } else {
+        out += value_to_string(element);
+    }
+}
+
+// Tablica jako tekst: [1, "a", nil], slownik: {"a": 1, 2: nil} (pary w kolejnosci dodawania)
+static void append_collection(string& out, const Value& val) {
+    if (val.type() == TYPE_MAP) {
+        out += '{';
+        bool first = true;
+        for (const MapObject::Entry& entry : val.as_map().entries) {
+            if (entry.key.type() == TYPE_UNDEFINED) continue;
+            if (!first) out += ", ";
+            first = false;
+            append_element(out, entry.key);
+            out += ": ";
+            append_element(out, entry.value);
+        }
+        out += '}';
+        return;
+    }
+    out += '[';
+    for (size_t i = 0; i < val.array_length(); ++i) {
+        if (i > 0) out += ", ";
+        append_element(out, val.array_at(i));
+    }
+    out += ']';
+}
+
+// Druga pomocnicza funkcja, wypisuje wartosc na standardowe wyjscie
+// Tekst wartosci tak jak zwraca go value_to_string, ale bez alokacji - liczba jest pisana do bufora
+static string_view value_text(const Value& val, char (&buffer)[24]) {
+    if (val.type() == TYPE_STRING) return val.as_string();
+    if (val.type() == TYPE_NUMBER) {
+        char* end = to_chars(buffer, buffer + sizeof(buffer), val.as_number()).ptr;
+        return string_view(buffer, end - buffer);
+    }
+    return "nil";
+}
+
+void print_value(const Value& val) {
+    if (val.type() == TYPE_ARRAY || val.type() == TYPE_MAP) {
+        output_write(value_to_string(val));
+        return;
+    }
+    char buffer[24];
+    output_write(value_text(val, buffer));
+}
+
+bool values_equal(const Value& left, const Value& right) {
+    // Najczestsze przypadki bez zamiany na tekst
+    if (left.type() == TYPE_NUMBER && right.type() == TYPE_NUMBER) return left.as_number() == right.as_number();
+    if (left.type() == TYPE_STRING && right.type() == TYPE_STRING) return left.as_string() == right.as_string();
+    if (left.type() == TYPE_ARRAY && right.type() == TYPE_ARRAY) {
+        if (left.array_length() != right.array_length()) return false;
+        const ArrayObject& left_array = left.as_array();
+        const ArrayObject& right_array = right.as_array();
+        if (left_array.packed && right_array.packed) {
+            return equal(left_array.numbers.begin(), left_array.numbers.begin() + left.array_length(), right_array.numbers.begin());
+        }
+        for (size_t i = 0; i < left.array_length(); ++i) {
+            if (!values_equal(left.array_at(i), right.array_at(i))) return false;
+        }
+        return true;
+    }
+    if (left.type() == TYPE_MAP && right.type() == TYPE_MAP) {
+        // Te same pary, niezaleznie od kolejnosci dodawania
+        const MapObject& left_map = left.as_map();
+        const MapObject& right_map = right.as_map();
+        if (left_map.count != right_map.count) return false;
+        for (const MapObject::Entry& entry : left_map.entries) {
+            if (entry.key.type() == TYPE_UNDEFINED) continue;
+            const Value* other = right_map.find(entry.key);
+            if (!other || !values_equal(entry.value, *other)) return false;
+        }
+        return true;
+    }
+    if (left.type() == TYPE_ARRAY || right.type() == TYPE_ARRAY || left.type() == TYPE_MAP || right.type() == TYPE_MAP) {
+        return value_to_string(left) == value_to_string(right);
+    }
+    // Rozne typy porownujemy po tekscie, np. (5 == "5") i (nil == "nil") sa prawda
+    char left_buffer[24], right_buffer[24];
+    return value_text(left, left_buffer) == value_text(right, right_buffer);
+}
+
+// Liczba z wartosci dla '+'. Nil zachowuje sie jak 0.
+static int_fast64_t add_operand(const Value& val) {
+    if (val.type() == TYPE_FUNCTION || val.type() == TYPE_ARRAY || val.type() == TYPE_MAP) throw runtime_error("Type error: Operator '+' requires numeric operands.");
+    return val.type() == TYPE_NUMBER ? val.as_number() : 0;
+}
+
+void apply_infix(InfixOp op, string_view op_text, Value& result, const Value& rhs) {
+    if (op == INFIX_ADD) {
+        // Doklejanie do stringa po lewej idzie w miejscu (patrz Value::append), bez kopiowania calosci
+        // Tablica i slownik doklejone do stringa ida jako tekst, tak jak je wypisuje print
+        if (result.type() == TYPE_STRING) {
+            char buffer[24];
+            if (rhs.type() == TYPE_ARRAY || rhs.type() == TYPE_MAP) result.append(value_to_string(rhs));
+            else result.append(value_text(rhs, buffer));
+        } else if (rhs.type() == TYPE_STRING) {
+            char buffer[24];
+            bool collection = result.type() == TYPE_ARRAY || result.type() == TYPE_MAP;
+            Value joined = collection ? Value::string(value_to_string(result)) : Value::string(value_text(result, buffer));
+            joined.append(rhs.as_string());
+            result = std::move(joined);
+        } else {
+            result = Value::number(add_operand(result) + add_operand(rhs));
+        }
+        return;
+    }
+
+    if (op == INFIX_EQ) {
+        result = Value::number(values_equal(result, rhs));
+        return;
+    }
+    if (op == INFIX_NE) {
+        result = Value::number(!values_equal(result, rhs));
+        return;
+    }
+
+    if (result.type() != TYPE_NUMBER || rhs.type() != TYPE_NUMBER) throw runtime_error("Type error: Operator '" + string(op_text) + "' requires numeric operands.");
+
+    int_fast64_t left_num = result.as_number();
+    int_fast64_t right_num = rhs.as_number();
+
+    switch (op) {
+        case INFIX_SUB: result = Value::number(left_num - right_num); break;
+        case INFIX_MUL: result = Value::number(left_num * right_num); break;
+        case INFIX_DIV: if (right_num == 0) throw runtime_error("Division by zero."); result = Value::number(left_num / right_num); break;
+        case INFIX_MOD: if (right_num == 0) throw runtime_error("Division by zero."); result = Value::number(left_num % right_num); break;
+        case INFIX_GT: result = Value::number(left_num > right_num); break;
+        case INFIX_LT: result = Value::number(left_num < right_num); break;
+        case INFIX_GE: result = Value::number(left_num >= right_num); break;
+        case INFIX_LE: result = Value::number(left_num <= right_num); break;
+        default: throw runtime_error("Unknown operator: " + string(op_text));
+    }
+}
+
+// obsluga 'print' - wartosci ida prosto do bufora wyjscia, bez skladania tekstu po drodze
+void builtin_print(const Value* args, size_t count) {
+    auto guard = output_lock();  // wszystkie argumenty razem, bez wtracen z innych watkow
+    for (size_t i = 0; i < count; ++i) print_value(args[i]);
+}
+
+// obsluga 'input' - czyta linie z konsoli, opcjonalnie wypisuje zachete.
+// Przed czekaniem na uzytkownika oprozniamy bufor wyjscia, zeby widzial pytanie.
+Value builtin_input(const Value* prompt) {
+    auto guard = output_lock();
+    if (prompt) print_value(*prompt);
+    if (prompt || output_is_terminal()) output_flush();
+    // Skrypty z --batch czytaja jedno wejscie, kazdy swoje linie
+    static mutex input_mutex;
+    auto input_guard = lock_if_threads(input_mutex);
+    string line;
+    getline(cin, line);
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    return Value::string(std::move(line));
+}
+
+// Konwersja na liczbe
+Value builtin_number(const Value& val) {
+    if (val.type() == TYPE_STRING) return Value::number(stoll(string(val.as_string())));
+    return val;
+}
+
+// Konwersja na string
+Value builtin_string(const Value& val) {
+    return Value::string(value_to_string(val));
+}
+
+// Sprawdzenie typu wartosci
+Value builtin_typeof(const Value& val) {
+    if (val.type() == TYPE_NUMBER) return Value::string("number");
+    if (val.type() == TYPE_STRING) return Value::string("string");
+    if (val.type() == TYPE_FUNCTION) return Value::string("function");
+    if (val.type() == TYPE_ARRAY) return Value::string("array");
+    if (val.type() == TYPE_MAP) return Value::string("map");
+    return Value::string("nil");
+}
+
+// Dlugosc stringa albo tablicy
+Value builtin_len(const Value& val) {
+    if (val.type() == TYPE_ARRAY) return Value::number(val.array_length());
+    if (val.type() != TYPE_STRING) throw runtime_error("Type error: 'len' only operates on strings and arrays.");
+    return Value::number(val.as_string().length());
+}
+
+// Pobranie znaku ze stringa albo elementu tablicy
+Value builtin_get(const Value& str_val, const Value& idx_val) {
+    if (str_val.type() != TYPE_STRING && str_val.type() != TYPE_ARRAY) throw runtime_error("Type error: The first argument to 'get' must be a string or array.");
+    if (idx_val.type() != TYPE_NUMBER) throw runtime_error("Type error: The second argument to 'get' must be a number (index).");
+    int_fast64_t idx = idx_val.as_number();
+    if (str_val.type() == TYPE_ARRAY) {
+        if (idx < 0 || idx >= (int_fast64_t)str_val.array_length()) throw runtime_error("Index out of bounds.");
+        return str_val.array_at(idx);
+    }
+    string_view str = str_val.as_string();
+    if (idx < 0 || idx >= (int_fast64_t)str.length()) throw runtime_error("Index out of bounds.");
+    return Value::string(str.substr(idx, 1));
+}
+
+// Ustawienie znaku w stringu albo elementu tablicy (modyfikuje zmienna!)
+void builtin_set(Value& target, const Value& idx_val, const Value& new_char_val) {
+    if (idx_val.type() != TYPE_NUMBER) throw runtime_error("Type error: The second argument to 'set' must be a number (index).");
+    if (target.type() == TYPE_ARRAY) {
+        int_fast64_t idx = idx_val.as_number();
+        if (idx < 0 || idx >= (int_fast64_t)target.array_length()) throw runtime_error("Index for 'set' is out of bounds.");
+        target.array_set(idx, new_char_val);
+        return;
+    }
+    if (new_char_val.type() != TYPE_STRING || new_char_val.as_string().length() != 1) throw runtime_error("Type error: The third argument to 'set' must be a single-character string.");
+    int_fast64_t idx = idx_val.as_number();
+    if (idx < 0 || idx >= (int_fast64_t)target.as_string().length()) throw runtime_error("Index for 'set' is out of bounds.");
+    target.mutable_chars()[idx] = new_char_val.as_string()[0];
+}
+
+// Generowanie liczby losowej z przedzialu
+Value builtin_random(const Value& min_arg, const Value& max_arg) {
+    if (min_arg.type() != TYPE_NUMBER || max_arg.type() != TYPE_NUMBER) throw runtime_error("Type error: Arguments for 'random' must be numbers.");
+
+    int_fast64_t min_val = min_arg.as_number();
+    int_fast64_t max_val = max_arg.as_number();
+
+    if (min_val > max_val) throw runtime_error("First argument to 'random' cannot be greater than the second argument.");
+
+    // Kazdy watek (pmap, spawn) ma wlasny generator
+    static thread_local std::mt19937 gen(std::random_device{}());
+    std::uniform_int_distribution<int_fast64_t> distrib(min_val, max_val);
+
+    return Value::number(distrib(gen));
+}
+
+// Zwraca kod ASCII pierwszego znaku w stringu
+Value builtin_ord(const Value& val) {
+    if (val.type() != TYPE_STRING || val.as_string().empty()) {
+        throw runtime_error("Argument for 'ord' must be a non-empty string.");
+    }
+    return Value::number(val.as_string()[0]);
+}
+
+// Zwraca jednoznakowy string dla podanego kodu ASCII
+Value builtin_chr(const Value& val) {
+    if (val.type() != TYPE_NUMBER) {
+        throw runtime_error("Argument for 'chr' must be a number.");
+    }
+    char c = (char)val.as_number();
+    return Value::string(string_view(&c, 1));
+}
@@ -0,0 +1,113 @@
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include "types.hpp"
+
+// Wspolne implementacje slow kluczowych i operatorow.
+// Korzysta z nich zarowno evaluator drzewa (--tree-walk) jak i maszyna wirtualna,
+// dzieki temu oba tryby licza to samo i rzucaja te same komunikaty bledow.
+
+// Najwieksza glebokosc zagniezdzonych wywolan funkcji (opcja --max-depth).
+// Wywolania na samym koncu ciala funkcji nie zajmuja nowej ramki, wiec sie nie licza.
+constexpr size_t DEFAULT_MAX_CALL_DEPTH = 1000000;
+extern size_t max_call_depth;
+
+// Blad przekroczenia max_call_depth - ten sam komunikat w obu trybach
+[[noreturn]] void throw_stack_overflow();
+
+// Sprawdza czy wartosc jest "prawdziwa", np. w warunkach if/loop.
+bool is_truthy(const Value& val);
+
+// Operatory infiksowe rozpoznane po tekscie tokena
+enum InfixOp { INFIX_ADD, INFIX_SUB, INFIX_MUL, INFIX_DIV, INFIX_MOD, INFIX_EQ, INFIX_NE, INFIX_GT, INFIX_LT, INFIX_GE, INFIX_LE, INFIX_UNKNOWN };
+
+// Zamienia tekst operatora (np. "+", "<=") na InfixOp, nieznane daja INFIX_UNKNOWN
+InfixOp infix_op_from_text(string_view text);
+
+// To samo dla tokena na miejscu operatora. Operatory i identyfikatory maja symbol, wiec to tylko odejmowanie.
+inline InfixOp infix_op_of(const Token& token) {
+    if (token.symbol == NO_SYMBOL) return infix_op_from_text(token_text(token));
+    if (token.symbol >= SYM_ADD && token.symbol <= SYM_LE) return (InfixOp)(token.symbol - SYM_ADD);
+    return INFIX_UNKNOWN;
+}
+
+// Rownosc dla '==' i '!=': wartosci sa rowne gdy maja ten sam tekst (tak jak z value_to_string),
+// liczby z liczbami i stringi ze stringami porownujemy bez zamiany na tekst.
+bool values_equal(const Value& left, const Value& right);
+
+// Wykonuje jeden krok lancucha infiksowego: result = result <op> rhs.
+// op_text jest potrzebny tylko do komunikatow bledow (i dla nieznanych operatorow).
+void apply_infix(InfixOp op, string_view op_text, Value& result, const Value& rhs);
+
+// Slowa kluczowe, ktore po obliczeniu argumentow sa zwyklymi funkcjami
+void builtin_print(const Value* args, size_t count);
+Value builtin_input(const Value* prompt);
+Value builtin_number(const Value& val);
+Value builtin_string(const Value& val);
+Value builtin_typeof(const Value& val);
+Value builtin_len(const Value& val);
+Value builtin_get(const Value& str_val, const Value& idx_val);
+// 'set' dostaje juz sprawdzona zmienna (istnieje i jest stringiem albo tablica) i zmienia ja w miejscu
+void builtin_set(Value& target, const Value& idx_val, const Value& new_char_val);
+Value builtin_random(const Value& min_arg, const Value& max_arg);
+Value builtin_ord(const Value& val);
+Value builtin_chr(const Value& val);
+
+// Pliki (io.cpp). file_open daje uchwyt (liczbe) dla file_line, file_eof i file_close.
+Value builtin_file_read(const Value& path);
+Value builtin_file_write(const Value& path, const Value& text);
+Value builtin_file_open(const Value& path);
+Value builtin_file_line(const Value& handle);
+Value builtin_file_eof(const Value& handle);
+Value builtin_file_close(const Value& handle);
+
+// Komendy systemowe (process.cpp). sys_async daje uchwyt (liczbe) dla await, sys_status i sys_stderr,
+// await zwraca standardowe wyjscie komendy i zwalnia uchwyt.
+Value builtin_sys(const Value& cmd_val);
+Value builtin_sys_async(const Value& cmd_val);
+Value builtin_await(const Value& handle);
+Value builtin_sys_status(const Value& handle);
+Value builtin_sys_stderr(const Value& handle);
+
+// Zadania na wielu watkach (parallel.cpp). pmap wywoluje funkcje dla kazdej linii tekstu i sklada wyniki w linie,
+// spawn dostaje funkcje i jej argumenty i daje uchwyt (liczbe) dla join, ktory zwraca wynik i zwalnia uchwyt.
+Value builtin_pmap(const Value& function, const Value& text);
+Value builtin_spawn(const Value* args, size_t count);
+Value builtin_join(const Value& handle);
+
+// Tablice (array.cpp). Tablica jest wartoscia jak string: array_push i array_slice daja nowa tablice,
+// a w miejscu zmienia ja tylko 'set'. array_slice tnie tez stringi, array_map wola funkcje dla kazdego elementu.
+Value builtin_array(const Value* args, size_t count);
+Value builtin_array_push(const Value& array, const Value& element);
+Value builtin_array_slice(const Value& val, const Value& start_val, const Value& end_val);
+Value builtin_array_sum(const Value& array);
+Value builtin_array_min(const Value& array);
+Value builtin_array_max(const Value& array);
+Value builtin_array_fill(const Value& count_val, const Value& element);
+Value builtin_array_map(const Value& function, const Value& array);
+
+// Slowniki (map.cpp). Klucze to liczby albo stringi. map_put i map_delete oddaja nowy slownik jak array_push,
+// map_get dla brakujacego klucza daje nil, map_keys daje tablice kluczy w kolejnosci dodawania.
+Value builtin_map(const Value* args, size_t count);
+Value builtin_map_put(const Value& map, const Value& key, const Value& value);
+Value builtin_map_delete(const Value& map, const Value& key);
+// (def zmienna (map_put zmienna ...)) w jednym kroku: wynik trafia do 'target', w miejscu, jesli 'map' to jej slownik
+void builtin_map_put_into(Value& target, Value map, const Value& key, const Value& value);
+void builtin_map_delete_into(Value& target, Value map, const Value& key);
+Value builtin_map_get(const Value& map, const Value& key);
+Value builtin_map_has(const Value& map, const Value& key);
+Value builtin_map_size(const Value& map);
+Value builtin_map_keys(const Value& map);
@@ -0,0 +1,357 @@
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "cache.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Naglowek pliku: magia, wersja, hash i dlugosc zrodla, hash reszty pliku (skompilowanego programu)
+static const char BLC_MAGIC[4] = {'B', 'L', 'C', '\0'};
+
+string cache_path(const string& source_path) { return source_path + "c"; }
+
+uint64_t source_hash(string_view source) {
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : source) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Zapis - wszystko do jednego bufora, liczby w kolejnosci bajtow procesora
+struct CacheWriter {
+    string out;
+
+    void bytes(const void* data, size_t size) { out.append(static_cast<const char*>(data), size); }
+    void u8(uint8_t v) { bytes(&v, sizeof(v)); }
+    void u32(uint32_t v) { bytes(&v, sizeof(v)); }
+    void u64(uint64_t v) { bytes(&v, sizeof(v)); }
+    void text(string_view s) { u32(s.size()); bytes(s.data(), s.size()); }
+
+    void chunk(const Chunk& chunk) {
+        u32(chunk.parameter_count);
+        u32(chunk.code.size());
+        bytes(chunk.code.data(), chunk.code.size() * sizeof(uint32_t));
+        u32(chunk.constants.size());
+        for (const Value& val : chunk.constants) {
+            u8(val.type());
+            if (val.type() == TYPE_NUMBER) u64(val.as_number());
+            else text(val.as_string());
+        }
+        u32(chunk.names.size());
+        for (const string& name : chunk.names) text(name);
+        u32(chunk.locals.size());
+        for (Symbol name : chunk.locals) text(symbol_name(name));
+        u32(chunk.local_init.size());
+        for (int32_t init : chunk.local_init) u32(init);
+        u32(chunk.captures.size());
+        for (Symbol name : chunk.captures) text(symbol_name(name));
+        u32(chunk.capture_from.size());
+        for (const CaptureSource& source : chunk.capture_from) {
+            u8(source.from_local);
+            u32(source.index);
+        }
+        u32(chunk.loops.size());
+        for (const JitProfile& loop : chunk.loops) {
+            u32(loop.start);
+            u32(loop.end);
+            u32(loop.source_offset);
+        }
+        u32(chunk.body_profile.end);
+        u32(chunk.body_profile.source_offset);
+        text(chunk.name);
+        u32(chunk.functions.size());
+        for (const auto& function : chunk.functions) this->chunk(*function);
+    }
+};
+
+// Odczyt z zamapowanej pamieci. Kazdy odczyt sprawdza granice - uszkodzony plik to wyjatek, a nie crash.
+struct CacheReader {
+    const char* data;
+    size_t size;
+    size_t pos = 0;
+
+    const char* take(size_t count) {
+        if (count > size - pos) throw runtime_error("Corrupted cache file.");
+        const char* at = data + pos;
+        pos += count;
+        return at;
+    }
+    uint8_t u8() { return *take(1); }
+    uint32_t u32() { uint32_t v; memcpy(&v, take(sizeof(v)), sizeof(v)); return v; }
+    uint64_t u64() { uint64_t v; memcpy(&v, take(sizeof(v)), sizeof(v)); return v; }
+    string_view text() { uint32_t length = u32(); return string_view(take(length), length); }
+    // Liczba elementow - nie wieksza niz reszta pliku, zeby uszkodzony plik nie zamowil gigabajtow pamieci
+    uint32_t count() {
+        uint32_t n = u32();
+        if (n > size - pos) throw runtime_error("Corrupted cache file.");
+        return n;
+    }
+
+    shared_ptr<Chunk> chunk() {
+        auto chunk = make_shared<Chunk>();
+        chunk->parameter_count = u32();
+        uint32_t code_size = count();
+        chunk->code.resize(code_size);
+        memcpy(chunk->code.data(), take(code_size * sizeof(uint32_t)), code_size * sizeof(uint32_t));
+        for (uint32_t i = 0, n = count(); i < n; ++i) {
+            if (u8() == TYPE_NUMBER) chunk->constants.push_back(Value::number(u64()));
+            else chunk->constants.push_back(Value::string(text()));
+        }
+        for (uint32_t i = 0, n = count(); i < n; ++i) chunk->names.emplace_back(text());
+        for (uint32_t i = 0, n = count(); i < n; ++i) chunk->locals.push_back(intern(string(text())));
+        for (uint32_t i = 0, n = count(); i < n; ++i) chunk->local_init.push_back(u32());
+        for (uint32_t i = 0, n = count(); i < n; ++i) chunk->captures.push_back(intern(string(text())));
+        for (uint32_t i = 0, n = count(); i < n; ++i) {
+            bool from_local = u8();
+            chunk->capture_from.push_back(CaptureSource{from_local, u32()});
+        }
+        for (uint32_t i = 0, n = count(); i < n; ++i) {
+            JitProfile loop;
+            loop.start = u32();
+            loop.end = u32();
+            loop.source_offset = u32();
+            chunk->loops.push_back(loop);
+        }
+        chunk->body_profile.end = u32();
+        chunk->body_profile.source_offset = u32();
+        chunk->name = text();
+        for (uint32_t i = 0, n = count(); i < n; ++i) chunk->functions.push_back(this->chunk());
+        return chunk;
+    }
+};
+
+// Ile wartosci instrukcja potrzebuje na stosie (ponad zmienne ramki) i ile tam zostawia zamiast nich.
+// pushes < 0: instrukcja konczy wykonanie kawalka (return, throw, wywolanie ogonowe). false: nieznana instrukcja.
+static bool stack_effect(uint32_t op, uint32_t arg, int64_t& pops, int64_t& pushes) {
+    pops = 0;
+    pushes = 1;
+    switch (op) {
+        case OP_CONST: case OP_NIL: case OP_LOAD_LOCAL: case OP_LOAD_CAPTURE: case OP_MAKE_FUN: break;
+        case OP_POP: case OP_JUMP_IF_FALSE: pops = 1; pushes = 0; break;
+        case OP_JUMP: case OP_LOOP: pushes = 0; break;
+        case OP_CALL_OR_JUMP: pops = 1; break;
+        case OP_CALL: pops = (int64_t)arg + 1; break;
+        case OP_TAIL_CALL: pops = (int64_t)arg + 1; pushes = -1; break;
+        case OP_RETURN: pops = 1; pushes = -1; break;
+        case OP_THROW: pushes = -1; break;
+        case OP_SPAWN:
+            if (arg == 0) return false;
+            pops = arg;
+            break;
+        case OP_PRINT: case OP_ARRAY: case OP_MAP: pops = arg; break;
+        case OP_INPUT:
+            if (arg > 1) return false;
+            pops = arg;
+            break;
+        case OP_ARRAY_SLICE: case OP_MAP_PUT: case OP_MAP_PUT_LOCAL: pops = 3; break;
+        case OP_DEF_LOCAL:
+        case OP_NUMBER: case OP_STRING: case OP_TYPEOF: case OP_LEN: case OP_SYS: case OP_ORD: case OP_CHR:
+        case OP_FILE_READ: case OP_FILE_OPEN: case OP_FILE_LINE: case OP_FILE_EOF: case OP_FILE_CLOSE:
+        case OP_SYS_ASYNC: case OP_AWAIT: case OP_SYS_STATUS: case OP_SYS_STDERR: case OP_JOIN:
+        case OP_ARRAY_SUM: case OP_ARRAY_MIN: case OP_ARRAY_MAX: case OP_MAP_KEYS: case OP_MAP_SIZE: pops = 1; break;
+        case OP_SET_LOCAL: case OP_MAP_DELETE: case OP_MAP_DELETE_LOCAL: case OP_UNKNOWN_OP: case OP_GET: case OP_RANDOM: case OP_FILE_WRITE: case OP_PMAP:
+        case OP_ARRAY_PUSH: case OP_ARRAY_FILL: case OP_ARRAY_MAP: case OP_MAP_GET: case OP_MAP_HAS: pops = 2; break;
+        default:
+            // Operatory (tez wyspecjalizowane). OP_NATIVE nigdy nie trafia do pliku.
+            if (op < OP_ADD || op > OP_NE_STR) return false;
+            pops = 2;
+            break;
+    }
+    return true;
+}
+
+// Sprawdza bajtkod z pliku tak, zeby maszyna wirtualna (i JIT) nie mogly przez niego wyjsc poza tablice:
+// kazda instrukcja jest znana i miesci sie w kodzie, numery stalych, slotow, nazw, petli i funkcji istnieja,
+// skoki trafiaja na poczatek instrukcji, a stos ma w kazdym miejscu te sama glebokosc, nigdy nie schodzi
+// ponizej zmiennych ramki i kazda droga konczy sie instrukcja konczaca kawalek.
+// 'parent' to kawalek, w ktorym funkcja powstaje (skad capture_from bierze wartosci), nullptr dla programu.
+static bool valid_chunk(const Chunk& chunk, const Chunk* parent) {
+    const vector<uint32_t>& code = chunk.code;
+    size_t slots = chunk.locals.size();
+    if (chunk.parameter_count > slots) return false;
+    if (parent && chunk.parameter_count + chunk.local_init.size() != slots) return false;
+    for (int32_t init : chunk.local_init) {
+        if (init < -1 || init >= (int64_t)chunk.captures.size()) return false;
+    }
+    if (parent) {
+        if (chunk.capture_from.size() != chunk.captures.size()) return false;
+        for (const CaptureSource& source : chunk.capture_from) {
+            if (source.index >= (source.from_local ? parent->locals.size() : parent->captures.size())) return false;
+        }
+    } else if (!chunk.captures.empty() || !chunk.capture_from.empty()) {
+        return false;
+    }
+
+    // Granice instrukcji i argumenty
+    vector<bool> starts(code.size() + 1, false);
+    for (size_t pc = 0; pc < code.size(); pc += instruction_size(code[pc])) {
+        starts[pc] = true;
+        uint32_t op = code[pc];
+        if (op >= OP_COUNT || pc + instruction_size(op) > code.size()) return false;
+        uint32_t arg = instruction_size(op) > 1 ? code[pc + 1] : 0;
+        switch (op) {
+            case OP_CONST: if (arg >= chunk.constants.size()) return false; break;
+            case OP_THROW: if (arg >= chunk.constants.size() || chunk.constants[arg].type() != TYPE_STRING) return false; break;
+            case OP_LOAD_LOCAL: case OP_DEF_LOCAL: case OP_SET_LOCAL: case OP_MAP_PUT_LOCAL: case OP_MAP_DELETE_LOCAL:
+                if (arg >= slots) return false;
+                break;
+            case OP_LOAD_CAPTURE: if (arg >= chunk.captures.size()) return false; break;
+            case OP_MAKE_FUN: if (arg >= chunk.functions.size()) return false; break;
+            case OP_UNKNOWN_OP: if (arg >= chunk.names.size()) return false; break;
+            case OP_LOOP: if (code[pc + 2] >= chunk.loops.size()) return false; break;
+            default: break;
+        }
+    }
+    auto is_start = [&](uint32_t pc) { return pc < code.size() && starts[pc]; };
+    for (const JitProfile& loop : chunk.loops) {
+        if (loop.start > loop.end || !is_start(loop.start) || (loop.end != code.size() && !is_start(loop.end))) return false;
+    }
+    if (chunk.body_profile.end > code.size() || (chunk.body_profile.end != code.size() && !is_start(chunk.body_profile.end))) return false;
+
+    // Glebokosc stosu po wszystkich drogach, jak stack_depths w transpiler.cpp. Do tego pamietamy otwarte
+    // wywolania (miejsce funkcji na stosie i liczba argumentow): OP_CALL nie sprawdza juz, co wywoluje,
+    // wiec musi zamykac wywolanie otwarte przez OP_CALL_OR_JUMP z ta sama liczba argumentow.
+    struct State {
+        int64_t depth = -1;
+        vector<pair<int64_t, uint32_t>> calls;
+        bool operator==(const State&) const = default;
+    };
+    vector<State> states(code.size());
+    vector<pair<uint32_t, State>> work = {{0, State{(int64_t)slots, {}}}};
+    while (!work.empty()) {
+        auto [pc, state] = std::move(work.back());
+        work.pop_back();
+        if (!is_start(pc)) return false;
+        if (states[pc].depth >= 0) {
+            if (!(states[pc] == state)) return false;
+            continue;
+        }
+        states[pc] = state;
+        uint32_t op = code[pc];
+        uint32_t arg = instruction_size(op) > 1 ? code[pc + 1] : 0;
+        int64_t pops, pushes;
+        if (!stack_effect(op, arg, pops, pushes)) return false;
+        if (op == OP_CALL || op == OP_TAIL_CALL) {
+            if (state.calls.empty() || state.calls.back() != pair<int64_t, uint32_t>(state.depth - pops, arg)) return false;
+            state.calls.pop_back();
+            // Wywolanie ogonowe zajmuje miejsce funkcji, w ktorej jest - program nie ma takiego miejsca
+            if (op == OP_TAIL_CALL && !parent) return false;
+        }
+        int64_t floor = state.calls.empty() ? (int64_t)slots : max((int64_t)slots, state.calls.back().first + 1);
+        if (state.depth - pops < floor) return false;
+        if (pushes < 0) continue;
+        State next = state;
+        next.depth = state.depth - pops + pushes;
+        if (op == OP_JUMP || op == OP_LOOP) {
+            work.push_back({arg, std::move(next)});
+            continue;
+        }
+        if (op == OP_JUMP_IF_FALSE) work.push_back({arg, next});
+        if (op == OP_CALL_OR_JUMP) {
+            work.push_back({code[pc + 2], next});
+            next.calls.push_back({state.depth - 1, arg});
+        }
+        work.push_back({pc + instruction_size(op), std::move(next)});
+    }
+
+    for (const auto& function : chunk.functions) {
+        if (!valid_chunk(*function, &chunk)) return false;
+    }
+    return true;
+}
+
+// Sprawdza naglowek i odtwarza program z bajtow pliku
+static shared_ptr<Chunk> read_program(const char* data, size_t size, string_view source) {
+    try {
+        CacheReader reader{data, size};
+        if (memcmp(reader.take(sizeof(BLC_MAGIC)), BLC_MAGIC, sizeof(BLC_MAGIC)) != 0) return nullptr;
+        if (reader.u32() != BLC_VERSION) return nullptr;
+        if (reader.u64() != source.size() || reader.u64() != source_hash(source)) return nullptr;
+        // Hash lapie przypadkowe uszkodzenia, a valid_chunk nizej - plik przerobiony razem z hashem
+        uint64_t payload_hash = reader.u64();
+        if (payload_hash != source_hash(string_view(data + reader.pos, size - reader.pos))) return nullptr;
+        shared_ptr<Chunk> program = reader.chunk();
+        if (reader.pos != size || !valid_chunk(*program, nullptr)) return nullptr;
+        return program;
+    } catch (const exception&) {
+        return nullptr;
+    }
+}
+
+shared_ptr<Chunk> load_cache(const string& path, string_view source) {
+#ifndef _WIN32
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        close(fd);
+        return nullptr;
+    }
+    size_t size = info.st_size;
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return nullptr;
+    shared_ptr<Chunk> program = read_program(static_cast<const char*>(data), size, source);
+    munmap(data, size);
+    return program;
+#else
+    ifstream file(path, ios::binary);
+    if (!file.is_open()) return nullptr;
+    string data((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+    return read_program(data.data(), data.size(), source);
+#endif
+}
+
+void save_cache(const string& path, string_view source, const Chunk& program) {
+    CacheWriter writer;
+    writer.bytes(BLC_MAGIC, sizeof(BLC_MAGIC));
+    writer.u32(BLC_VERSION);
+    writer.u64(source.size());
+    writer.u64(source_hash(source));
+    CacheWriter payload;
+    payload.chunk(program);
+    writer.u64(source_hash(payload.out));
+    writer.out += payload.out;
+
+    // Plik tymczasowy z losowa koncowka, potem podmiana - inny proces czyta albo stary, albo caly nowy plik
+    string temp_path = path + ".tmp" + to_string(random_device{}());
+    {
+        ofstream file(temp_path, ios::binary | ios::trunc);
+        if (!file.is_open()) return;
+        file.write(writer.out.data(), writer.out.size());
+        if (!file) {
+            file.close();
+            error_code ignored;
+            filesystem::remove(temp_path, ignored);
+            return;
+        }
+    }
+    error_code error;
+    filesystem::rename(temp_path, path, error);
+    if (error) filesystem::remove(temp_path, error);
+}
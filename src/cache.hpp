@@ -0,0 +1,46 @@
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include "types.hpp"
+#include "compiler.hpp"
+
+// Pamiec podreczna skompilowanych programow (pliki .blc).
+//
+// Po kompilacji bajtkod jest zapisywany obok zrodla (prog.bl -> prog.blc) razem z hashem tresci zrodla
+// i hashem samego bajtkodu.
+// Przy kolejnym uruchomieniu plik jest mapowany do pamieci (mmap) i program jest odtwarzany prosto z niego,
+// bez lexera, parsera, optymalizatora i kompilatora. Gdy hash albo wersja formatu sie nie zgadza
+// (albo plik jest uszkodzony, takze w srodku bajtkodu), wracamy do zrodla i zapisujemy nowy plik.
+// Wczytany bajtkod jest jeszcze sprawdzany (numery stalych, slotow i funkcji, cele skokow, glebokosc stosu),
+// wiec nawet plik przerobiony razem z hashem nie wyprowadzi maszyny wirtualnej poza jej tablice.
+//
+// Format zalezy od bajtkodu i kolejnosci bajtow procesora - przy kazdej zmianie instrukcji
+// albo ukladu Chunk trzeba podniesc BLC_VERSION.
+
+constexpr uint32_t BLC_VERSION = 10;
+
+// Nazwa pliku z bajtkodem dla pliku zrodlowego
+string cache_path(const string& source_path);
+
+// Hash tresci zrodla (FNV-1a, 64 bity). Tym samym hashem pilnujemy bajtkodu w pliku .blc.
+uint64_t source_hash(string_view source);
+
+// Wczytuje program z 'path', jesli pasuje do zrodla. Inaczej nullptr.
+shared_ptr<Chunk> load_cache(const string& path, string_view source);
+
+// Zapisuje program do 'path' (przez plik tymczasowy i zmiane nazwy, wiec rownolegle uruchomienia
+// nigdy nie widza polowy pliku). Bledy zapisu (np. katalog tylko do odczytu) sa ignorowane.
+void save_cache(const string& path, string_view source, const Chunk& program);
@@ -0,0 +1,382 @@
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "compiler.hpp"
+#include "builtins.hpp"
+#include "resolver.hpp"
+
+#include <stdexcept>
+
+// Bledy, ktore widac juz przy kompilacji (np. zla liczba argumentow) nie moga wybuchnac od razu,
+// bo evaluator drzewa zglasza je dopiero gdy dojdzie do danego wyrazenia (np. w (if 0 (def))).
+// Dlatego kompilujemy je do instrukcji OP_THROW.
+static const char* CRITICAL_ERROR = "Critical error: Failed to interpret expression.";
+
+// tail: wyrazenie jest ostatnia rzecza, jaka robi cialo funkcji (przez 'if' i ostatni element 'do').
+// Wywolanie w takim miejscu nie potrzebuje nowej ramki - zastepuje ramke aktualnej funkcji.
+static void compile_expression(const Ast& ast, const Node& node, Scope& scope, bool tail = false);
+
+// Dopisuje instrukcje z argumentami na koniec kodu
+static void emit(Chunk& chunk, OpCode op) { chunk.code.push_back(op); }
+static void emit(Chunk& chunk, OpCode op, uint32_t arg) { chunk.code.push_back(op); chunk.code.push_back(arg); }
+
+// Dodaje stala i zwraca jej numer
+static uint32_t add_constant(Chunk& chunk, Value val) {
+    chunk.constants.push_back(std::move(val));
+    return chunk.constants.size() - 1;
+}
+
+// Dodaje nazwe (albo znajduje juz istniejaca) i zwraca jej numer
+static uint32_t add_name(Chunk& chunk, const string& name) {
+    for (size_t i = 0; i < chunk.names.size(); ++i) if (chunk.names[i] == name) return i;
+    chunk.names.push_back(name);
+    return chunk.names.size() - 1;
+}
+
+static void emit_throw(Chunk& chunk, const string& message) {
+    emit(chunk, OP_THROW, add_constant(chunk, Value::string(message)));
+}
+
+// Skok do przodu - cel jeszcze nie jest znany, wiec zwracamy miejsce do poprawienia
+static size_t emit_jump(Chunk& chunk, OpCode op) {
+    emit(chunk, op, 0);
+    return chunk.code.size() - 1;
+}
+
+static void patch_jump(Chunk& chunk, size_t at) { chunk.code[at] = chunk.code.size(); }
+
+static string arg_count(span<const Node> list) { return to_string(list.size() - 1); }
+
+// Pozycja tokena w zrodle dla --profile. Tokeny stworzone poza parserem nie wskazuja w zrodlo.
+static uint32_t source_offset(const Ast& ast, const Token& token) {
+    uintptr_t at = (uintptr_t)token.text.data(), begin = (uintptr_t)ast.source.data();
+    if (token.text.empty() || at < begin || at - begin >= ast.source.size()) return NO_SOURCE_OFFSET;
+    return at - begin;
+}
+
+// Kompiluje slowo kluczowe (symbol ponizej KEYWORD_COUNT)
+// Czy wartosc 'def' to (map_put nazwa klucz wartosc) albo (map_delete nazwa klucz) dla tej samej nazwy.
+// Daje opcode, ktory robi to w slocie zmiennej, albo OP_NIL.
+static OpCode in_place_op(span<const Node> value, Symbol name) {
+    if (value.size() < 3 || value[0].token.type != TOKEN_IDENTIFIER || value[1].is_list()) return OP_NIL;
+    if (value[1].token.type != TOKEN_IDENTIFIER || value[1].token.symbol != name) return OP_NIL;
+    if (value[0].token.symbol == KW_MAP_PUT && value.size() == 4) return OP_MAP_PUT_LOCAL;
+    if (value[0].token.symbol == KW_MAP_DELETE && value.size() == 3) return OP_MAP_DELETE_LOCAL;
+    return OP_NIL;
+}
+
+static void compile_keyword(const Ast& ast, Symbol keyword, span<const Node> list, Scope& scope, bool tail) {
+    Chunk& chunk = *scope.chunk;
+
+    // Proste slowa kluczowe z jednym argumentem - kompilujemy argument i jedna instrukcje
+    auto unary = [&](OpCode op, const string& arity_error) {
+        if (list.size() != 2) { emit_throw(chunk, arity_error); return; }
+        compile_expression(ast, list[1], scope);
+        emit(chunk, op);
+    };
+    // Tak samo dla dwoch argumentow
+    auto binary = [&](OpCode op, const string& arity_error) {
+        if (list.size() != 3) { emit_throw(chunk, arity_error); return; }
+        compile_expression(ast, list[1], scope);
+        compile_expression(ast, list[2], scope);
+        emit(chunk, op);
+    };
+    // I dla trzech
+    auto ternary = [&](OpCode op, const string& arity_error) {
+        if (list.size() != 4) { emit_throw(chunk, arity_error); return; }
+        for (size_t i = 1; i < 4; ++i) compile_expression(ast, list[i], scope);
+        emit(chunk, op);
+    };
+
+    switch ((PredefinedSymbol)keyword) {
+        case KW_DEF: {
+            if (list.size() != 3) { emit_throw(chunk, "'def' requires 2 arguments (name, value), but received " + arg_count(list) + "."); return; }
+            if (list[1].is_list()) { emit_throw(chunk, "Syntax error: The first argument to 'def' must be a name."); return; }
+            Symbol name = name_symbol(list[1].token);
+            span<const Node> value = list[2].is_list() ? ast.list(list[2]) : span<const Node>{};
+            // (def m (map_put m k v)) - slownik zmieniany w slocie, bez kopii (builtin_map_put_into)
+            OpCode in_place = in_place_op(value, name);
+            if (in_place != OP_NIL) {
+                for (size_t i = 1; i < value.size(); ++i) compile_expression(ast, value[i], scope);
+                emit(chunk, in_place, resolve(scope, name).index);
+                return;
+            }
+            size_t function_count = chunk.functions.size();
+            compile_expression(ast, list[2], scope);
+            // (def nazwa (fun ...)) - funkcja dostaje nazwe, pod ktora widac ja w --profile
+            if (!value.empty() && value[0].token.type == TOKEN_IDENTIFIER && value[0].token.symbol == KW_FUN && chunk.functions.size() == function_count + 1) {
+                chunk.functions.back()->name = token_text(list[1].token);
+            }
+            emit(chunk, OP_DEF_LOCAL, resolve(scope, name).index);
+            return;
+        }
+        case KW_PRINT: {
+            for (size_t i = 1; i < list.size(); ++i) compile_expression(ast, list[i], scope);
+            emit(chunk, OP_PRINT, list.size() - 1);
+            return;
+        }
+        case KW_SPAWN: {
+            if (list.size() < 2) { emit_throw(chunk, "'spawn' requires at least 1 argument (a function), but received 0."); return; }
+            for (size_t i = 1; i < list.size(); ++i) compile_expression(ast, list[i], scope);
+            emit(chunk, OP_SPAWN, list.size() - 1);
+            return;
+        }
+        case KW_ARRAY: {
+            for (size_t i = 1; i < list.size(); ++i) compile_expression(ast, list[i], scope);
+            emit(chunk, OP_ARRAY, list.size() - 1);
+            return;
+        }
+        case KW_MAP: {
+            for (size_t i = 1; i < list.size(); ++i) compile_expression(ast, list[i], scope);
+            emit(chunk, OP_MAP, list.size() - 1);
+            return;
+        }
+        case KW_IF: {
+            if (list.size() != 3) { emit_throw(chunk, "'if' requires 2 arguments (condition, body), but received " + arg_count(list) + "."); return; }
+            compile_expression(ast, list[1], scope);
+            size_t to_else = emit_jump(chunk, OP_JUMP_IF_FALSE);
+            compile_expression(ast, list[2], scope, tail);
+            size_t to_end = emit_jump(chunk, OP_JUMP);
+            patch_jump(chunk, to_else);
+            emit(chunk, OP_NIL);
+            patch_jump(chunk, to_end);
+            return;
+        }
+        case KW_LOOP: {
+            if (list.size() != 3) { emit_throw(chunk, "'loop' requires 2 arguments (condition, body), but received " + arg_count(list) + "."); return; }
+            // Na stosie lezy zawsze wynik ostatniego obrotu (na poczatku nil)
+            emit(chunk, OP_NIL);
+            uint32_t loop_start = chunk.code.size();
+            compile_expression(ast, list[1], scope);
+            size_t to_end = emit_jump(chunk, OP_JUMP_IF_FALSE);
+            emit(chunk, OP_POP);
+            compile_expression(ast, list[2], scope);
+            emit(chunk, OP_LOOP, loop_start);
+            chunk.code.push_back(chunk.loops.size());
+            patch_jump(chunk, to_end);
+            chunk.loops.push_back(JitProfile{loop_start, (uint32_t)chunk.code.size()});
+            chunk.loops.back().source_offset = source_offset(ast, list[0].token);
+            return;
+        }
+        case KW_DO: {
+            if (list.size() == 1) { emit(chunk, OP_NIL); return; }
+            for (size_t i = 1; i < list.size(); ++i) {
+                if (i > 1) emit(chunk, OP_POP);
+                compile_expression(ast, list[i], scope, tail && i == list.size() - 1);
+            }
+            return;
+        }
+        case KW_FUN: {
+            if (list.size() != 3) { emit_throw(chunk, "'fun' requires 2 arguments (parameters, body), but received " + arg_count(list) + "."); return; }
+            if (!list[1].is_list()) { emit_throw(chunk, "Syntax error: 'fun' expects a list of parameters."); return; }
+            vector<Symbol> params;
+            for (const Node& param : ast.list(list[1])) {
+                if (param.is_list()) { emit_throw(chunk, "Syntax error: 'fun' parameters must be names."); return; }
+                params.push_back(name_symbol(param.token));
+            }
+            // Cialo funkcji dostaje wlasny zakres: sloty na parametry i zmienne z 'def'/'set'
+            auto body = make_shared<Chunk>();
+            Scope body_scope;
+            body_scope.parent = &scope;
+            body_scope.chunk = body.get();
+            vector<Symbol> locals;
+            collect_locals(ast, list[2], locals);
+            declare_locals(body_scope, params, locals);
+            compile_expression(ast, list[2], body_scope, true);
+            emit(*body, OP_RETURN);
+            body->body_profile.end = body->code.size();
+            body->body_profile.source_offset = source_offset(ast, list[0].token);
+            finish_scope(body_scope);
+            chunk.functions.push_back(body);
+            emit(chunk, OP_MAKE_FUN, chunk.functions.size() - 1);
+            return;
+        }
+        case KW_INPUT: {
+            if (list.size() > 2) { emit_throw(chunk, "'input' takes 0 or 1 arguments, but received " + arg_count(list) + "."); return; }
+            if (list.size() == 2) compile_expression(ast, list[1], scope);
+            emit(chunk, OP_INPUT, list.size() - 1);
+            return;
+        }
+        case KW_SET: {
+            if (list.size() != 4) { emit_throw(chunk, "'set' requires 3 arguments (identifier, index, value), but received " + arg_count(list) + "."); return; }
+            if (list[1].token.type != TOKEN_IDENTIFIER) { emit_throw(chunk, "Type error: The first argument to 'set' must be a variable identifier."); return; }
+            compile_expression(ast, list[2], scope);
+            compile_expression(ast, list[3], scope);
+            emit(chunk, OP_SET_LOCAL, resolve(scope, list[1].token.symbol).index);
+            return;
+        }
+        case KW_NUMBER: unary(OP_NUMBER, "'Number' requires 1 argument, but received " + arg_count(list) + "."); return;
+        case KW_STRING: unary(OP_STRING, "'String' requires 1 argument, but received " + arg_count(list) + "."); return;
+        case KW_TYPEOF: unary(OP_TYPEOF, "'typeof' requires 1 argument, but received " + arg_count(list) + "."); return;
+        case KW_LEN: unary(OP_LEN, "'len' requires 1 argument (string or array), but received " + arg_count(list) + "."); return;
+        case KW_SYS: unary(OP_SYS, "'sys' requires 1 argument (a command string), but received " + arg_count(list) + "."); return;
+        case KW_ORD: unary(OP_ORD, "'ord' requires 1 argument (string)."); return;
+        case KW_CHR: unary(OP_CHR, "'chr' requires 1 argument (number)."); return;
+        case KW_GET: binary(OP_GET, "'get' requires 2 arguments (string or array, index), but received " + arg_count(list) + "."); return;
+        case KW_RANDOM: binary(OP_RANDOM, "'random' requires 2 arguments (min, max), but received " + arg_count(list) + "."); return;
+        case KW_FILE_READ: unary(OP_FILE_READ, "'file_read' requires 1 argument (path), but received " + arg_count(list) + "."); return;
+        case KW_FILE_WRITE: binary(OP_FILE_WRITE, "'file_write' requires 2 arguments (path, text), but received " + arg_count(list) + "."); return;
+        case KW_FILE_OPEN: unary(OP_FILE_OPEN, "'file_open' requires 1 argument (path), but received " + arg_count(list) + "."); return;
+        case KW_FILE_LINE: unary(OP_FILE_LINE, "'file_line' requires 1 argument (file handle), but received " + arg_count(list) + "."); return;
+        case KW_FILE_EOF: unary(OP_FILE_EOF, "'file_eof' requires 1 argument (file handle), but received " + arg_count(list) + "."); return;
+        case KW_FILE_CLOSE: unary(OP_FILE_CLOSE, "'file_close' requires 1 argument (file handle), but received " + arg_count(list) + "."); return;
+        case KW_PMAP: binary(OP_PMAP, "'pmap' requires 2 arguments (function, text), but received " + arg_count(list) + "."); return;
+        case KW_JOIN: unary(OP_JOIN, "'join' requires 1 argument (task handle), but received " + arg_count(list) + "."); return;
+        case KW_ARRAY_PUSH: binary(OP_ARRAY_PUSH, "'array_push' requires 2 arguments (array, value), but received " + arg_count(list) + "."); return;
+        case KW_ARRAY_SLICE: ternary(OP_ARRAY_SLICE, "'array_slice' requires 3 arguments (array, start, end), but received " + arg_count(list) + "."); return;
+        case KW_ARRAY_SUM: unary(OP_ARRAY_SUM, "'array_sum' requires 1 argument (array), but received " + arg_count(list) + "."); return;
+        case KW_ARRAY_MIN: unary(OP_ARRAY_MIN, "'array_min' requires 1 argument (array), but received " + arg_count(list) + "."); return;
+        case KW_ARRAY_MAX: unary(OP_ARRAY_MAX, "'array_max' requires 1 argument (array), but received " + arg_count(list) + "."); return;
+        case KW_ARRAY_FILL: binary(OP_ARRAY_FILL, "'array_fill' requires 2 arguments (count, value), but received " + arg_count(list) + "."); return;
+        case KW_MAP_PUT: ternary(OP_MAP_PUT, "'map_put' requires 3 arguments (map, key, value), but received " + arg_count(list) + "."); return;
+        case KW_MAP_DELETE: binary(OP_MAP_DELETE, "'map_delete' requires 2 arguments (map, key), but received " + arg_count(list) + "."); return;
+        case KW_MAP_GET: binary(OP_MAP_GET, "'map_get' requires 2 arguments (map, key), but received " + arg_count(list) + "."); return;
+        case KW_MAP_HAS: binary(OP_MAP_HAS, "'map_has' requires 2 arguments (map, key), but received " + arg_count(list) + "."); return;
+        case KW_MAP_KEYS: unary(OP_MAP_KEYS, "'map_keys' requires 1 argument (map), but received " + arg_count(list) + "."); return;
+        case KW_MAP_SIZE: unary(OP_MAP_SIZE, "'map_size' requires 1 argument (map), but received " + arg_count(list) + "."); return;
+        case KW_ARRAY_MAP: binary(OP_ARRAY_MAP, "'array_map' requires 2 arguments (function, array), but received " + arg_count(list) + "."); return;
+        case KW_SYS_ASYNC: unary(OP_SYS_ASYNC, "'sys_async' requires 1 argument (a command string), but received " + arg_count(list) + "."); return;
+        case KW_AWAIT: unary(OP_AWAIT, "'await' requires 1 argument (process handle), but received " + arg_count(list) + "."); return;
+        case KW_SYS_STATUS: unary(OP_SYS_STATUS, "'sys_status' requires 1 argument (process handle), but received " + arg_count(list) + "."); return;
+        case KW_SYS_STDERR: unary(OP_SYS_STDERR, "'sys_stderr' requires 1 argument (process handle), but received " + arg_count(list) + "."); return;
+        default: return;
+    }
+}
+
+// Lancuch infiksowy (a op b op c ...), pierwszy element juz jest na stosie
+static void compile_infix(const Ast& ast, span<const Node> list, Scope& scope) {
+    Chunk& chunk = *scope.chunk;
+    for (size_t i = 1; i < list.size(); i += 2) {
+        if (list[i].is_list()) { emit_throw(chunk, "Syntax error: Expected an operator."); return; }
+        const Token& op_token = list[i].token;
+        if (i + 1 >= list.size()) { emit_throw(chunk, "Syntax error: Missing right operand for operator '" + string(token_text(op_token)) + "'."); return; }
+        compile_expression(ast, list[i + 1], scope);
+        InfixOp op = infix_op_of(op_token);
+        if (op == INFIX_UNKNOWN) emit(chunk, OP_UNKNOWN_OP, add_name(chunk, string(token_text(op_token))));
+        else emit(chunk, (OpCode)(OP_ADD + (uint32_t)op));
+    }
+}
+
+static void compile_list(const Ast& ast, span<const Node> list, Scope& scope, bool tail) {
+    Chunk& chunk = *scope.chunk;
+    if (list.empty()) { emit(chunk, OP_NIL); return; }
+
+    if (list[0].token.type == TOKEN_IDENTIFIER && is_keyword(list[0].token.symbol)) {
+        compile_keyword(ast, list[0].token.symbol, list, scope, tail);
+        return;
+    }
+
+    compile_expression(ast, list[0], scope);
+
+    // Liczba albo string na poczatku nigdy nie bedzie funkcja - od razu lancuch infiksowy
+    bool head_is_literal = list[0].token.type == TOKEN_NUMBER || list[0].token.type == TOKEN_STRING;
+    if (head_is_literal) { compile_infix(ast, list, scope); return; }
+
+    // To czy mamy wywolanie, czy dzialanie, wiadomo dopiero gdy poznamy wartosc pierwszego elementu.
+    // Kompilujemy obie wersje: wywolanie zaraz za OP_CALL_OR_JUMP, infiks pod celem skoku.
+    emit(chunk, OP_CALL_OR_JUMP, list.size() - 1);
+    chunk.code.push_back(0);
+    size_t to_infix = chunk.code.size() - 1;
+
+    bool call_fails = false;
+    for (size_t i = 1; i < list.size(); ++i) {
+        // Operator jako argument wywolania zawsze konczy sie bledem, dalej nie ma po co kompilowac
+        if (list[i].token.type == TOKEN_OPERATOR) {
+            emit_throw(chunk, CRITICAL_ERROR);
+            call_fails = true;
+            break;
+        }
+        compile_expression(ast, list[i], scope);
+    }
+    size_t to_end = 0;
+    if (!call_fails) {
+        emit(chunk, tail ? OP_TAIL_CALL : OP_CALL, list.size() - 1);
+        to_end = emit_jump(chunk, OP_JUMP);
+    }
+
+    patch_jump(chunk, to_infix);
+    compile_infix(ast, list, scope);
+    if (!call_fails) patch_jump(chunk, to_end);
+}
+
+static void compile_expression(const Ast& ast, const Node& node, Scope& scope, bool tail) {
+    Chunk& chunk = *scope.chunk;
+    if (node.is_list()) {
+        compile_list(ast, ast.list(node), scope, tail);
+        return;
+    }
+
+    const Token& token = node.token;
+    switch (token.type) {
+        case TOKEN_NUMBER: {
+            // Liczby dekodujemy raz, przy kompilacji (albo juz zrobil to optymalizator).
+            // Za duza liczba to blad dopiero w czasie wykonania.
+            if (token.constant.type() == TYPE_NUMBER) {
+                emit(chunk, OP_CONST, add_constant(chunk, token.constant));
+                break;
+            }
+            try {
+                emit(chunk, OP_CONST, add_constant(chunk, Value::number(stoll(string(token.text)))));
+            } catch (const exception& e) {
+                emit_throw(chunk, e.what());
+            }
+            break;
+        }
+        case TOKEN_STRING:
+            emit(chunk, OP_CONST, add_constant(chunk, token.constant.type() == TYPE_STRING ? token.constant : Value::string(token.text)));
+            break;
+        case TOKEN_IDENTIFIER: {
+            VarRef ref = resolve(scope, token.symbol);
+            emit(chunk, ref.kind == VarRef::LOCAL ? OP_LOAD_LOCAL : OP_LOAD_CAPTURE, ref.index);
+            break;
+        }
+        default:
+            emit_throw(chunk, CRITICAL_ERROR);
+            break;
+    }
+}
+
+shared_ptr<Chunk> compile(const Ast& ast) {
+    span<const Node> program = ast.program();
+    auto chunk = make_shared<Chunk>();
+    Scope scope;
+    scope.chunk = chunk.get();
+    vector<Symbol> globals;
+    for (const Node& node : program) collect_locals(ast, node, globals);
+    declare_locals(scope, {}, globals);
+
+    for (size_t i = 0; i < program.size(); ++i) {
+        if (i > 0) emit(*chunk, OP_POP);
+        compile_expression(ast, program[i], scope);
+    }
+    if (program.empty()) emit(*chunk, OP_NIL);
+    emit(*chunk, OP_RETURN);
+    return chunk;
+}
+
+uint32_t instruction_size(uint32_t op) {
+    switch (op) {
+        case OP_NIL: case OP_POP: case OP_RETURN:
+        case OP_NUMBER: case OP_STRING: case OP_TYPEOF: case OP_LEN: case OP_GET:
+        case OP_SYS: case OP_RANDOM: case OP_ORD: case OP_CHR:
+        case OP_FILE_READ: case OP_FILE_WRITE: case OP_FILE_OPEN: case OP_FILE_LINE: case OP_FILE_EOF: case OP_FILE_CLOSE:
+        case OP_SYS_ASYNC: case OP_AWAIT: case OP_SYS_STATUS: case OP_SYS_STDERR:
+        case OP_PMAP: case OP_JOIN:
+        case OP_ARRAY_PUSH: case OP_ARRAY_SLICE: case OP_ARRAY_SUM: case OP_ARRAY_MIN: case OP_ARRAY_MAX: case OP_ARRAY_FILL: case OP_ARRAY_MAP:
+        case OP_MAP_PUT: case OP_MAP_DELETE: case OP_MAP_GET: case OP_MAP_HAS: case OP_MAP_KEYS: case OP_MAP_SIZE: case OP_NATIVE: return 1;
+        case OP_LOOP: case OP_CALL_OR_JUMP: return 3;
+        default: return (op >= OP_ADD && op <= OP_NE_STR) ? 1 : 2;
+    }
+}
@@ -0,0 +1,127 @@
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include "types.hpp"
+
+#include <cstdint>
+#include <functional>
+
+// Lista wszystkich instrukcji maszyny wirtualnej.
+// Trzymamy ja w jednym makrze, zeby enum i tablica skokow w vm.cpp zawsze mialy ta sama kolejnosc.
+// W komentarzu: argumenty zapisane w kodzie zaraz za instrukcja.
+#define BRACKET_OPCODES(X) \
+    X(OP_CONST)          /* k: wrzuca constants[k] na stos */ \
+    X(OP_NIL)            /* wrzuca nil */ \
+    X(OP_POP)            /* zdejmuje wartosc ze stosu */ \
+    X(OP_LOAD_LOCAL)     /* s: wrzuca zmienna ze slotu s ramki */ \
+    X(OP_LOAD_CAPTURE)   /* c: wrzuca wartosc c z domkniecia aktualnej funkcji */ \
+    X(OP_DEF_LOCAL)      /* s: zapisuje szczyt stosu do slotu s, wartosc zostaje na stosie */ \
+    X(OP_SET_LOCAL)      /* s: (idx znak) -> zmienia znak w zmiennej ze slotu s, wrzuca jej nowa wartosc */ \
+    X(OP_JUMP)           /* cel: skok bezwarunkowy */ \
+    X(OP_JUMP_IF_FALSE)  /* cel: zdejmuje warunek, skacze jesli jest falszywy */ \
+    X(OP_LOOP)           /* cel p: skok na poczatek petli, p to numer petli w Chunk::loops (licznik dla JIT-a) */ \
+    X(OP_MAKE_FUN)       /* f: tworzy funkcje z functions[f] i domkniecia */ \
+    X(OP_CALL_OR_JUMP)   /* n cel: funkcja na stosie? sprawdza liczbe argumentow. Inaczej skacze do wersji infiksowej */ \
+    X(OP_CALL)           /* n: wywoluje funkcje z n argumentami */ \
+    X(OP_TAIL_CALL)      /* n: jak OP_CALL, ale na miejscu ramki aktualnej funkcji (wywolanie na koncu ciala) */ \
+    X(OP_RETURN)         /* konczy aktualna funkcje (albo caly program) */ \
+    X(OP_ADD) X(OP_SUB) X(OP_MUL) X(OP_DIV) X(OP_MOD) \
+    X(OP_EQ) X(OP_NE) X(OP_GT) X(OP_LT) X(OP_GE) X(OP_LE) \
+    /* Wersje operatorow dla konkretnych typow. Kompilator ich nie emituje - maszyna wirtualna sama \
+       podmienia na nie OP_ADD..OP_LE, gdy zobaczy takie typy, i wraca do ogolnej wersji gdy typy sie zmienia. \
+       Liczbowe ida w tej samej kolejnosci co OP_ADD..OP_LE. */ \
+    X(OP_ADD_NUM) X(OP_SUB_NUM) X(OP_MUL_NUM) X(OP_DIV_NUM) X(OP_MOD_NUM) \
+    X(OP_EQ_NUM) X(OP_NE_NUM) X(OP_GT_NUM) X(OP_LT_NUM) X(OP_GE_NUM) X(OP_LE_NUM) \
+    X(OP_ADD_STR)        /* string + cokolwiek: doklejanie */ \
+    X(OP_EQ_STR) X(OP_NE_STR) \
+    X(OP_UNKNOWN_OP)     /* n: operator o nazwie names[n], ktorego nie znamy - zawsze blad */ \
+    X(OP_PRINT)          /* n: wypisuje n wartosci ze stosu */ \
+    X(OP_INPUT)          /* n: 0 albo 1 (z zacheta) */ \
+    X(OP_NUMBER) X(OP_STRING) X(OP_TYPEOF) X(OP_LEN) X(OP_GET) \
+    X(OP_SYS) X(OP_RANDOM) X(OP_ORD) X(OP_CHR) \
+    X(OP_FILE_READ) X(OP_FILE_WRITE) X(OP_FILE_OPEN) X(OP_FILE_LINE) X(OP_FILE_EOF) X(OP_FILE_CLOSE) \
+    X(OP_SYS_ASYNC) X(OP_AWAIT) X(OP_SYS_STATUS) X(OP_SYS_STDERR) \
+    X(OP_PMAP) X(OP_JOIN) \
+    X(OP_SPAWN)          /* n: (funkcja argumenty...) - n wartosci ze stosu, wrzuca uchwyt zadania */ \
+    X(OP_ARRAY)          /* n: tablica z n wartosci ze stosu */ \
+    X(OP_ARRAY_PUSH) X(OP_ARRAY_SLICE) X(OP_ARRAY_SUM) X(OP_ARRAY_MIN) X(OP_ARRAY_MAX) X(OP_ARRAY_FILL) X(OP_ARRAY_MAP) \
+    X(OP_MAP)            /* n: slownik z n wartosci ze stosu (klucz, wartosc, klucz...) */ \
+    X(OP_MAP_PUT) X(OP_MAP_DELETE) \
+    X(OP_MAP_PUT_LOCAL)  /* s: (slownik klucz wartosc) -> (def s (map_put ...)), w miejscu, jesli slownik to wartosc slotu s */ \
+    X(OP_MAP_DELETE_LOCAL) /* s: (slownik klucz) -> to samo dla map_delete */ \
+    X(OP_MAP_GET) X(OP_MAP_HAS) X(OP_MAP_KEYS) X(OP_MAP_SIZE) \
+    X(OP_NATIVE)         /* cialo funkcji z C++ (bracket.hpp): wola Chunk::native z parametrami z ramki i wrzuca wynik */ \
+    X(OP_THROW)          /* k: rzuca blad z tekstem constants[k] */
+
+enum OpCode : uint32_t {
+#define BRACKET_OPCODE_ENUM(name) name,
+    BRACKET_OPCODES(BRACKET_OPCODE_ENUM)
+#undef BRACKET_OPCODE_ENUM
+    OP_COUNT
+};
+
+// Skad nowa funkcja kopiuje wartosc do domkniecia: ze slotu ramki albo z domkniecia funkcji, w ktorej powstaje
+struct CaptureSource {
+    bool from_local;
+    uint32_t index;
+};
+
+struct JitCode;
+
+// Pozycja w zrodle, ktorej nie znamy (np. wezel stworzony przez optymalizator)
+constexpr uint32_t NO_SOURCE_OFFSET = UINT32_MAX;
+
+// Licznik wykonan petli albo ciala funkcji dla JIT-a (--jit) i jej skompilowany kod, gdy juz jest
+struct JitProfile {
+    uint32_t start = 0;            // zakres instrukcji [start, end)
+    uint32_t end = 0;
+    uint32_t counter = 0;
+    bool failed = false;           // nie dalo sie skompilowac - wiecej nie probujemy
+    shared_ptr<JitCode> code;
+    uint32_t source_offset = NO_SOURCE_OFFSET;  // --profile: gdzie w zrodle stoi 'loop' albo 'fun'
+    uint64_t profile_count = 0;                 // --profile: obroty petli albo wywolania funkcji
+};
+
+// Skompilowany kawalek kodu - caly program albo cialo jednej funkcji.
+// Kod to plaska tablica slow: instrukcja, a za nia jej argumenty.
+struct Chunk {
+    mutable vector<uint32_t> code;        // mutable, bo maszyna wirtualna podmienia w nim operatory na wyspecjalizowane
+    vector<Value> constants;              // stale (liczby i stringi juz zdekodowane)
+    vector<string> names;                 // nazwy nieznanych operatorow
+    vector<shared_ptr<Chunk>> functions;  // ciala funkcji zdefiniowanych w tym kawalku
+
+    // Ramka: najpierw parametry, potem zmienne lokalne. W programie glownym to zmienne globalne.
+    vector<Symbol> locals;
+    uint32_t parameter_count = 0;
+    vector<int32_t> local_init;           // dla slotow za parametrami: numer w domknieciu albo -1 (pusty slot)
+    vector<Symbol> captures;              // nazwy wartosci kopiowanych do domkniecia
+    vector<CaptureSource> capture_from;   // i skad je wziac w chwili tworzenia funkcji
+    uint32_t entry = 0;                   // --emit-cpp: numer ciala funkcji w wygenerowanym programie
+    string name;                          // --profile: nazwa z (def nazwa (fun ...)), pusta dla funkcji anonimowych
+    mutable bool frozen = false;          // pmap/spawn: stale (i stale funkcji w srodku) sa juz zamrozone
+    function<Value(const Value* args, size_t count)> native;  // funkcja z C++ (OP_NATIVE), tylko w pamieci - nie w .blc
+
+    // Stan JIT-a, zmieniany w trakcie wykonania
+    mutable vector<JitProfile> loops;     // kazda petla 'loop' w tym kawalku
+    mutable JitProfile body_profile;      // cale cialo funkcji
+};
+
+// Liczba slow instrukcji (razem z argumentami)
+uint32_t instruction_size(uint32_t op);
+
+// Kompiluje liste wyrazen z parsera do bajtkodu.
+// Wynik kazdego wyrazenia jest zdejmowany, program zwraca wartosc ostatniego.
+shared_ptr<Chunk> compile(const Ast& ast);
@@ -1,316 +1,473 @@
-/**
- * Copyright 2025 KamilMalicki
- *
- * Licensed under the Apache License, Version 2.0 (the "License");
- * you may not use this file except in compliance with the License.
- * You may obtain a copy of the License at
- *
- * http://www.apache.org/licenses/LICENSE-2.0
- *
- * Unless required by applicable law or agreed to in writing, software
- * distributed under the License is distributed on an "AS IS" BASIS,
- * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
- * See the License for the specific language governing permissions and
- * limitations under the License.
- */
-#include "evaluator.hpp"
-
-#include <stdexcept>
-#include <sstream>
-#include <ostream>
-#include <unordered_set>
-#include <cstdio>
-#include <iostream>
-#include <cstdlib>
-#include <random>
-
-// Sprawdza czy wartosc jest "prawdziwa", np. w warunkach if/loop.
-// 0 i pusty string to falsz, reszta to prawda.
-bool is_truthy(const Value& val) {
-    if (val.type == TYPE_NUMBER && get<int_fast64_t>(val.data) == 0) return false;
-    if (val.type == TYPE_STRING && get<string>(val.data).empty()) return false;
-    return true;
-}
-
-// Glowna funkcja wykonujaca kod
-Value evaluate(const Expression& expr, Environment& env) {
-    // Przypadek 1: Wyrazenie to pojedynczy token (atom)
-    if (holds_alternative<Token>(expr.data)) {
-        const Token& token = get<Token>(expr.data);
-        if (token.type == TOKEN_NUMBER) return Value{stoll(token.text), TYPE_NUMBER}; // zwracamy wartosc liczbowa
-        if (token.type == TOKEN_STRING) return Value{token.text, TYPE_STRING}; // zwracamy wartosc tekstowa
-        if (token.type == TOKEN_IDENTIFIER) {
-            // jesli to identyfikator, szukamy go w srodowisku
-            if (env.count(token.text)) return env.at(token.text);
-            throw runtime_error("Undefined variable: '" + token.text + "'.");
-        }
-    }
-
-    // Przypadek 2: Wyrazenie to lista (wywolanie funkcji lub operatora)
-    if (holds_alternative<ExpressionList>(expr.data)) {
-        const ExpressionList& list = get<ExpressionList>(expr.data);
-        if (list.empty()) return Value{}; // pusta lista zwraca nil
-
-        // Sprawdzamy, czy pierwszy element listy to slowo kluczowe
-        if (holds_alternative<Token>(list[0].data) && get<Token>(list[0].data).type == TOKEN_IDENTIFIER) {
-            string const& keyword = get<Token>(list[0].data).text;
-
-            // Zbiór slow kluczowych dla szybkiego sprawdzania
-            static const unordered_set<string> keywords = {
-                "def", "print", "if", "loop","do",
-                "String", "Number", "typeof", "fun", "input",
-                "len", "get", "set", "sys", "random", "ord", "chr",
-
-                // on nie jest normalnym słowem kluczowym on jest tylko poto aby go wyłapał ale nie jest jak print albo def
-                "_index_op" // Dodajemy nasz wewnętrzny operator do rozpoznawanych słów
-            };
-
-            if (keywords.count(keyword)) {
-                // Bezpośrednio obsługujemy wewnętrzny operator _index_op
-                if (keyword == "_index_op") {
-                    if (list.size() != 3) throw runtime_error("Invalid syntax for index operator '.");
-                    // Parser tworzy listę w formacie (_index_op <index> <string>)
-                    // więc pobieramy argumenty we właściwej kolejności.
-                    Value str_val = evaluate(list[2], env); // String jest na 3. pozycji (indeks 2)
-                    if (str_val.type != TYPE_STRING) throw runtime_error("Type error: The argument to index operator ' must be a string.");
-
-                    Value idx_val = evaluate(list[1], env); // Index jest na 2. pozycji (indeks 1)
-                    if (idx_val.type != TYPE_NUMBER) throw runtime_error("Type error: The index for operator ' must be a number.");
-
-                    const string& str = get<string>(str_val.data);
-                    int_fast64_t idx = get<int_fast64_t>(idx_val.data);
-
-                    if (idx < 0 || idx >= str.length()) throw runtime_error("Index out of bounds for operator '.");
-
-                    return Value{string(1, str[idx]), TYPE_STRING};
-                }
-
-                // obsluga 'def' - tworzenie nowej zmiennej w srodowisku
-                if (keyword == "def") {
-                    if (list.size() != 3) throw runtime_error("'def' requires 2 arguments (name, value), but received " + to_string(list.size() - 1) + ".");
-                    const string& var_name = get<Token>(list[1].data).text;
-                    Value var_value = evaluate(list[2], env);
-                    env[var_name] = var_value;
-                    return var_value;
-                }
-                // obsluga 'print' - wypisuje wartosci na ekran
-                if (keyword == "print") {
-                    stringstream ss;
-                    for (size_t i = 1; i < list.size(); ++i) ss << value_to_string(evaluate(list[i], env));
-                    cout << ss.str();
-                    return Value{};
-                }
-                // obsluga 'if' - warunek, jesli prawda to wykonuje druga czesc
-                if (keyword == "if") {
-                    if (list.size() != 3) throw runtime_error("'if' requires 2 arguments (condition, body), but received " + to_string(list.size() - 1) + ".");
-                    if (is_truthy(evaluate(list[1], env))) return evaluate(list[2], env);
-                    return Value{};
-                }
-                // obsluga 'loop' - petla while, wykonuje cialo dopoki warunek jest prawdziwy
-                if (keyword == "loop") {
-                    if (list.size() != 3) throw runtime_error("'loop' requires 2 arguments (condition, body), but received " + to_string(list.size() - 1) + ".");
-                    Value last_val = {};
-                    while (is_truthy(evaluate(list[1], env))) last_val = evaluate(list[2], env);
-                    return last_val;
-                }
-                // obsluga 'do' - wykonuje sekwencje wyrazen i zwraca wartosc ostatniego
-                if (keyword == "do") {
-                    Value last_val = {};
-                    for (size_t i = 1; i < list.size(); ++i) last_val = evaluate(list[i], env);
-                    return last_val;
-                }
-                // obsluga 'fun' - tworzenie nowej funkcji
-                if (keyword == "fun") {
-                    if (list.size() != 3) throw runtime_error("'fun' requires 2 arguments (parameters, body), but received " + to_string(list.size() - 1) + ".");
-                    const ExpressionList& params_list = get<ExpressionList>(list[1].data);
-                    vector<string> params;
-                    for (const auto& param_expr : params_list) params.push_back(get<Token>(param_expr.data).text);
-                    auto body_ptr = make_shared<Expression>(list[2]);
-                    BraceFunction func = {params, body_ptr, make_shared<Environment>(env)};
-                    return Value{func, TYPE_FUNCTION};
-                }
-                // obsluga 'input' - czyta linie z konsoli
-                if (keyword == "input") {
-                    if (list.size() > 2) throw runtime_error("'input' takes 0 or 1 arguments, but received " + to_string(list.size() - 1) + ".");
-                    if (list.size() == 2) cout << value_to_string(evaluate(list[1], env)) << flush;
-                    string line;
-                    getline(cin, line);
-                    if (!line.empty() && line.back() == '\r') line.pop_back();
-                    return Value{line, TYPE_STRING};
-                }
-                // Konwersja na liczbe
-                if (keyword == "Number") {
-                    if (list.size() != 2) throw runtime_error("'Number' requires 1 argument, but received " + to_string(list.size() - 1) + ".");
-                    Value val = evaluate(list[1], env);
-                    if (val.type == TYPE_STRING) return Value{stoll(get<string>(val.data)), TYPE_NUMBER};
-                    return val;
-                }
-                // Konwersja na string
-                if (keyword == "String") {
-                    if (list.size() != 2) throw runtime_error("'String' requires 1 argument, but received " + to_string(list.size() - 1) + ".");
-                    return Value{value_to_string(evaluate(list[1], env)), TYPE_STRING};
-                }
-                // Sprawdzenie typu wartosci
-                if (keyword == "typeof") {
-                     if (list.size() != 2) throw runtime_error("'typeof' requires 1 argument, but received " + to_string(list.size() - 1) + ".");
-                     Value val = evaluate(list[1], env);
-                     if (val.type == TYPE_NUMBER) return Value{"number", TYPE_STRING};
-                     if (val.type == TYPE_STRING) return Value{"string", TYPE_STRING};
-                     if (val.type == TYPE_FUNCTION) return Value{"function", TYPE_STRING};
-                     return Value{"nil", TYPE_STRING};
-                }
-                // Dlugosc stringa
-                if (keyword == "len") {
-                    if (list.size() != 2) throw runtime_error("'len' requires 1 argument (string), but received " + to_string(list.size() - 1) + ".");
-                    Value val = evaluate(list[1], env);
-                    if (val.type != TYPE_STRING) throw runtime_error("Type error: 'len' only operates on strings.");
-                    return Value{(int_fast64_t)get<string>(val.data).length(), TYPE_NUMBER};
-                }
-                // Pobranie znaku ze stringa
-                if (keyword == "get") {
-                    if (list.size() != 3) throw runtime_error("'get' requires 2 arguments (string, index), but received " + to_string(list.size() - 1) + ".");
-                    Value str_val = evaluate(list[1], env);
-                    if (str_val.type != TYPE_STRING) throw runtime_error("Type error: The first argument to 'get' must be a string.");
-                    Value idx_val = evaluate(list[2], env);
-                    if (idx_val.type != TYPE_NUMBER) throw runtime_error("Type error: The second argument to 'get' must be a number (index).");
-                    const string& str = get<string>(str_val.data);
-                    int_fast64_t idx = get<int_fast64_t>(idx_val.data);
-                    if (idx < 0 || idx >= str.length()) throw runtime_error("Index out of bounds.");
-                    return Value{string(1, str[idx]), TYPE_STRING};
-                }
-                // Ustawienie znaku w stringu (modyfikuje zmienna!)
-                if (keyword == "set") {
-                    if (list.size() != 4) throw runtime_error("'set' requires 3 arguments (identifier, index, value), but received " + to_string(list.size() - 1) + ".");
-                    if (!holds_alternative<Token>(list[1].data) || get<Token>(list[1].data).type != TOKEN_IDENTIFIER) throw runtime_error("Type error: The first argument to 'set' must be a variable identifier.");
-                    const string& var_name = get<Token>(list[1].data).text;
-                    if (env.find(var_name) == env.end() || env.at(var_name).type != TYPE_STRING) throw runtime_error("Type error: Variable for 'set' must exist and be a string.");
-                    Value idx_val = evaluate(list[2], env);
-                    if (idx_val.type != TYPE_NUMBER) throw runtime_error("Type error: The second argument to 'set' must be a number (index).");
-                    Value new_char_val = evaluate(list[3], env);
-                    if (new_char_val.type != TYPE_STRING || get<string>(new_char_val.data).length() != 1) throw runtime_error("Type error: The third argument to 'set' must be a single-character string.");
-                    int_fast64_t idx = get<int_fast64_t>(idx_val.data);
-                    string& original_str = get<string>(env.at(var_name).data);
-                    if (idx < 0 || idx >= original_str.length()) throw runtime_error("Index for 'set' is out of bounds.");
-                    original_str[idx] = get<string>(new_char_val.data)[0];
-                    return env.at(var_name);
-                }
-                // Wykonanie komendy systemowej
-                if (keyword == "sys") {
-                    if (list.size() != 2) throw runtime_error("'sys' requires 1 argument (a command string), but received " + to_string(list.size() - 1) + ".");
-                    Value cmd_val = evaluate(list[1], env);
-                    if (cmd_val.type != TYPE_STRING) throw runtime_error("Type error: The argument for 'sys' must be a string.");
-
-                    string command = get<string>(cmd_val.data);
-                    string result = "";
-                    char buffer[128];
-
-                    FILE* pipe = popen(command.c_str(), "r"); // popen to funkcja C do takich rzeczy
-                    if (!pipe) throw runtime_error("Failed to execute system command.");
-
-                    while (fgets(buffer, sizeof(buffer), pipe) != nullptr) result += buffer;
-
-                    pclose(pipe);
-                    return Value{result, TYPE_STRING};
-                }
-                // Generowanie liczby losowej z przedzialu
-                if (keyword == "random") {
-                    if (list.size() != 3) throw runtime_error("'random' requires 2 arguments (min, max), but received " + to_string(list.size() - 1) + ".");
-                    Value min_arg = evaluate(list[1], env);
-                    Value max_arg = evaluate(list[2], env);
-
-                    if (min_arg.type != TYPE_NUMBER || max_arg.type != TYPE_NUMBER) throw runtime_error("Type error: Arguments for 'random' must be numbers.");
-
-                    int_fast64_t min_val = get<int_fast64_t>(min_arg.data);
-                    int_fast64_t max_val = get<int_fast64_t>(max_arg.data);
-
-                    if (min_val > max_val) throw runtime_error("First argument to 'random' cannot be greater than the second argument.");
-
-                    static std::mt19937 gen(std::random_device{}());
-                    std::uniform_int_distribution<int_fast64_t> distrib(min_val, max_val);
-
-                    return Value{distrib(gen), TYPE_NUMBER};
-                }
-                // Zwraca kod ASCII pierwszego znaku w stringu
-                if (keyword == "ord") {
-                    if (list.size() != 2) throw runtime_error("'ord' requires 1 argument (string).");
-                    Value val = evaluate(list[1], env);
-                    if (val.type != TYPE_STRING || get<string>(val.data).empty()) {
-                        throw runtime_error("Argument for 'ord' must be a non-empty string.");
-                    }
-                    return Value{(int_fast64_t)(get<string>(val.data)[0]), TYPE_NUMBER};
-                }
-                // Zwraca jednoznakowy string dla podanego kodu ASCII
-                if (keyword == "chr") {
-                    if (list.size() != 2) throw runtime_error("'chr' requires 1 argument (number).");
-                    Value val = evaluate(list[1], env);
-                    if (val.type != TYPE_NUMBER) {
-                        throw runtime_error("Argument for 'chr' must be a number.");
-                    }
-                    string s(1, (char)get<int_fast64_t>(val.data));
-                    return Value{s, TYPE_STRING};
-                }
-            }
-        }
-
-        // Jesli to nie bylo slowo kluczowe, to pewnie wywolanie funkcji
-        Value first_val = evaluate(list[0], env);
-
-        if (first_val.type == TYPE_FUNCTION) {
-            const BraceFunction& func = get<BraceFunction>(first_val.data);
-            if (func.parameters.size() != list.size() - 1) throw runtime_error("Incorrect number of arguments for function call. Expected " + to_string(func.parameters.size()) + ", but got " + to_string(list.size() - 1) + ".");
-
-            Environment call_env = *func.closure_env;
-            for (size_t i = 0; i < func.parameters.size(); ++i) call_env[func.parameters[i]] = evaluate(list[i + 1], env);
-            return evaluate(*func.body, call_env);
-        }
-
-        // Jesli to nie funkcja, to musi byc operator jak + - * /
-        Value result = first_val;
-        for (size_t i = 1; i < list.size(); i += 2) {
-            const Token& op = get<Token>(list[i].data);
-            Value rhs = evaluate(list[i+1], env);
-
-            if (op.text == "+") {
-                if (result.type == TYPE_STRING || rhs.type == TYPE_STRING) {
-                    result.data = value_to_string(result) + value_to_string(rhs);
-                    result.type = TYPE_STRING;
-                } else {
-                    result.data = get<int_fast64_t>(result.data) + get<int_fast64_t>(rhs.data);
-                    result.type = TYPE_NUMBER;
-                }
-                continue;
-            }
-
-            if (op.text == "==") {
-                result.data = (int_fast64_t)(value_to_string(result) == value_to_string(rhs));
-                result.type = TYPE_NUMBER;
-                continue;
-            }
-            if (op.text == "!=") {
-                result.data = (int_fast64_t)(value_to_string(result) != value_to_string(rhs));
-                result.type = TYPE_NUMBER;
-                continue;
-            }
-
-            if (result.type != TYPE_NUMBER || rhs.type != TYPE_NUMBER) throw runtime_error("Type error: Operator '" + op.text + "' requires numeric operands.");
-
-            int_fast64_t left_num = get<int_fast64_t>(result.data);
-            int_fast64_t right_num = get<int_fast64_t>(rhs.data);
-
-            if (op.text == "-") result.data = left_num - right_num;
-            else if (op.text == "*") result.data = left_num * right_num;
-            else if (op.text == "/") { if(right_num == 0) throw runtime_error("Division by zero."); result.data = left_num / right_num; }
-            else if (op.text == "%") { if(right_num == 0) throw runtime_error("Division by zero."); result.data = left_num % right_num; }
-            else if (op.text == ">") result.data = (int_fast64_t)(left_num > right_num);
-            else if (op.text == "<") result.data = (int_fast64_t)(left_num < right_num);
-            else if (op.text == ">=") result.data = (int_fast64_t)(left_num >= right_num);
-            else if (op.text == "<=") result.data = (int_fast64_t)(left_num <= right_num);
-            else throw runtime_error("Unknown operator: " + op.text);
-
-            result.type = TYPE_NUMBER;
-        }
-        return result;
-    }
-
-    throw runtime_error("Critical error: Failed to interpret expression.");
-}
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "evaluator.hpp"
+
+#include "builtins.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+// Evaluator drzewa wywoluje sam siebie, wiec oprocz --max-depth ogranicza go stos C++.
+// Zamiast segfaulta sprawdzamy, ile stosu juz zajelismy, i zglaszamy zwykly blad.
+static size_t native_stack_budget() {
+    size_t size = 1 << 20; // tyle daje Windows
+#ifndef _WIN32
+    rlimit limit;
+    size = 8 << 20;
+    if (getrlimit(RLIMIT_STACK, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY) size = limit.rlim_cur;
+#endif
+    // Zapas na reszte programu i obsluge bledu
+    return size - min(size / 2, (size_t)256 << 10);
+}
+
+static void check_native_stack() {
+    static const size_t budget = native_stack_budget();
+    static thread_local uintptr_t base = 0;
+    char marker;
+    uintptr_t here = (uintptr_t)&marker;
+    if (!base) base = here;
+    size_t used = base > here ? base - here : here - base;
+    if (used > budget) throw runtime_error("Stack overflow: expressions are nested too deeply.");
+}
+
+// Liczba funkcji wykonywanych w tej chwili. Jedno wywolanie evaluate to najwyzej jedna ramka -
+// kolejne wywolania na koncu ciala funkcji zastepuja poprzednie w tej samej petli.
+static thread_local size_t call_depth = 0;
+
+struct CallDepth {
+    bool entered = false;
+    void enter() {
+        if (entered) return;
+        if (call_depth >= max_call_depth) throw_stack_overflow();
+        ++call_depth;
+        entered = true;
+    }
+    ~CallDepth() { if (entered) --call_depth; }
+};
+
+// Identyfikatory w ciele funkcji - kazdy z nich moze byc zmienna z otoczenia.
+// Pomijamy tylko slowo kluczowe na poczatku listy, bo tam nigdy nie jest czytane jako zmienna.
+// Gdzie indziej nazwa wbudowanej funkcji moze byc zwykla zmienna: (def print 5) (fun () (print print)).
+static void collect_names(const Ast& tree, const Node& node, vector<Symbol>& names) {
+    if (!node.is_list()) {
+        if (node.token.type == TOKEN_IDENTIFIER) names.push_back(node.token.symbol);
+        return;
+    }
+    span<const Node> list = tree.list(node);
+    for (size_t i = 0; i < list.size(); ++i) {
+        if (i == 0 && !list[0].is_list() && list[0].token.type == TOKEN_IDENTIFIER && is_keyword(list[0].token.symbol)) continue;
+        collect_names(tree, list[i], names);
+    }
+}
+
+// Nazwy, ktore domkniecie funkcji bierze z otoczenia: wszystko, czego moze uzyc cialo, bez parametrow.
+// Reszty srodowiska funkcja i tak nigdy nie zobaczy, wiec nie kopiujemy jej przy kazdym 'fun'.
+static const vector<Symbol>& closure_names(const Ast& tree, NodeId fun, const vector<Symbol>& params) {
+    auto [it, added] = tree.closure_names.try_emplace(fun);
+    if (added) {
+        vector<Symbol>& names = it->second;
+        collect_names(tree, tree[tree[fun].child(2)], names);
+        sort(names.begin(), names.end());
+        names.erase(unique(names.begin(), names.end()), names.end());
+        erase_if(names, [&](Symbol name) { return find(params.begin(), params.end(), name) != params.end(); });
+    }
+    return it->second;
+}
+
+// Srodowisko wywolania na start: tylko wartosci z domkniecia (parametry dopisuje wywolujacy)
+static Environment closure_environment(const BraceFunction& func) {
+    Environment env;
+    env.reserve(func.captures.size() + func.parameters.size());
+    for (size_t i = 0; i < func.captures.size(); ++i) env.emplace(func.capture_names[i], func.captures[i]);
+    return env;
+}
+
+// Glowna funkcja wykonujaca kod
+Value evaluate(const Ast& start_ast, NodeId start, Environment& start_env) {
+    check_native_stack();
+
+    // Wyrazenie w pozycji ogonowej (cialo 'if', ostatni element 'do', cialo wywolanej funkcji)
+    // nie wchodzi glebiej w rekurencje - podmieniamy wyrazenie i srodowisko i krecimy petle.
+    const Ast* current_ast = &start_ast;
+    NodeId current = start;
+    Environment* current_env = &start_env;
+    unique_ptr<Environment> tail_env;  // srodowisko wywolanej funkcji (tworzone dopiero przy pierwszym wywolaniu)
+    Value tail_function;   // i ona sama, zeby jej cialo zylo dopoki je wykonujemy
+    CallDepth depth;
+
+    for (;;) {
+        const Ast& tree = *current_ast;
+        const Node& node = tree[current];
+        Environment& env = *current_env;
+
+        // Przypadek 1: Wyrazenie to pojedynczy token (atom)
+        if (!node.is_list()) {
+            const Token& token = node.token;
+            if (token.type == TOKEN_NUMBER || token.type == TOKEN_STRING) {
+                // Stala zdekodowana juz przez optymalizator (albo przez lexer)
+                if (token.constant.type() != TYPE_UNDEFINED) return token.constant;
+                if (token.type == TOKEN_NUMBER) return Value::number(stoll(string(token.text))); // zwracamy wartosc liczbowa
+                return Value::string(token.text); // zwracamy wartosc tekstowa
+            }
+            if (token.type == TOKEN_IDENTIFIER) {
+                // jesli to identyfikator, szukamy go w srodowisku (po symbolu, bez haszowania stringa)
+                auto it = env.find(token.symbol);
+                if (it != env.end()) return it->second;
+                throw runtime_error("Undefined variable: '" + string(token.text) + "'.");
+            }
+        }
+
+        // Przypadek 2: Wyrazenie to lista (wywolanie funkcji lub operatora)
+        if (node.is_list()) {
+            span<const Node> list = tree.list(node);
+            if (list.empty()) return Value{}; // pusta lista zwraca nil
+
+            // Sprawdzamy, czy pierwszy element listy to slowo kluczowe.
+            // Slowa kluczowe maja najnizsze numery symboli, wiec wystarczy jedno porownanie i switch.
+            if (list[0].token.type == TOKEN_IDENTIFIER && is_keyword(list[0].token.symbol)) {
+                switch ((PredefinedSymbol)list[0].token.symbol) {
+                    // obsluga 'def' - tworzenie nowej zmiennej w srodowisku
+                    case KW_DEF: {
+                        if (list.size() != 3) throw runtime_error("'def' requires 2 arguments (name, value), but received " + to_string(list.size() - 1) + ".");
+                        if (list[1].is_list()) throw runtime_error("Syntax error: The first argument to 'def' must be a name.");
+                        Symbol var_name = name_symbol(list[1].token);
+                        // (def m (map_put m k v)) - slownik zmieniany w zmiennej, bez kopii (jak OP_MAP_PUT_LOCAL)
+                        span<const Node> value = list[2].is_list() ? tree.list(list[2]) : span<const Node>{};
+                        if (value.size() >= 3 && value[0].token.type == TOKEN_IDENTIFIER && !value[1].is_list() &&
+                            value[1].token.type == TOKEN_IDENTIFIER && value[1].token.symbol == var_name &&
+                            ((value[0].token.symbol == KW_MAP_PUT && value.size() == 4) || (value[0].token.symbol == KW_MAP_DELETE && value.size() == 3))) {
+                            const Node& call = tree[node.child(2)];
+                            Value map = evaluate(tree, call.child(1), env);
+                            Value key = evaluate(tree, call.child(2), env);
+                            Value item = value.size() == 4 ? evaluate(tree, call.child(3), env) : Value{};
+                            Value& target = env[var_name];
+                            if (value.size() == 4) builtin_map_put_into(target, move(map), key, item);
+                            else builtin_map_delete_into(target, move(map), key);
+                            return target;
+                        }
+                        Value var_value = evaluate(tree, node.child(2), env);
+                        env[var_name] = var_value;
+                        return var_value;
+                    }
+                    // obsluga 'print' - wypisuje wartosci na ekran
+                    case KW_PRINT: {
+                        vector<Value> args;
+                        for (size_t i = 1; i < list.size(); ++i) args.push_back(evaluate(tree, node.child(i), env));
+                        builtin_print(args.data(), args.size());
+                        return Value{};
+                    }
+                    // obsluga 'if' - warunek, jesli prawda to wykonuje druga czesc
+                    case KW_IF: {
+                        if (list.size() != 3) throw runtime_error("'if' requires 2 arguments (condition, body), but received " + to_string(list.size() - 1) + ".");
+                        if (!is_truthy(evaluate(tree, node.child(1), env))) return Value{};
+                        current = node.child(2);
+                        continue;
+                    }
+                    // obsluga 'loop' - petla while, wykonuje cialo dopoki warunek jest prawdziwy
+                    case KW_LOOP: {
+                        if (list.size() != 3) throw runtime_error("'loop' requires 2 arguments (condition, body), but received " + to_string(list.size() - 1) + ".");
+                        Value last_val = {};
+                        while (is_truthy(evaluate(tree, node.child(1), env))) last_val = evaluate(tree, node.child(2), env);
+                        return last_val;
+                    }
+                    // obsluga 'do' - wykonuje sekwencje wyrazen i zwraca wartosc ostatniego
+                    case KW_DO: {
+                        if (list.size() == 1) return Value{};
+                        for (size_t i = 1; i + 1 < list.size(); ++i) evaluate(tree, node.child(i), env);
+                        current = node.child(list.size() - 1);
+                        continue;
+                    }
+                    // obsluga 'fun' - tworzenie nowej funkcji
+                    case KW_FUN: {
+                        if (list.size() != 3) throw runtime_error("'fun' requires 2 arguments (parameters, body), but received " + to_string(list.size() - 1) + ".");
+                        if (!list[1].is_list()) throw runtime_error("Syntax error: 'fun' expects a list of parameters.");
+                        vector<Symbol> params;
+                        for (const Node& param : tree.list(list[1])) {
+                            if (param.is_list()) throw runtime_error("Syntax error: 'fun' parameters must be names.");
+                            params.push_back(name_symbol(param.token));
+                        }
+                        // Cialo nie jest kopiowane - funkcja pamieta tylko numer wezla.
+                        // Ze srodowiska bierzemy tylko zmienne, ktorych cialo moze uzyc, tak jak robi to maszyna wirtualna.
+                        BraceFunction* func = new BraceFunction();
+                        for (Symbol name : closure_names(tree, current, params)) {
+                            auto it = env.find(name);
+                            if (it == env.end()) continue;
+                            func->capture_names.push_back(name);
+                            func->captures.push_back(it->second);
+                        }
+                        func->parameters = std::move(params);
+                        func->ast = &tree;
+                        func->body = node.child(2);
+                        return Value::function(func);
+                    }
+                    // obsluga 'input' - czyta linie z konsoli
+                    case KW_INPUT: {
+                        if (list.size() > 2) throw runtime_error("'input' takes 0 or 1 arguments, but received " + to_string(list.size() - 1) + ".");
+                        if (list.size() == 2) {
+                            Value prompt = evaluate(tree, node.child(1), env);
+                            return builtin_input(&prompt);
+                        }
+                        return builtin_input(nullptr);
+                    }
+                    // Konwersja na liczbe
+                    case KW_NUMBER: {
+                        if (list.size() != 2) throw runtime_error("'Number' requires 1 argument, but received " + to_string(list.size() - 1) + ".");
+                        return builtin_number(evaluate(tree, node.child(1), env));
+                    }
+                    // Konwersja na string
+                    case KW_STRING: {
+                        if (list.size() != 2) throw runtime_error("'String' requires 1 argument, but received " + to_string(list.size() - 1) + ".");
+                        return builtin_string(evaluate(tree, node.child(1), env));
+                    }
+                    // Sprawdzenie typu wartosci
+                    case KW_TYPEOF: {
+                         if (list.size() != 2) throw runtime_error("'typeof' requires 1 argument, but received " + to_string(list.size() - 1) + ".");
+                         return builtin_typeof(evaluate(tree, node.child(1), env));
+                    }
+                    // Dlugosc stringa albo tablicy
+                    case KW_LEN: {
+                        if (list.size() != 2) throw runtime_error("'len' requires 1 argument (string or array), but received " + to_string(list.size() - 1) + ".");
+                        return builtin_len(evaluate(tree, node.child(1), env));
+                    }
+                    // Pobranie znaku ze stringa albo elementu tablicy
+                    case KW_GET: {
+                        if (list.size() != 3) throw runtime_error("'get' requires 2 arguments (string or array, index), but received " + to_string(list.size() - 1) + ".");
+                        Value str_val = evaluate(tree, node.child(1), env);
+                        return builtin_get(str_val, evaluate(tree, node.child(2), env));
+                    }
+                    // Ustawienie znaku w stringu albo elementu tablicy (modyfikuje zmienna!)
+                    case KW_SET: {
+                        if (list.size() != 4) throw runtime_error("'set' requires 3 arguments (identifier, index, value), but received " + to_string(list.size() - 1) + ".");
+                        if (list[1].token.type != TOKEN_IDENTIFIER) throw runtime_error("Type error: The first argument to 'set' must be a variable identifier.");
+                        Symbol var_name = list[1].token.symbol;
+                        if (env.find(var_name) == env.end() || (env.at(var_name).type() != TYPE_STRING && env.at(var_name).type() != TYPE_ARRAY)) throw runtime_error("Type error: Variable for 'set' must exist and be a string or array.");
+                        Value idx_val = evaluate(tree, node.child(2), env);
+                        Value new_char_val = evaluate(tree, node.child(3), env);
+                        builtin_set(env.at(var_name), idx_val, new_char_val);
+                        return env.at(var_name);
+                    }
+                    // Wykonanie komendy systemowej
+                    case KW_SYS: {
+                        if (list.size() != 2) throw runtime_error("'sys' requires 1 argument (a command string), but received " + to_string(list.size() - 1) + ".");
+                        return builtin_sys(evaluate(tree, node.child(1), env));
+                    }
+                    // Generowanie liczby losowej z przedzialu
+                    case KW_RANDOM: {
+                        if (list.size() != 3) throw runtime_error("'random' requires 2 arguments (min, max), but received " + to_string(list.size() - 1) + ".");
+                        Value min_arg = evaluate(tree, node.child(1), env);
+                        Value max_arg = evaluate(tree, node.child(2), env);
+                        return builtin_random(min_arg, max_arg);
+                    }
+                    // Zwraca kod ASCII pierwszego znaku w stringu
+                    case KW_ORD: {
+                        if (list.size() != 2) throw runtime_error("'ord' requires 1 argument (string).");
+                        return builtin_ord(evaluate(tree, node.child(1), env));
+                    }
+                    // Zwraca jednoznakowy string dla podanego kodu ASCII
+                    case KW_CHR: {
+                        if (list.size() != 2) throw runtime_error("'chr' requires 1 argument (number).");
+                        return builtin_chr(evaluate(tree, node.child(1), env));
+                    }
+                    // Pliki: caly plik naraz, zapis, albo linia po linii przez uchwyt z file_open
+                    case KW_FILE_READ: {
+                        if (list.size() != 2) throw runtime_error("'file_read' requires 1 argument (path), but received " + to_string(list.size() - 1) + ".");
+                        return builtin_file_read(evaluate(tree, node.child(1), env));
+                    }
+                    case KW_FILE_WRITE: {
+                        if (list.size() != 3) throw runtime_error("'file_write' requires 2 arguments (path, text), but received " + to_string(list.size() - 1) + ".");
+                        Value path = evaluate(tree, node.child(1), env);
+                        Value text = evaluate(tree, node.child(2), env);
+                        return builtin_file_write(path, text);
+                    }
+                    case KW_FILE_OPEN: {
+                        if (list.size() != 2) throw runtime_error("'file_open' requires 1 argument (path), but received " + to_string(list.size() - 1) + ".");
+                        return builtin_file_open(evaluate(tree, node.child(1), env));
+                    }
+                    case KW_FILE_LINE: {
+                        if (list.size() != 2) throw runtime_error("'file_line' requires 1 argument (file handle), but received " + to_string(list.size() - 1) + ".");
+                        return builtin_file_line(evaluate(tree, node.child(1), env));
+                    }
+                    case KW_FILE_EOF: {
+                        if (list.size() != 2) throw runtime_error("'file_eof' requires 1 argument (file handle), but received " + to_string(list.size() - 1) + ".");
+                        return builtin_file_eof(evaluate(tree, node.child(1), env));
+                    }
+                    case KW_FILE_CLOSE: {
+                        if (list.size() != 2) throw runtime_error("'file_close' requires 1 argument (file handle), but received " + to_string(list.size() - 1) + ".");
+                        return builtin_file_close(evaluate(tree, node.child(1), env));
+                    }
+                    // Zadania na wielu watkach - tutaj zawsze po kolei w tym watku (main ustawia pule na jeden watek)
+                    case KW_PMAP: {
+                        if (list.size() != 3) throw runtime_error("'pmap' requires 2 arguments (function, text), but received " + to_string(list.size() - 1) + ".");
+                        Value function = evaluate(tree, node.child(1), env);
+                        Value text = evaluate(tree, node.child(2), env);
+                        return builtin_pmap(function, text);
+                    }
+                    case KW_SPAWN: {
+                        if (list.size() < 2) throw runtime_error("'spawn' requires at least 1 argument (a function), but received 0.");
+                        vector<Value> args;
+                        for (size_t i = 1; i < list.size(); ++i) args.push_back(evaluate(tree, node.child(i), env));
+                        return builtin_spawn(args.data(), args.size());
+                    }
+                    case KW_JOIN: {
+                        if (list.size() != 2) throw runtime_error("'join' requires 1 argument (task handle), but received " + to_string(list.size() - 1) + ".");
+                        return builtin_join(evaluate(tree, node.child(1), env));
+                    }
+                    // Tablice
+                    case KW_ARRAY: {
+                        vector<Value> elements;
+                        for (size_t i = 1; i < list.size(); ++i) elements.push_back(evaluate(tree, node.child(i), env));
+                        return builtin_array(elements.data(), elements.size());
+                    }
+                    case KW_ARRAY_PUSH: {
+                        if (list.size() != 3) throw runtime_error("'array_push' requires 2 arguments (array, value), but received " + to_string(list.size() - 1) + ".");
+                        Value array = evaluate(tree, node.child(1), env);
+                        return builtin_array_push(array, evaluate(tree, node.child(2), env));
+                    }
+                    case KW_ARRAY_SLICE: {
+                        if (list.size() != 4) throw runtime_error("'array_slice' requires 3 arguments (array, start, end), but received " + to_string(list.size() - 1) + ".");
+                        Value array = evaluate(tree, node.child(1), env);
+                        Value start = evaluate(tree, node.child(2), env);
+                        return builtin_array_slice(array, start, evaluate(tree, node.child(3), env));
+                    }
+                    case KW_ARRAY_SUM: {
+                        if (list.size() != 2) throw runtime_error("'array_sum' requires 1 argument (array), but received " + to_string(list.size() - 1) + ".");
+                        return builtin_array_sum(evaluate(tree, node.child(1), env));
+                    }
+                    case KW_ARRAY_MIN: {
+                        if (list.size() != 2) throw runtime_error("'array_min' requires 1 argument (array), but received " + to_string(list.size() - 1) + ".");
+                        return builtin_array_min(evaluate(tree, node.child(1), env));
+                    }
+                    case KW_ARRAY_MAX: {
+                        if (list.size() != 2) throw runtime_error("'array_max' requires 1 argument (array), but received " + to_string(list.size() - 1) + ".");
+                        return builtin_array_max(evaluate(tree, node.child(1), env));
+                    }
+                    case KW_ARRAY_FILL: {
+                        if (list.size() != 3) throw runtime_error("'array_fill' requires 2 arguments (count, value), but received " + to_string(list.size() - 1) + ".");
+                        Value count = evaluate(tree, node.child(1), env);
+                        return builtin_array_fill(count, evaluate(tree, node.child(2), env));
+                    }
+                    // Slowniki. map_put i map_delete oddaja nowy slownik, jak array_push.
+                    case KW_MAP: {
+                        vector<Value> elements;
+                        for (size_t i = 1; i < list.size(); ++i) elements.push_back(evaluate(tree, node.child(i), env));
+                        return builtin_map(elements.data(), elements.size());
+                    }
+                    case KW_MAP_PUT: {
+                        if (list.size() != 4) throw runtime_error("'map_put' requires 3 arguments (map, key, value), but received " + to_string(list.size() - 1) + ".");
+                        Value map = evaluate(tree, node.child(1), env);
+                        Value key = evaluate(tree, node.child(2), env);
+                        return builtin_map_put(map, key, evaluate(tree, node.child(3), env));
+                    }
+                    case KW_MAP_DELETE: {
+                        if (list.size() != 3) throw runtime_error("'map_delete' requires 2 arguments (map, key), but received " + to_string(list.size() - 1) + ".");
+                        Value map = evaluate(tree, node.child(1), env);
+                        return builtin_map_delete(map, evaluate(tree, node.child(2), env));
+                    }
+                    case KW_MAP_GET: {
+                        if (list.size() != 3) throw runtime_error("'map_get' requires 2 arguments (map, key), but received " + to_string(list.size() - 1) + ".");
+                        Value map = evaluate(tree, node.child(1), env);
+                        return builtin_map_get(map, evaluate(tree, node.child(2), env));
+                    }
+                    case KW_MAP_HAS: {
+                        if (list.size() != 3) throw runtime_error("'map_has' requires 2 arguments (map, key), but received " + to_string(list.size() - 1) + ".");
+                        Value map = evaluate(tree, node.child(1), env);
+                        return builtin_map_has(map, evaluate(tree, node.child(2), env));
+                    }
+                    case KW_MAP_KEYS: {
+                        if (list.size() != 2) throw runtime_error("'map_keys' requires 1 argument (map), but received " + to_string(list.size() - 1) + ".");
+                        return builtin_map_keys(evaluate(tree, node.child(1), env));
+                    }
+                    case KW_MAP_SIZE: {
+                        if (list.size() != 2) throw runtime_error("'map_size' requires 1 argument (map), but received " + to_string(list.size() - 1) + ".");
+                        return builtin_map_size(evaluate(tree, node.child(1), env));
+                    }
+                    case KW_ARRAY_MAP: {
+                        if (list.size() != 3) throw runtime_error("'array_map' requires 2 arguments (function, array), but received " + to_string(list.size() - 1) + ".");
+                        Value function = evaluate(tree, node.child(1), env);
+                        return builtin_array_map(function, evaluate(tree, node.child(2), env));
+                    }
+                    // Komendy w tle: sys_async daje uchwyt, await zwraca wyjscie komendy
+                    case KW_SYS_ASYNC: {
+                        if (list.size() != 2) throw runtime_error("'sys_async' requires 1 argument (a command string), but received " + to_string(list.size() - 1) + ".");
+                        return builtin_sys_async(evaluate(tree, node.child(1), env));
+                    }
+                    case KW_AWAIT: {
+                        if (list.size() != 2) throw runtime_error("'await' requires 1 argument (process handle), but received " + to_string(list.size() - 1) + ".");
+                        return builtin_await(evaluate(tree, node.child(1), env));
+                    }
+                    case KW_SYS_STATUS: {
+                        if (list.size() != 2) throw runtime_error("'sys_status' requires 1 argument (process handle), but received " + to_string(list.size() - 1) + ".");
+                        return builtin_sys_status(evaluate(tree, node.child(1), env));
+                    }
+                    case KW_SYS_STDERR: {
+                        if (list.size() != 2) throw runtime_error("'sys_stderr' requires 1 argument (process handle), but received " + to_string(list.size() - 1) + ".");
+                        return builtin_sys_stderr(evaluate(tree, node.child(1), env));
+                    }
+                    default: break;
+                }
+            }
+
+            // Jesli to nie bylo slowo kluczowe, to pewnie wywolanie funkcji
+            Value first_val = evaluate(tree, node.child(0), env);
+
+            if (first_val.type() == TYPE_FUNCTION) {
+                const BraceFunction& func = first_val.as_function();
+                if (func.parameters.size() != list.size() - 1) throw runtime_error("Incorrect number of arguments for function call. Expected " + to_string(func.parameters.size()) + ", but got " + to_string(list.size() - 1) + ".");
+
+                Environment call_env = closure_environment(func);
+                for (size_t i = 0; i < func.parameters.size(); ++i) call_env[func.parameters[i]] = evaluate(tree, node.child(i + 1), env);
+
+                // Wywolanie to ostatni krok tego wyrazenia, wiec cialo funkcji wykonujemy w tej samej petli.
+                // Stare srodowisko i funkcja nie sa juz potrzebne (argumenty sa policzone).
+                depth.enter();
+                if (tail_env) *tail_env = std::move(call_env);
+                else tail_env = make_unique<Environment>(std::move(call_env));
+                current_env = tail_env.get();
+                tail_function = std::move(first_val);
+                current_ast = tail_function.as_function().ast;
+                current = tail_function.as_function().body;
+                continue;
+            }
+
+            // Jesli to nie funkcja, to musi byc operator jak + - * /
+            Value result = first_val;
+            for (size_t i = 1; i < list.size(); i += 2) {
+                if (list[i].is_list()) throw runtime_error("Syntax error: Expected an operator.");
+                const Token& op = list[i].token;
+                if (i + 1 >= list.size()) throw runtime_error("Syntax error: Missing right operand for operator '" + string(token_text(op)) + "'.");
+                Value rhs = evaluate(tree, node.child(i+1), env);
+                apply_infix(infix_op_of(op), token_text(op), result, rhs);
+            }
+            return result;
+        }
+
+        throw runtime_error("Critical error: Failed to interpret expression.");
+    }
+}
+
+Value evaluate_function(const Value& function, const Value* args, size_t count) {
+    const BraceFunction& func = function.as_function();
+    if (func.parameters.size() != count) throw runtime_error("Incorrect number of arguments for function call. Expected " + to_string(func.parameters.size()) + ", but got " + to_string(count) + ".");
+    Environment call_env = closure_environment(func);
+    for (size_t i = 0; i < count; ++i) call_env[func.parameters[i]] = args[i];
+    CallDepth depth;
+    depth.enter();
+    return evaluate(*func.ast, func.body, call_env);
+}
@@ -1,21 +1,23 @@
-/**
- * Copyright 2025 KamilMalicki
- *
- * Licensed under the Apache License, Version 2.0 (the "License");
- * you may not use this file except in compliance with the License.
- * You may obtain a copy of the License at
- *
- * http://www.apache.org/licenses/LICENSE-2.0
- *
- * Unless required by applicable law or agreed to in writing, software
- * distributed under the License is distributed on an "AS IS" BASIS,
- * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
- * See the License for the specific language governing permissions and
- * limitations under the License.
- */
-#pragma once
-#include "types.hpp"
-
-// Deklaracja glownej funkcji evaluatora.
-// Bierze jedno wyrazenie i srodowisko, a nastepnie je wykonuje i zwraca wartosc.
-Value evaluate(const Expression& expr, Environment& env);
\ No newline at end of file
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include "types.hpp"
+
+// Deklaracja glownej funkcji evaluatora.
+// Bierze jedno wyrazenie (wezel drzewa) i srodowisko, a nastepnie je wykonuje i zwraca wartosc.
+Value evaluate(const Ast& ast, NodeId node, Environment& env);
+// Wywolanie funkcji z programu spoza evaluatora (call_function dla pmap i spawn z --tree-walk)
+Value evaluate_function(const Value& function, const Value* args, size_t count);
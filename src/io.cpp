@@ -0,0 +1,307 @@
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "io.hpp"
+#include "builtins.hpp"
+#include "parallel.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+ostream* output_stream = nullptr;
+
+static constexpr size_t OUTPUT_BUFFER_SIZE = 1 << 16;
+static constexpr size_t READ_BLOCK_SIZE = 1 << 16;
+
+static char output_buffer[OUTPUT_BUFFER_SIZE];
+static size_t output_used = 0;
+static recursive_mutex output_mutex;
+
+thread_local string* output_capture = nullptr;
+
+unique_lock<recursive_mutex> output_lock() {
+    // Przechwycone wyjscie nalezy tylko do tego watku
+    if (output_capture) return unique_lock<recursive_mutex>();
+    return lock_if_threads(output_mutex);
+}
+
+bool output_is_terminal() {
+#ifndef _WIN32
+    static const bool tty = isatty(STDOUT_FILENO);
+#else
+    static const bool tty = false;
+#endif
+    return tty;
+}
+
+static void write_out(const char* data, size_t size) {
+    if (output_stream) {
+        output_stream->write(data, size);
+        return;
+    }
+#ifndef _WIN32
+    while (size > 0) {
+        ssize_t written = write(STDOUT_FILENO, data, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return; // np. zamkniety potok - tak samo jak cout, po cichu
+        }
+        data += written;
+        size -= written;
+    }
+#else
+    fwrite(data, 1, size, stdout);
+    fflush(stdout);
+#endif
+}
+
+void output_flush() {
+    if (output_capture) return;
+    auto guard = output_lock();
+    if (output_used == 0) return;
+    write_out(output_buffer, output_used);
+    output_used = 0;
+}
+
+void output_write(string_view text) {
+    if (output_capture) {
+        output_capture->append(text);
+        return;
+    }
+    auto guard = output_lock();
+    if (text.size() > OUTPUT_BUFFER_SIZE - output_used) {
+        output_flush();
+        // Duzy tekst idzie prosto, bez przepisywania przez bufor
+        if (text.size() >= OUTPUT_BUFFER_SIZE) {
+            write_out(text.data(), text.size());
+            return;
+        }
+    }
+    memcpy(output_buffer + output_used, text.data(), text.size());
+    output_used += text.size();
+    if (output_is_terminal() && memchr(text.data(), '\n', text.size())) output_flush();
+}
+
+// Na wypadek wyjscia z programu bez output_flush (np. exit z biblioteki)
+static struct FlushAtExit {
+    ~FlushAtExit() { output_flush(); }
+} flush_at_exit;
+
+// Sciezka z wartosci - dla komunikatow bledow i open
+static string path_of(const Value& path, const char* builtin) {
+    if (path.type() != TYPE_STRING) throw runtime_error(string("Type error: The path for '") + builtin + "' must be a string.");
+    return string(path.as_string());
+}
+
+[[noreturn]] static void throw_open_error(const string& path) {
+    throw runtime_error("Could not open file '" + path + "'.");
+}
+
+Value builtin_file_read(const Value& path_val) {
+    string path = path_of(path_val, "file_read");
+    string text;
+#ifndef _WIN32
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw_open_error(path);
+    struct stat info;
+    // Zwykly plik: znamy rozmiar, wiec czytamy od razu do docelowego stringa. Potoki i urzadzenia - blokami.
+    size_t expected = fstat(fd, &info) == 0 && S_ISREG(info.st_mode) ? info.st_size : 0;
+    text.resize(expected > 0 ? expected : READ_BLOCK_SIZE);
+    size_t used = 0;
+    for (;;) {
+        if (used == text.size()) text.resize(text.size() * 2);
+        ssize_t got = read(fd, text.data() + used, text.size() - used);
+        if (got < 0 && errno == EINTR) continue;
+        if (got < 0) {
+            close(fd);
+            throw runtime_error("Could not read file '" + path + "'.");
+        }
+        if (got == 0) break;
+        used += got;
+    }
+    close(fd);
+    text.resize(used);
+#else
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) throw_open_error(path);
+    char block[READ_BLOCK_SIZE];
+    while (size_t got = fread(block, 1, sizeof(block), file)) text.append(block, got);
+    fclose(file);
+#endif
+    return Value::string(std::move(text));
+}
+
+Value builtin_file_write(const Value& path_val, const Value& text_val) {
+    string path = path_of(path_val, "file_write");
+    string number;
+    string_view text;
+    if (text_val.type() == TYPE_STRING) {
+        text = text_val.as_string();
+    } else {
+        number = value_to_string(text_val);
+        text = number;
+    }
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) throw_open_error(path);
+    bool ok = fwrite(text.data(), 1, text.size(), file) == text.size();
+    ok = fclose(file) == 0 && ok;
+    if (!ok) throw runtime_error("Could not write file '" + path + "'.");
+    return Value{};
+}
+
+// Plik otwarty przez file_open. Zwykle pliki sa zmapowane w calosci, reszta idzie przez bufor.
+struct LineReader {
+    const char* data = nullptr;   // nieprzeczytana czesc: [data + pos, data + size)
+    size_t size = 0;
+    size_t pos = 0;
+#ifndef _WIN32
+    int fd = -1;
+    void* mapping = nullptr;
+#else
+    FILE* file = nullptr;
+#endif
+    string buffer;                // tryb bez mmap: wczytane, a jeszcze nie oddane bajty
+    bool at_end = false;          // w trybie bez mmap: plik sie skonczyl
+
+    ~LineReader() {
+#ifndef _WIN32
+        if (mapping) munmap(mapping, size);
+        if (fd >= 0) close(fd);
+#else
+        if (file) fclose(file);
+#endif
+    }
+
+    // Tryb bez mmap: dociaga kolejny blok. False, gdy plik sie skonczyl.
+    bool fill() {
+        if (at_end) return false;
+        buffer.erase(0, pos);
+        pos = 0;
+        size_t used = buffer.size();
+        buffer.resize(used + READ_BLOCK_SIZE);
+#ifndef _WIN32
+        ssize_t got;
+        do got = read(fd, buffer.data() + used, READ_BLOCK_SIZE); while (got < 0 && errno == EINTR);
+        if (got < 0) got = 0;
+#else
+        size_t got = fread(buffer.data() + used, 1, READ_BLOCK_SIZE, file);
+#endif
+        buffer.resize(used + got);
+        data = buffer.data();
+        size = buffer.size();
+        if (got == 0) at_end = true;
+        return got > 0;
+    }
+
+    bool eof() {
+        if (pos < size) return false;
+        if (mapping_mode()) return true;
+        return !fill();
+    }
+
+    bool mapping_mode() const {
+#ifndef _WIN32
+        return mapping != nullptr;
+#else
+        return false;
+#endif
+    }
+
+    // Kolejna linia bez '\n' (i bez '\r' przed nim, jak w input). Ostatnia linia nie musi miec '\n'.
+    Value next_line() {
+        if (eof()) return Value{};
+        // Bez mmap linia moze siegac dalej niz bufor - dociagamy bloki, az znajdziemy jej koniec
+        const char* newline;
+        while (!(newline = static_cast<const char*>(memchr(data + pos, '\n', size - pos))) && !mapping_mode() && fill()) {}
+        const char* line = data + pos;
+        size_t length = newline ? newline - line : size - pos;
+        pos += newline ? length + 1 : length;
+        if (length > 0 && line[length - 1] == '\r') --length;
+        return Value::string(string_view(line, length));
+    }
+};
+
+// Otwarte pliki - uchwyt to numer w tej tablicy plus 1
+static vector<unique_ptr<LineReader>> readers;
+static mutex readers_mutex;
+
+static LineReader& reader_of(const Value& handle, const char* builtin) {
+    if (handle.type() == TYPE_NUMBER) {
+        int_fast64_t index = handle.as_number() - 1;
+        if (index >= 0 && index < (int_fast64_t)readers.size() && readers[index]) return *readers[index];
+    }
+    throw runtime_error(string("Type error: '") + builtin + "' expects a file handle from 'file_open'.");
+}
+
+Value builtin_file_open(const Value& path_val) {
+    string path = path_of(path_val, "file_open");
+    auto reader = make_unique<LineReader>();
+#ifndef _WIN32
+    reader->fd = open(path.c_str(), O_RDONLY);
+    if (reader->fd < 0) throw_open_error(path);
+    struct stat info;
+    if (fstat(reader->fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, reader->fd, 0);
+        if (mapping != MAP_FAILED) {
+#ifdef MADV_SEQUENTIAL
+            madvise(mapping, info.st_size, MADV_SEQUENTIAL);
+#endif
+            reader->mapping = mapping;
+            reader->data = static_cast<const char*>(mapping);
+            reader->size = info.st_size;
+        }
+    }
+#else
+    reader->file = fopen(path.c_str(), "rb");
+    if (!reader->file) throw_open_error(path);
+#endif
+    // Zwolnione miejsca wykorzystujemy ponownie, zeby petla open/close nie rozdmuchiwala tablicy
+    auto guard = lock_if_threads(readers_mutex);
+    for (size_t i = 0; i < readers.size(); ++i) {
+        if (!readers[i]) {
+            readers[i] = std::move(reader);
+            return Value::number(i + 1);
+        }
+    }
+    readers.push_back(std::move(reader));
+    return Value::number(readers.size());
+}
+
+Value builtin_file_line(const Value& handle) {
+    auto guard = lock_if_threads(readers_mutex);
+    return reader_of(handle, "file_line").next_line();
+}
+
+Value builtin_file_eof(const Value& handle) {
+    auto guard = lock_if_threads(readers_mutex);
+    return Value::number(reader_of(handle, "file_eof").eof());
+}
+
+Value builtin_file_close(const Value& handle) {
+    auto guard = lock_if_threads(readers_mutex);
+    reader_of(handle, "file_close");
+    readers[handle.as_number() - 1].reset();
+    return Value{};
+}
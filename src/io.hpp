@@ -0,0 +1,50 @@
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include "types.hpp"
+
+#include <mutex>
+#include <ostream>
+
+// Wejscie i wyjscie programu: bufor standardowego wyjscia oraz odczyt i zapis plikow.
+//
+// print nie pisze do cout, tylko do wlasnego bufora (64 KB), ktory trafia na deskryptor 1 jednym
+// wywolaniem write, gdy sie zapelni, przed czytaniem z input i na koniec programu. Gdy wyjscie to terminal,
+// bufor jest oprozniany takze po kazdym tekscie z '\n', zeby linie pojawialy sie od razu.
+//
+// Pliki: file_read czyta caly plik prosto do bufora stringa (rozmiar znamy z fstat, wiec bez kopii posredniej),
+// file_line daje kolejne linie pliku otwartego przez file_open - plik jest mapowany do pamieci (mmap),
+// a dla potokow i urzadzen czytany duzymi blokami.
+
+// Dopisuje tekst do bufora wyjscia
+void output_write(string_view text);
+
+// Wypisuje wszystko, co czeka w buforze
+void output_flush();
+
+// Gdy ustawione, wyjscie programu w tym watku trafia do tego stringa zamiast na standardowe wyjscie (--batch).
+// Zadania z pmap i spawn utworzone w takim watku pisza do wlasnych buforow, dopisywanych tutaj przy join i pmap
+// albo na koncu SpawnScope (parallel.hpp).
+extern thread_local string* output_capture;
+
+// Blokada bufora wyjscia na czas kilku zapisow (np. print z kilkoma argumentami), gdy dzialaja zadania na watkach
+unique_lock<recursive_mutex> output_lock();
+
+// Czy standardowe wyjscie to terminal (sprawdzane raz)
+bool output_is_terminal();
+
+// Zamiast deskryptora 1 bufor moze pisac do strumienia (np. bracketLang_bench wycisza tak programy)
+extern ostream* output_stream;
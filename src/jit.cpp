@@ -0,0 +1,372 @@
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "jit.hpp"
+
+#include <map>
+
+#if defined(__x86_64__) && (defined(__unix__) || defined(__APPLE__))
+#define BRACKET_JIT_X64 1
+#include <sys/mman.h>
+#endif
+
+bool jit_enabled = false;
+
+struct JitCode {
+    void* memory = nullptr;     // kod maszynowy (tylko do odczytu i wykonania)
+    size_t size = 0;
+    uint32_t entry_depth = 0;
+    uint32_t max_depth = 0;
+    vector<JitExit> exits;      // kod natywny zwraca numer wyjscia
+
+    ~JitCode() {
+#ifdef BRACKET_JIT_X64
+        if (memory) munmap(memory, size);
+#endif
+    }
+};
+
+uint32_t jit_entry_depth(const JitCode& code) { return code.entry_depth; }
+uint32_t jit_max_depth(const JitCode& code) { return code.max_depth; }
+
+#ifdef BRACKET_JIT_X64
+
+namespace {
+
+// Rejestry: rdi = pierwszy slot ramki, rsi = domkniecie (argumenty funkcji w System V ABI),
+// rax, rcx i rdx do obliczen. Nic nie wolamy, wiec nie potrzebujemy ramki stosu.
+enum Reg : uint8_t { RAX = 0, RCX = 1, RDX = 2, RSI = 6, RDI = 7 };
+
+// Kody warunkow dla jcc/setcc
+enum Condition : uint8_t { CC_E = 0x4, CC_NE = 0x5, CC_L = 0xC, CC_GE = 0xD, CC_LE = 0xE, CC_G = 0xF };
+
+// Minimalny asembler - tylko instrukcje, ktorych potrzebujemy
+struct Assembler {
+    vector<uint8_t> code;
+
+    void byte(uint8_t b) { code.push_back(b); }
+    void bytes(initializer_list<uint8_t> list) { code.insert(code.end(), list); }
+    void u32(uint32_t v) { for (int i = 0; i < 4; ++i) byte(v >> (8 * i)); }
+    void u64(uint64_t v) { for (int i = 0; i < 8; ++i) byte(v >> (8 * i)); }
+    // Operand pamieci [base + disp32], 'reg' to rejestr albo rozszerzenie kodu instrukcji
+    void mem(uint8_t reg, Reg base, int32_t disp) { byte(0x80 | (reg << 3) | base); u32(disp); }
+
+    void load(Reg dst, Reg base, int32_t disp) { bytes({0x48, 0x8B}); mem(dst, base, disp); }     // mov dst, [mem]
+    void store(Reg base, int32_t disp, Reg src) { bytes({0x48, 0x89}); mem(src, base, disp); }    // mov [mem], src
+    void mov_imm64(Reg dst, uint64_t v) { byte(0x48); byte(0xB8 + dst); u64(v); }                // mov dst, imm64
+    void mov_eax(uint32_t v) { byte(0xB8); u32(v); }                                              // mov eax, imm32
+    void cmp_byte(Reg base, int32_t disp, uint8_t v) { byte(0x80); mem(7, base, disp); byte(v); } // cmp byte [mem], imm8
+    void test_byte(Reg base, int32_t disp, uint8_t v) { byte(0xF6); mem(0, base, disp); byte(v); }// test byte [mem], imm8
+    void store_byte(Reg base, int32_t disp, uint8_t v) { byte(0xC6); mem(0, base, disp); byte(v); } // mov byte [mem], imm8
+    void cmp_zero(Reg base, int32_t disp) { bytes({0x48, 0x83}); mem(7, base, disp); byte(0); }  // cmp qword [mem], 0
+    void add() { bytes({0x48, 0x01, 0xC8}); }           // add rax, rcx
+    void sub() { bytes({0x48, 0x29, 0xC8}); }           // sub rax, rcx
+    void imul() { bytes({0x48, 0x0F, 0xAF, 0xC1}); }    // imul rax, rcx
+    void cmp() { bytes({0x48, 0x39, 0xC8}); }           // cmp rax, rcx
+    void test_rcx() { bytes({0x48, 0x85, 0xC9}); }      // test rcx, rcx
+    void cmp_rcx_minus_one() { bytes({0x48, 0x83, 0xF9, 0xFF}); } // cmp rcx, -1
+    void cqo_idiv() { bytes({0x48, 0x99, 0x48, 0xF7, 0xF9}); }    // cqo; idiv rcx
+    void mov_rax_rdx() { bytes({0x48, 0x89, 0xD0}); }   // mov rax, rdx
+    void setcc(Condition cc) { bytes({0x0F, (uint8_t)(0x90 | cc), 0xC0, 0x0F, 0xB6, 0xC0}); } // setcc al; movzx eax, al
+    void ret() { byte(0xC3); }
+
+    // Skoki z 32-bitowym przesunieciem. Zwracaja miejsce przesuniecia do poprawienia przez patch.
+    size_t jcc(Condition cc) { bytes({0x0F, (uint8_t)(0x80 | cc)}); u32(0); return code.size() - 4; }
+    size_t jmp() { byte(0xE9); u32(0); return code.size() - 4; }
+    void patch(size_t at, size_t target) {
+        int32_t rel = (int32_t)(target - (at + 4));
+        memcpy(&code[at], &rel, sizeof(rel));
+    }
+};
+
+// Adres wartosci numer i w ramce (albo w domknieciu) i jej znacznika typu
+int32_t value_at(uint32_t i) { return i * sizeof(Value); }
+int32_t tag_at(uint32_t i) { return i * sizeof(Value) + Value::TAG_OFFSET; }
+
+bool is_arithmetic(uint32_t op) {
+    return (op >= OP_ADD && op <= OP_LE) || (op >= OP_ADD_NUM && op <= OP_LE_NUM);
+}
+
+class JitCompiler {
+public:
+    JitCompiler(const Chunk& chunk, uint32_t start, uint32_t end) : chunk(chunk), start(start), end(end) {}
+
+    shared_ptr<JitCode> compile(uint32_t entry_depth) {
+        if (!compute_depths(entry_depth)) return nullptr;
+
+        for (uint32_t pc = start; pc < end; ) {
+            int32_t depth = depths[pc - start];
+            if (depth < 0) { pc += 1; continue; } // instrukcja, do ktorej nie dochodzimy (albo srodek innej)
+            labels[pc] = as.code.size();
+            pc = emit_instruction(pc, depth);
+        }
+        for (const auto& jump : jumps_to_pc) as.patch(jump.first, labels.at(jump.second));
+
+        // Wyjscia na koncu kodu: numer wyjscia w eax i powrot do interpretera
+        auto code = make_shared<JitCode>();
+        for (size_t i = 0; i < exits.size(); ++i) {
+            for (size_t at : exit_jumps[i]) as.patch(at, as.code.size());
+            as.mov_eax(i);
+            as.ret();
+        }
+        code->exits = exits;
+        code->entry_depth = entry_depth;
+        code->max_depth = max_depth;
+
+        // Pamiec najpierw do zapisu, potem tylko do odczytu i wykonania
+        code->size = as.code.size();
+        void* memory = mmap(nullptr, code->size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) return nullptr;
+        memcpy(memory, as.code.data(), code->size);
+        if (mprotect(memory, code->size, PROT_READ | PROT_EXEC) != 0) {
+            munmap(memory, code->size);
+            return nullptr;
+        }
+        code->memory = memory;
+        return code;
+    }
+
+private:
+    const Chunk& chunk;
+    uint32_t start, end;
+    Assembler as;
+
+    vector<int32_t> depths;                    // liczba wartosci w ramce przed kazda instrukcja (-1: nieznana)
+    uint32_t max_depth = 0;
+    map<uint32_t, size_t> labels;              // instrukcja -> miejsce w kodzie maszynowym
+    vector<pair<size_t, uint32_t>> jumps_to_pc;
+    vector<JitExit> exits;
+    vector<vector<size_t>> exit_jumps;         // skoki do kazdego wyjscia
+    map<pair<uint32_t, uint32_t>, uint32_t> exit_index;
+
+    bool supported(uint32_t pc) const {
+        uint32_t op = chunk.code[pc];
+        if (op == OP_CONST) return !chunk.constants[chunk.code[pc + 1]].is_heap();
+        return op == OP_NIL || op == OP_POP || op == OP_LOAD_LOCAL || op == OP_LOAD_CAPTURE || op == OP_DEF_LOCAL ||
+            op == OP_JUMP || op == OP_LOOP || op == OP_JUMP_IF_FALSE || op == OP_CALL_OR_JUMP || is_arithmetic(op);
+    }
+
+    // Ustala glebokosc stosu przed kazda instrukcja, idac po wszystkich sciezkach od poczatku.
+    // Kompilator zawsze daje te sama glebokosc w danym miejscu - jesli nie, rezygnujemy.
+    bool compute_depths(uint32_t entry_depth) {
+        depths.assign(end - start, -1);
+        vector<pair<uint32_t, int32_t>> work = {{start, (int32_t)entry_depth}};
+        max_depth = entry_depth;
+        while (!work.empty()) {
+            auto [pc, depth] = work.back();
+            work.pop_back();
+            if (pc < start || pc >= end) continue; // wyjscie z kawalka
+            if (depths[pc - start] >= 0) {
+                if (depths[pc - start] != depth) return false;
+                continue;
+            }
+            depths[pc - start] = depth;
+            max_depth = max(max_depth, (uint32_t)depth + 1);
+            if (!supported(pc)) continue; // tu wracamy do interpretera
+
+            uint32_t op = chunk.code[pc];
+            switch (op) {
+                case OP_CONST: case OP_LOAD_LOCAL: case OP_LOAD_CAPTURE: work.push_back({pc + 2, depth + 1}); break;
+                case OP_NIL: work.push_back({pc + 1, depth + 1}); break;
+                case OP_POP: work.push_back({pc + 1, depth - 1}); break;
+                case OP_DEF_LOCAL: work.push_back({pc + 2, depth}); break;
+                case OP_JUMP: case OP_LOOP: work.push_back({chunk.code[pc + 1], depth}); break;
+                // Funkcje zawsze leza na stercie, wiec w kodzie natywnym idziemy tylko do wersji infiksowej
+                case OP_CALL_OR_JUMP: work.push_back({chunk.code[pc + 2], depth}); break;
+                case OP_JUMP_IF_FALSE:
+                    work.push_back({pc + 2, depth - 1});
+                    work.push_back({chunk.code[pc + 1], depth - 1});
+                    break;
+                default: work.push_back({pc + 1, depth - 1}); break; // operator
+            }
+        }
+        return true;
+    }
+
+    // Skok do wyjscia wznawiajacego interpreter na instrukcji 'pc' przy danej glebokosci
+    void jump_to_exit(size_t at, uint32_t pc, uint32_t depth) {
+        auto key = make_pair(pc, depth);
+        auto it = exit_index.find(key);
+        if (it == exit_index.end()) {
+            it = exit_index.emplace(key, exits.size()).first;
+            exits.push_back(JitExit{pc, depth});
+            exit_jumps.emplace_back();
+        }
+        exit_jumps[it->second].push_back(at);
+    }
+
+    // Skok do instrukcji bajtkodu - w srodku kawalka albo wyjscie
+    void jump_to(size_t at, uint32_t pc, uint32_t depth) {
+        if (pc >= start && pc < end) jumps_to_pc.push_back({at, pc});
+        else jump_to_exit(at, pc, depth);
+    }
+
+    // Kopiuje cala wartosc (16 bajtow) - wolno tylko dla wartosci bez obiektu na stercie
+    void copy_value(Reg from_base, uint32_t from, uint32_t to) {
+        as.load(RAX, from_base, value_at(from));
+        as.load(RCX, from_base, value_at(from) + 8);
+        as.store(RDI, value_at(to), RAX);
+        as.store(RDI, value_at(to) + 8, RCX);
+    }
+
+    // Wczytanie zmiennej: obiekty na stercie i puste sloty zostawiamy interpreterowi
+    void emit_load(Reg base, uint32_t index, uint32_t pc, uint32_t depth) {
+        as.test_byte(base, tag_at(index), Value::HEAP_BIT);
+        jump_to_exit(as.jcc(CC_NE), pc, depth);
+        as.cmp_byte(base, tag_at(index), TYPE_UNDEFINED);
+        jump_to_exit(as.jcc(CC_E), pc, depth);
+        copy_value(base, index, depth);
+    }
+
+    void emit_arithmetic(uint32_t op, uint32_t pc, uint32_t depth) {
+        uint32_t left = depth - 2, right = depth - 1;
+        uint32_t kind = op >= OP_ADD_NUM ? op - OP_ADD_NUM : op - OP_ADD;
+
+        // Tylko dwie liczby, reszte (stringi, nil, bledy typow) robi interpreter
+        as.cmp_byte(RDI, tag_at(left), TYPE_NUMBER);
+        jump_to_exit(as.jcc(CC_NE), pc, depth);
+        as.cmp_byte(RDI, tag_at(right), TYPE_NUMBER);
+        jump_to_exit(as.jcc(CC_NE), pc, depth);
+        as.load(RAX, RDI, value_at(left));
+        as.load(RCX, RDI, value_at(right));
+
+        switch (kind + OP_ADD) {
+            case OP_ADD: as.add(); break;
+            case OP_SUB: as.sub(); break;
+            case OP_MUL: as.imul(); break;
+            case OP_DIV: case OP_MOD:
+                // Dzielenie przez zero to blad, a -1 moze przepelnic idiv - oba przypadki oddajemy interpreterowi
+                as.test_rcx();
+                jump_to_exit(as.jcc(CC_E), pc, depth);
+                as.cmp_rcx_minus_one();
+                jump_to_exit(as.jcc(CC_E), pc, depth);
+                as.cqo_idiv();
+                if (kind + OP_ADD == OP_MOD) as.mov_rax_rdx();
+                break;
+            case OP_EQ: as.cmp(); as.setcc(CC_E); break;
+            case OP_NE: as.cmp(); as.setcc(CC_NE); break;
+            case OP_GT: as.cmp(); as.setcc(CC_G); break;
+            case OP_LT: as.cmp(); as.setcc(CC_L); break;
+            case OP_GE: as.cmp(); as.setcc(CC_GE); break;
+            case OP_LE: as.cmp(); as.setcc(CC_LE); break;
+        }
+        as.store(RDI, value_at(left), RAX); // znacznik lewej wartosci juz mowi "liczba"
+    }
+
+    // Zwraca numer nastepnej instrukcji
+    uint32_t emit_instruction(uint32_t pc, uint32_t depth) {
+        if (!supported(pc)) {
+            jump_to_exit(as.jmp(), pc, depth);
+            return pc + 1;
+        }
+        uint32_t op = chunk.code[pc];
+        uint32_t next = pc + 1;
+        uint32_t next_depth = depth;
+        switch (op) {
+            case OP_CONST: {
+                // Stala bez obiektu na stercie - wpisujemy jej bajty wprost
+                uint64_t raw[2];
+                memcpy(raw, &chunk.constants[chunk.code[pc + 1]], sizeof(raw));
+                as.mov_imm64(RAX, raw[0]);
+                as.store(RDI, value_at(depth), RAX);
+                as.mov_imm64(RAX, raw[1]);
+                as.store(RDI, value_at(depth) + 8, RAX);
+                next = pc + 2;
+                next_depth = depth + 1;
+                break;
+            }
+            case OP_NIL:
+                as.store_byte(RDI, tag_at(depth), TYPE_NIL);
+                next_depth = depth + 1;
+                break;
+            case OP_POP:
+                // Zdjecie obiektu ze sterty wymaga zmniejszenia licznika - to robi interpreter
+                as.test_byte(RDI, tag_at(depth - 1), Value::HEAP_BIT);
+                jump_to_exit(as.jcc(CC_NE), pc, depth);
+                next_depth = depth - 1;
+                break;
+            case OP_LOAD_LOCAL:
+                emit_load(RDI, chunk.code[pc + 1], pc, depth);
+                next = pc + 2;
+                next_depth = depth + 1;
+                break;
+            case OP_LOAD_CAPTURE:
+                emit_load(RSI, chunk.code[pc + 1], pc, depth);
+                next = pc + 2;
+                next_depth = depth + 1;
+                break;
+            case OP_DEF_LOCAL: {
+                // Nadpisanie obiektu ze sterty tez zostawiamy interpreterowi
+                uint32_t slot = chunk.code[pc + 1];
+                as.test_byte(RDI, tag_at(slot), Value::HEAP_BIT);
+                jump_to_exit(as.jcc(CC_NE), pc, depth);
+                copy_value(RDI, depth - 1, slot);
+                next = pc + 2;
+                break;
+            }
+            case OP_JUMP:
+            case OP_LOOP:
+                jump_to(as.jmp(), chunk.code[pc + 1], depth);
+                return pc + (op == OP_LOOP ? 3 : 2);
+            case OP_CALL_OR_JUMP:
+                // (a + b ...) - jesli pierwszy element nie jest na stercie, to nie jest funkcja i mamy lancuch infiksowy
+                as.test_byte(RDI, tag_at(depth - 1), Value::HEAP_BIT);
+                jump_to_exit(as.jcc(CC_NE), pc, depth);
+                jump_to(as.jmp(), chunk.code[pc + 2], depth);
+                return pc + 3;
+            case OP_JUMP_IF_FALSE: {
+                // Liczba 0 to falsz, nil to prawda, innych typow nie obslugujemy
+                as.cmp_byte(RDI, tag_at(depth - 1), TYPE_NUMBER);
+                size_t not_number = as.jcc(CC_NE);
+                as.cmp_zero(RDI, value_at(depth - 1));
+                jump_to(as.jcc(CC_E), chunk.code[pc + 1], depth - 1);
+                size_t is_true = as.jmp();
+                as.patch(not_number, as.code.size());
+                as.cmp_byte(RDI, tag_at(depth - 1), TYPE_NIL);
+                jump_to_exit(as.jcc(CC_NE), pc, depth);
+                as.patch(is_true, as.code.size());
+                next = pc + 2;
+                next_depth = depth - 1;
+                break;
+            }
+            default:
+                emit_arithmetic(op, pc, depth);
+                next_depth = depth - 1;
+                break;
+        }
+        // Koniec kawalka - dalej jedzie interpreter
+        if (next >= end) jump_to_exit(as.jmp(), next, next_depth);
+        return next;
+    }
+};
+
+} // namespace
+
+shared_ptr<JitCode> jit_compile(const Chunk& chunk, uint32_t start, uint32_t end, uint32_t depth) {
+    return JitCompiler(chunk, start, end).compile(depth);
+}
+
+JitExit jit_run(const JitCode& code, Value* frame, const Value* captures) {
+    auto entry = reinterpret_cast<uint32_t (*)(Value*, const Value*)>(code.memory);
+    return code.exits[entry(frame, captures)];
+}
+
+#else
+
+shared_ptr<JitCode> jit_compile(const Chunk&, uint32_t, uint32_t, uint32_t) { return nullptr; }
+
+JitExit jit_run(const JitCode&, Value*, const Value*) { return JitExit{0, 0}; }
+
+#endif
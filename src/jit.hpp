@@ -0,0 +1,54 @@
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include "types.hpp"
+#include "compiler.hpp"
+
+// Prosty JIT dla x86-64 (opcja --jit).
+//
+// Maszyna wirtualna liczy obroty kazdej petli i wywolania kazdej funkcji. Gdy licznik dojdzie do
+// BRACKET_JIT_THRESHOLD, kawalek bajtkodu jest tlumaczony instrukcja po instrukcji na kod maszynowy.
+// Kod natywny pracuje na tych samych wartosciach co interpreter (sloty ramki i stos lezace w pamieci),
+// ale obsluguje tylko liczby i nil: zmienne, stale, skoki i operatory arytmetyczne.
+// Wszystko inne (stringi, wywolania, print, sys...), a takze dzielenie przez zero, to "wyjscie":
+// kod natywny wraca do interpretera, a ten wykonuje te instrukcje i idzie dalej sam.
+//
+// Na innych procesorach i systemach jit_compile zawsze zwraca nullptr i --jit nic nie zmienia.
+
+#ifndef BRACKET_JIT_THRESHOLD
+#define BRACKET_JIT_THRESHOLD 1000
+#endif
+
+// Ustawiane przez --jit
+extern bool jit_enabled;
+
+// Gdzie interpreter ma kontynuowac po wyjsciu z kodu natywnego i ile wartosci lezy wtedy w ramce
+struct JitExit {
+    uint32_t resume;
+    uint32_t depth;
+};
+
+// Kompiluje instrukcje [start, end) kawalka. 'depth' to liczba wartosci w ramce (sloty i stos)
+// przy wejsciu na 'start' - przy kazdym wejsciu musi byc taka sama. Zwraca nullptr, jesli sie nie da.
+shared_ptr<JitCode> jit_compile(const Chunk& chunk, uint32_t start, uint32_t end, uint32_t depth);
+
+// Liczba wartosci ramki przy wejsciu do kodu i najwieksza, jakiej kod moze potrzebowac
+uint32_t jit_entry_depth(const JitCode& code);
+uint32_t jit_max_depth(const JitCode& code);
+
+// Wykonuje kod. 'frame' to pierwszy slot ramki (miejsca musi byc na jit_max_depth wartosci),
+// 'captures' to domkniecie aktualnej funkcji (nullptr w programie glownym).
+JitExit jit_run(const JitCode& code, Value* frame, const Value* captures);
@@ -1,132 +1,145 @@
-/**
- * Copyright 2025 KamilMalicki
- *
- * Licensed under the Apache License, Version 2.0 (the "License");
- * you may not use this file except in compliance with the License.
- * You may obtain a copy of the License at
- *
- * http://www.apache.org/licenses/LICENSE-2.0
- *
- * Unless required by applicable law or agreed to in writing, software
- * distributed under the License is distributed on an "AS IS" BASIS,
- * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
- * See the License for the specific language governing permissions and
- * limitations under the License.
- */
-#include "lexer.hpp"
-
-// Glowna funkcja lexera, przelatuje po calym kodzie znak po znaku i dzieli go na tokeny
-vector<Token> tokenize(const string& source) {
-    vector<Token> tokens;
-    int i = 0; // nasz aktualny wskaznik na znak w kodzie
-    while (i < source.length()) {
-        char c = source[i];
-
-        // 1. Ignorujemy biale znaki (spacje, tabulatory, nowe linie)
-        if (isspace(c)) {
-            i++;
-            continue;
-        }
-
-        // ***************************************************************
-        // *** OTO POPRAWKA DLA KOMENTARZY                             ***
-        // ***************************************************************
-        // Jeśli napotkamy średnik, ignorujemy wszystko do końca linii.
-        if (c == ';') {
-            while (i < source.length() && source[i] != '\n') {
-                i++;
-            }
-            continue; // Przechodzimy do następnej iteracji głównej pętli
-        }
-
-        // 2. Proste tokeny jednoznakowe - nawiasy
-        if (c == '(') {
-            tokens.push_back({TOKEN_LPAREN, "("});
-            i++;
-            continue;
-        }
-        if (c == ')') {
-            tokens.push_back({TOKEN_RPAREN, ")"});
-            i++;
-            continue;
-        }
-
-        // 3. Operatory jednoznakowe
-        if (c == '+' || c == '-' || c == '*' || c == '/' || c == '%') {
-            tokens.push_back({TOKEN_OPERATOR, string(1, c)});
-            i++;
-            continue;
-        }
-
-        // 4. Operatory, ktore moga miec dwa znaki (np. ==, !=, >=, <=)
-        if (c == '=' || c == '!' || c == '<' || c == '>') {
-            string op_str;
-            op_str += c;
-            i++;
-            // Sprawdzamy, czy nastepny znak to '=', aby stworzyc operator dwuznakowy
-            if (i < source.length() && source[i] == '=') {
-                op_str += source[i];
-                i++;
-            }
-            tokens.push_back({TOKEN_OPERATOR, op_str});
-            continue;
-        }
-
-        // 5. Stringi w cudzyslowach
-        if (c == '"') {
-            string str_value;
-            i++; // pomijamy cudzyslow otwierajacy
-            while (i < source.length() && source[i] != '"') {
-                // Obsluga znakow specjalnych jak \n, \t (tzw. escape characters)
-                if (source[i] == '\\' && i + 1 < source.length()) {
-                    i++; // pomijamy backslash
-                    switch (source[i]) {
-                        case 'n': str_value += '\n'; break;
-                        case 't': str_value += '\t'; break;
-                        case 'r': str_value += '\r'; break;
-                        default: str_value += source[i]; break; // np. dla \"
-                    }
-                } else {
-                    str_value += source[i];
-                }
-                i++;
-            }
-            i++; // pomijamy cudzyslow zamykajacy
-            tokens.push_back({TOKEN_STRING, str_value});
-            continue;
-        }
-
-        // 6. Liczby
-        if (isdigit(c)) {
-            string num_str;
-            // Zbieramy wszystkie cyfry pod rzad, tworzac pelna liczbe
-            while (i < source.length() && isdigit(source[i])) {
-                num_str += source[i++];
-            }
-
-            // Specjalna skladnia dla operatora ' - np. 1' to to samo co (get text 1)
-            if (i < source.length() && source[i] == '\'') {
-                i++;
-                tokens.push_back({TOKEN_INDEX_OP, num_str});
-            } else {
-                tokens.push_back({TOKEN_NUMBER, num_str});
-            }
-            continue;
-        }
-
-        // 7. Identyfikatory (nazwy zmiennych, funkcji)
-        if (isalpha(c)) {
-            string identifier;
-            // zbieramy wszystko co jest litera, cyfra lub podkreslnikiem
-            while (i < source.length() && (isalnum(source[i]) || source[i] == '_')) {
-                identifier += source[i++];
-            }
-            tokens.push_back({TOKEN_IDENTIFIER, identifier});
-            continue;
-        }
-
-        // 8. Jesli jakis znak nie pasuje do zadnej kategorii, po prostu go ignorujemy
-        i++;
-    }
-    return tokens;
-}
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "lexer.hpp"
+
+#include <cstring>
+
+// Przelatuje po kodzie znak po znaku az do konca nastepnego tokena
+bool Lexer::next(Token& token) {
+    token.symbol = NO_SYMBOL;
+    token.constant = Value::undefined();
+    while (pos < source.length()) {
+        // 1. Ignorujemy biale znaki (spacje, tabulatory, nowe linie)
+        pos = scan.whitespace(source.data(), pos, source.size());
+        if (pos >= source.length()) break;
+        unsigned char c = source[pos];
+
+        // Jeśli napotkamy średnik, ignorujemy wszystko do końca linii.
+        if (c == ';') {
+            const void* line_end = memchr(source.data() + pos, '\n', source.size() - pos);
+            pos = line_end ? static_cast<const char*>(line_end) - source.data() : source.size();
+            continue;
+        }
+
+        size_t start = pos;
+
+        // 2. Proste tokeny jednoznakowe - nawiasy
+        if (c == '(' || c == ')') {
+            token.type = c == '(' ? TOKEN_LPAREN : TOKEN_RPAREN;
+            token.text = source.substr(pos++, 1);
+            return true;
+        }
+
+        // 3. Operatory jednoznakowe
+        if (c == '+' || c == '-' || c == '*' || c == '/' || c == '%') {
+            token.type = TOKEN_OPERATOR;
+            token.text = source.substr(pos++, 1);
+            token.symbol = intern(token.text);
+            return true;
+        }
+
+        // 4. Operatory, ktore moga miec dwa znaki (np. ==, !=, >=, <=)
+        if (c == '=' || c == '!' || c == '<' || c == '>') {
+            pos++;
+            // Sprawdzamy, czy nastepny znak to '=', aby stworzyc operator dwuznakowy
+            if (pos < source.length() && source[pos] == '=') pos++;
+            token.type = TOKEN_OPERATOR;
+            token.text = source.substr(start, pos - start);
+            token.symbol = intern(token.text);
+            return true;
+        }
+
+        // 5. Stringi w cudzyslowach
+        if (c == '"') {
+            read_string(token);
+            return true;
+        }
+
+        // 6. Liczby
+        if (isdigit(c)) {
+            // Zbieramy wszystkie cyfry pod rzad, tworzac pelna liczbe
+            pos = scan.digits(source.data(), pos, source.size());
+            token.text = source.substr(start, pos - start);
+
+            // Specjalna skladnia dla operatora ' - np. 1' to to samo co (get text 1)
+            if (pos < source.length() && source[pos] == '\'') {
+                pos++;
+                token.type = TOKEN_INDEX_OP;
+            } else {
+                token.type = TOKEN_NUMBER;
+            }
+            return true;
+        }
+
+        // 7. Identyfikatory (nazwy zmiennych, funkcji)
+        if (isalpha(c)) {
+            // zbieramy wszystko co jest litera, cyfra lub podkreslnikiem
+            pos = scan.identifier(source.data(), pos, source.size());
+            token.type = TOKEN_IDENTIFIER;
+            token.text = source.substr(start, pos - start);
+            // Od razu zamieniamy nazwe na symbol, pozniej porownujemy juz tylko liczby
+            token.symbol = intern(token.text);
+            return true;
+        }
+
+        // 8. Jesli jakis znak nie pasuje do zadnej kategorii, po prostu go ignorujemy
+        pos++;
+    }
+    return false;
+}
+
+// String w cudzyslowach. Bez sekwencji ucieczki tekst to po prostu kawalek zrodla,
+// a z nimi dekodujemy go raz do token.constant.
+void Lexer::read_string(Token& token) {
+    token.type = TOKEN_STRING;
+    size_t start = ++pos; // pomijamy cudzyslow otwierajacy
+    bool escaped = false;
+    while (true) {
+        // Skaczemy od razu do najblizszego '"' albo '\\'
+        pos = scan.string_body(source.data(), pos, source.size());
+        if (pos >= source.length() || source[pos] == '"') break;
+        escaped = true;
+        pos += pos + 1 < source.length() ? 2 : 1;
+    }
+    token.text = source.substr(start, pos - start);
+    pos++; // pomijamy cudzyslow zamykajacy
+
+    if (!escaped) return;
+    string str_value;
+    str_value.reserve(token.text.size());
+    for (size_t i = 0; i < token.text.size(); ++i) {
+        // Obsluga znakow specjalnych jak \n, \t (tzw. escape characters)
+        if (token.text[i] == '\\' && i + 1 < token.text.size()) {
+            switch (token.text[++i]) {
+                case 'n': str_value += '\n'; break;
+                case 't': str_value += '\t'; break;
+                case 'r': str_value += '\r'; break;
+                default: str_value += token.text[i]; break; // np. dla \"
+            }
+        } else {
+            str_value += token.text[i];
+        }
+    }
+    token.constant = Value::string(std::move(str_value));
+}
+
+vector<Token> tokenize(string_view source) {
+    vector<Token> tokens;
+    Lexer lexer(source);
+    Token token;
+    while (lexer.next(token)) tokens.push_back(token);
+    return tokens;
+}
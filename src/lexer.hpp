@@ -1,21 +1,39 @@
-/**
- * Copyright 2025 KamilMalicki
- *
- * Licensed under the Apache License, Version 2.0 (the "License");
- * you may not use this file except in compliance with the License.
- * You may obtain a copy of the License at
- *
- * http://www.apache.org/licenses/LICENSE-2.0
- *
- * Unless required by applicable law or agreed to in writing, software
- * distributed under the License is distributed on an "AS IS" BASIS,
- * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
- * See the License for the specific language governing permissions and
- * limitations under the License.
- */
-#pragma once
-#include "types.hpp"
-
-// Deklaracja glownej funkcji lexera.
-// Bierze string z kodem i zwraca wektor tokenow.
-vector<Token> tokenize(const string& source);
\ No newline at end of file
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include "types.hpp"
+#include "scan.hpp"
+
+// Lexer czyta kod na zadanie: kazde wywolanie next() daje jeden token, wiec parser nie czeka
+// na caly wektor tokenow. Tokeny wskazuja w 'source' (bez kopiowania tekstu).
+// Dlugie ciagi (biale znaki, nazwy, liczby, stringi) przeszukuje scan.hpp, po kilkanascie znakow naraz.
+class Lexer {
+public:
+    explicit Lexer(string_view source, const ScanKernels& scan = scan_kernels()) : source(source), scan(scan) {}
+
+    // Wpisuje nastepny token do 'token'. false, gdy kod sie skonczyl.
+    bool next(Token& token);
+
+private:
+    string_view source;
+    const ScanKernels& scan;
+    size_t pos = 0; // nasz aktualny wskaznik na znak w kodzie
+
+    void read_string(Token& token);
+};
+
+// Wszystkie tokeny naraz, gdy potrzebna jest cala lista.
+vector<Token> tokenize(string_view source);
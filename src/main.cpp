@@ -16,26 +16,88 @@
 #include "types.hpp"
 #include "lexer.hpp"
 #include "parser.hpp"
+#include "optimizer.hpp"
 #include "evaluator.hpp"
+#include "compiler.hpp"
+#include "vm.hpp"
+#include "builtins.hpp"
+#include "jit.hpp"
+#include "transpiler.hpp"
+#include "cache.hpp"
+#include "profiler.hpp"
+#include "memstats.hpp"
+#include "io.hpp"
+#include "parallel.hpp"
+#include "batch.hpp"
+#include <cstdlib>
 #include <fstream>
-#include <sstream>
 #include <iostream>
+#include <new>
 
-// Pomocnicza funkcja do zamiany naszej wartosci Value na string
-string value_to_string(const Value& val) {
-    if (val.type == TYPE_NUMBER) return to_string(get<int_fast64_t>(val.data));
-    if (val.type == TYPE_STRING) return get<string>(val.data);
-    return "nil";
-}
-
-// Druga pomocnicza funkcja, wypisuje wartosc na standardowe wyjscie
-void print_value(const Value& val) {
-    cout << value_to_string(val);
+// --mem-stats: globalny operator new liczy wszystkie alokacje procesu (tez te z biblioteki standardowej)
+void* operator new(size_t size) {
+    if (mem_stats_enabled) {
+        mem_total_allocations.fetch_add(1, memory_order_relaxed);
+        mem_total_bytes.fetch_add(size, memory_order_relaxed);
+    }
+    if (void* ptr = malloc(size ? size : 1)) return ptr;
+    throw bad_alloc();
 }
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete[](void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { free(ptr); }
 
 int main(int argc, char* argv[]) {
+    // Program pisze przez wlasny bufor (io.hpp), a input czyta z cin - bez synchronizacji z stdio jest szybciej
+    ios::sync_with_stdio(false);
+    cin.tie(nullptr);
+
+    // Opcje zaczynajace sie od "--", potem nazwa pliku (z --batch dowolnie wiele nazw)
+    bool batch = false;     // --batch: wiele skryptow naraz w jednym procesie (batch.hpp)
+    bool tree_walk = false; // --tree-walk: stary evaluator drzewa zamiast maszyny wirtualnej
+    bool emit = false;      // --emit-cpp: zamiast wykonywac, wypisuje program jako zrodlo C++
+    bool dump = false;      // --dump-ast: zamiast wykonywac, wypisuje drzewo po optymalizacji
+    bool use_cache = true;  // --no-cache: zawsze kompiluje od zera i nie zapisuje pliku .blc
+    string profile_path;    // --profile PLIK: stosy dla flamegraphow do pliku, tabelka na stderr
+    int arg_index = 1;
+    for (; arg_index < argc && string_view(argv[arg_index]).starts_with("--"); ++arg_index) {
+        string option = argv[arg_index];
+        if (option == "--batch") batch = true;
+        else if (option == "--tree-walk") tree_walk = true;
+        else if (option == "--jit") jit_enabled = true;
+        else if (option == "--emit-cpp") emit = true;
+        else if (option == "--dump-ast") dump = true;
+        else if (option == "--no-cache") use_cache = false;
+        else if (option == "--mem-stats") mem_stats_enabled = true;
+        else if (option == "--profile" && arg_index + 1 < argc) profile_path = argv[++arg_index];
+        else if (option == "--threads" && arg_index + 1 < argc) {
+            // --threads N: ile watkow maja pmap i spawn (razem z glownym)
+            string count = argv[++arg_index];
+            if (count.empty() || count.size() > 4 || count.find_first_not_of("0123456789") != string::npos || stoul(count) == 0) {
+                cerr << "Error: --threads expects a positive number" << endl;
+                goto error_label;
+            }
+            thread_count = stoul(count);
+        }
+        else if (option == "--max-depth" && arg_index + 1 < argc) {
+            // --max-depth N: ile zagniezdzonych wywolan funkcji pozwalamy zrobic
+            string depth = argv[++arg_index];
+            if (depth.empty() || depth.size() > 18 || depth.find_first_not_of("0123456789") != string::npos) {
+                cerr << "Error: --max-depth expects a number" << endl;
+                goto error_label;
+            }
+            max_call_depth = stoull(depth);
+        }
+        else {
+            cerr << "Error: Unknown option '" << option << "'" << endl;
+            goto error_label;
+        }
+    }
+
     // Sprawdzamy czy podano nazwe pliku jako argument
-    if (argc != 2) {
+    if (!batch && arg_index != argc - 1) {
         error_label:
         cout
             << endl
@@ -48,47 +110,128 @@ int main(int argc, char* argv[]) {
             << "# Github: https://github.com/KamilMalicki/bracket-language             #"
             << endl
             << "########################################################################";
-        cerr << endl << "Usage: " << argv[0] << " <filename.bl>" << endl;
+        cerr << endl << "Usage: " << argv[0] << " [--batch] [--tree-walk] [--jit] [--emit-cpp] [--dump-ast] [--no-cache] [--profile FILE] [--mem-stats] [--threads N] [--max-depth N] <filename.bl>" << endl
+             << "       " << argv[0] << " --batch [options] [<filename.bl> ...]   (without files: one file name per line on stdin)" << endl;
         return 1;
     }
 
+    if (!profile_path.empty() && tree_walk) {
+        cerr << "Error: --profile works only with the virtual machine, not with --tree-walk" << endl;
+        goto error_label;
+    }
+
+    // pmap i spawn wywoluja funkcje tym samym silnikiem co reszta programu.
+    // Evaluator drzewa nie jest przygotowany na watki (wspolne srodowiska), wiec z nim zadania ida po kolei.
+    call_function = tree_walk ? evaluate_function : run_function;
+    if (tree_walk) thread_count = 1;
+
+    if (batch) {
+        if (emit || dump || !profile_path.empty()) {
+            cerr << "Error: --batch cannot be combined with --emit-cpp, --dump-ast or --profile" << endl;
+            goto error_label;
+        }
+        vector<string> files(argv + arg_index, argv + argc);
+        if (files.empty()) {
+            for (string line; getline(cin, line);) {
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                if (!line.empty()) files.push_back(line);
+            }
+        }
+        int exit_code = run_batch(files, BatchOptions{tree_walk, use_cache});
+        parallel_shutdown();
+        output_flush();
+        if (mem_stats_enabled) print_mem_stats(cerr);
+        return exit_code;
+    }
+
     // Sprawdzamy czy rozszerzenie pliku jest poprawne i czy jest to .bl
-    string filename = argv[1];
+    string filename = argv[arg_index];
     if (filename.size() < 3 || filename.substr(filename.size() - 3) != ".bl") {
         cerr << "Error: Only .bl files are allowed" << endl;
         goto error_label;
     }
 
     // Otwieramy plik i wczytujemy go do bufora
-    ifstream file(filename);
+    ifstream file(filename, ios::binary);
     if (!file.is_open()) {
         cerr << "Error: Could not open file '" << filename << "'" << endl;
         goto error_label;
     }
 
-    // Tworzymy bufor do wczytania całego pliku i zapisujemy go do stringa
-    stringstream buffer;
-    buffer << file.rdbuf();
-    string source_code = buffer.str();
+    // Wczytujemy caly plik do stringa jednym odczytem (rozmiar znamy z gory)
+    file.seekg(0, ios::end);
+    string source_code(static_cast<size_t>(file.tellg()), '\0');
+    file.seekg(0, ios::beg);
+    file.read(source_code.data(), source_code.size());
+
+    // Wykonanie na maszynie wirtualnej, z --profile pod profilerem.
+    // Profil czyta liczniki z kodu, wiec program musi zyc do finish, takze po bledzie.
+    shared_ptr<Chunk> profiled;
+    auto execute = [&](shared_ptr<Chunk> program, Environment& global_env) {
+        if (!profile_path.empty()) {
+            profiled = program;
+            profile_start(*program, source_code);
+        }
+        run(*program, global_env);
+    };
+    // Koniec programu. Profil i statystyki pamieci wypisujemy takze po bledzie - wtedy pokazuja, co dzialo sie do jego wystapienia.
+    auto finish = [&](int exit_code) {
+        parallel_shutdown();
+        output_flush();
+        if (profile_enabled) {
+            ofstream folded(profile_path);
+            if (!folded.is_open()) {
+                cerr << "Error: Could not write profile to '" << profile_path << "'" << endl;
+                exit_code = 1;
+            }
+            profile_finish(folded, cerr, 20);
+        }
+        if (mem_stats_enabled) print_mem_stats(cerr);
+        return exit_code;
+    };
 
     // Glowny blok try-catch, zeby lapac wszystkie bledy z interpretera
     try {
         Environment global_env; // Tworzymy globalne srodowisko dla zmiennych
-        // Krok 1: Tokenizacja kodu
-        vector<Token> tokens = tokenize(source_code);
-        // Krok 2: Parsowanie tokenow na wyrazenia
-        ExpressionList expressions = parse(tokens);
-        // Krok 3: Wykonanie kazdego wyrazenia z osobna
-        for (const auto& expr : expressions) evaluate(expr, global_env);
+        // Skrot: jesli obok zrodla lezy aktualny plik .blc, uruchamiamy bajtkod prosto z niego
+        bool cached = use_cache && !tree_walk && !emit && !dump;
+        if (cached) {
+            if (shared_ptr<Chunk> program = load_cache(cache_path(filename), source_code)) {
+                execute(program, global_env);
+                return finish(0);
+            }
+        }
+        // Krok 1 i 2: Tokenizacja i parsowanie na wyrazenia - parser bierze tokeny z lexera na biezaco.
+        // Tokeny w drzewie wskazuja w source_code, ktory zyje do konca main.
+        Ast ast = parse(source_code);
+        // Krok 2.5: Optymalizacja drzewa (stale, martwe galezie)
+        optimize(ast);
+        if (dump) {
+            dump_ast(ast, cout);
+            return finish(0);
+        }
+        // Krok 3: Wykonanie - domyslnie kompilujemy do bajtkodu i puszczamy na maszynie wirtualnej,
+        // a --tree-walk wykonuje kazde wyrazenie z osobna starym evaluatorem (do porownywania wynikow)
+        if (emit) {
+            emit_cpp(*compile(ast), filename, cout);
+        } else if (tree_walk) {
+            const Node& program = ast[ast.root];
+            for (size_t i = 0; i < program.count; ++i) evaluate(ast, program.child(i), global_env);
+        } else {
+            shared_ptr<Chunk> program = compile(ast);
+            if (cached) save_cache(cache_path(filename), source_code, *program);
+            execute(program, global_env);
+        }
 
     }
     // W przypadku wystapienia wyjatku, wypisujemy informacje o bledzie
     catch (const exception& e) {
-        // Wypisujemy bledy na standardowe wyjscie
+        // Wypisujemy bledy na standardowe wyjscie (po tym, co program zdazyl wypisac)
+        output_flush();
         cerr << "Execution error: " << e.what() << endl;
-        return 1;
+        return finish(1);
     }
 
     // Wypisujemy wartosci zmiennych globalnych na standardowe wyjscie
-    return 0;
+    return finish(0);
 }
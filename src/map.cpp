@@ -0,0 +1,112 @@
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "builtins.hpp"
+
+#include <stdexcept>
+
+// Slowniki: tablica z otwartym adresowaniem (MapObject w value.hpp).
+// map_put i map_delete oddaja nowy slownik jak array_push. Zwykle wywolanie kopiuje caly slownik, bo argument
+// trzyma go dalej - dlatego (def m (map_put m k v)) idzie przez wersje _into, ktora zmienia zmienna w miejscu.
+
+static void require_map(const Value& val, const char* message) {
+    if (val.type() != TYPE_MAP) throw runtime_error(message);
+}
+
+static void require_key(const Value& key) {
+    if (key.type() != TYPE_NUMBER && key.type() != TYPE_STRING) throw runtime_error("Type error: Map keys must be numbers or strings.");
+}
+
+Value builtin_map(const Value* args, size_t count) {
+    if (count % 2 != 0) throw runtime_error("'map' requires pairs of keys and values, but received " + to_string(count) + " arguments.");
+    Value result = Value::map(new MapObject());
+    for (size_t i = 0; i < count; i += 2) {
+        require_key(args[i]);
+        result.map_put(args[i], args[i + 1]);
+    }
+    return result;
+}
+
+Value builtin_map_put(const Value& map, const Value& key, const Value& value) {
+    require_map(map, "Type error: The first argument to 'map_put' must be a map.");
+    require_key(key);
+    Value result = map;
+    result.map_put(key, value);
+    return result;
+}
+
+Value builtin_map_delete(const Value& map, const Value& key) {
+    require_map(map, "Type error: The first argument to 'map_delete' must be a map.");
+    require_key(key);
+    Value result = map;
+    result.map_erase(key);
+    return result;
+}
+
+// 'map' to wartosc zmiennej wczytana przed kluczem i wartoscia. Jesli zmienna nadal trzyma ten sam slownik,
+// oddajemy kopie ze stosu i zmieniamy go w miejscu. Jesli klucz albo wartosc przypisaly cos do zmiennej,
+// liczymy jak zwykle map_put od starej wartosci.
+void builtin_map_put_into(Value& target, Value map, const Value& key, const Value& value) {
+    if (!map.same_object(target)) {
+        target = builtin_map_put(map, key, value);
+        return;
+    }
+    require_map(map, "Type error: The first argument to 'map_put' must be a map.");
+    require_key(key);
+    map = Value{};
+    target.map_put(key, value);
+}
+
+void builtin_map_delete_into(Value& target, Value map, const Value& key) {
+    if (!map.same_object(target)) {
+        target = builtin_map_delete(map, key);
+        return;
+    }
+    require_map(map, "Type error: The first argument to 'map_delete' must be a map.");
+    require_key(key);
+    map = Value{};
+    target.map_erase(key);
+}
+
+// Brakujacy klucz daje nil (a map_has mowi, czy klucz jest)
+Value builtin_map_get(const Value& map, const Value& key) {
+    require_map(map, "Type error: The first argument to 'map_get' must be a map.");
+    require_key(key);
+    const Value* value = map.as_map().find(key);
+    return value ? *value : Value{};
+}
+
+Value builtin_map_has(const Value& map, const Value& key) {
+    require_map(map, "Type error: The first argument to 'map_has' must be a map.");
+    require_key(key);
+    return Value::number(map.as_map().find(key) != nullptr);
+}
+
+Value builtin_map_size(const Value& map) {
+    require_map(map, "Type error: The argument to 'map_size' must be a map.");
+    return Value::number(map.as_map().count);
+}
+
+// Klucze w kolejnosci dodawania
+Value builtin_map_keys(const Value& map) {
+    require_map(map, "Type error: The argument to 'map_keys' must be a map.");
+    const MapObject& obj = map.as_map();
+    vector<Value> keys;
+    keys.reserve(obj.count);
+    for (const MapObject::Entry& entry : obj.entries) {
+        if (entry.key.type() != TYPE_UNDEFINED) keys.push_back(entry.key);
+    }
+    return builtin_array(keys.data(), keys.size());
+}
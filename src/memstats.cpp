@@ -0,0 +1,63 @@
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "memstats.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+bool mem_stats_enabled = false;
+MemCounter mem_counters[MEM_CATEGORY_COUNT];
+atomic<uint64_t> mem_value_copies{0};
+atomic<uint64_t> mem_total_allocations{0};
+atomic<uint64_t> mem_total_bytes{0};
+
+static const char* CATEGORY_NAMES[MEM_CATEGORY_COUNT] = {"environments", "strings", "closures", "ast nodes", "arrays", "maps"};
+
+// Szczytowe RSS w kilobajtach (0 gdy system nie mowi)
+static uint64_t peak_rss_kb() {
+#ifndef _WIN32
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;  // na macOS w bajtach
+#else
+    return usage.ru_maxrss;
+#endif
+#else
+    return 0;
+#endif
+}
+
+void print_mem_stats(ostream& out) {
+    char line[160];
+    snprintf(line, sizeof(line), "Memory: peak RSS %.1f MB, %llu allocations (%.1f MB) in total\n",
+             peak_rss_kb() / 1024.0, (unsigned long long)mem_total_allocations, mem_total_bytes / 1048576.0);
+    out << line;
+    out << "category         allocations        MB  peak live MB   still live MB      copies\n";
+    for (int i = 0; i < MEM_CATEGORY_COUNT; ++i) {
+        const MemCounter& counter = mem_counters[i];
+        snprintf(line, sizeof(line), "%-14s %13llu %9.1f %13.1f %15.1f %11llu\n", CATEGORY_NAMES[i],
+                 (unsigned long long)counter.allocations, counter.bytes / 1048576.0, counter.peak / 1048576.0,
+                 max<int64_t>(counter.live, 0) / 1048576.0, (unsigned long long)counter.copies);
+        out << line;
+    }
+    snprintf(line, sizeof(line), "Value copies sharing a heap string, array, map or function: %llu\n", (unsigned long long)mem_value_copies);
+    out << line;
+}
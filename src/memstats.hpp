@@ -0,0 +1,93 @@
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+
+using namespace std;
+
+// Statystyki pamieci (opcja --mem-stats).
+//
+// Pamiec jest liczona w kilku kategoriach: srodowiska (Environment z evaluatora drzewa), stringi na stercie,
+// domkniecia (funkcje razem z ich wartosciami), wezly drzewa programu, tablice i slowniki. Kontenery tych kategorii uzywaja
+// CountingAllocator, a obiekty (StringObject, ArrayObject, MapObject, BraceFunction) zglaszaja sie same przy tworzeniu i niszczeniu.
+// Do tego liczba kopii Value wskazujacych na obiekt i kopii calych srodowisk, a na koniec szczytowe RSS procesu.
+// Bez --mem-stats kazde z tych miejsc to tylko sprawdzenie flagi. Liczniki sa atomowe, bo licza tez watki z pmap i spawn.
+
+enum MemCategory { MEM_ENVIRONMENT, MEM_STRING, MEM_CLOSURE, MEM_AST, MEM_ARRAY, MEM_MAP, MEM_CATEGORY_COUNT };
+
+struct MemCounter {
+    atomic<uint64_t> allocations{0};   // ile razy przydzielono pamiec
+    atomic<uint64_t> bytes{0};         // ile bajtow lacznie
+    atomic<int64_t> live{0};           // ile bajtow jest teraz w uzyciu (obiekty sprzed --mem-stats nie sa liczone)
+    atomic<int64_t> peak{0};           // najwiecej naraz
+    atomic<uint64_t> copies{0};        // kopie calych kontenerow (np. calego srodowiska)
+};
+
+// Ustawiane przez --mem-stats
+extern bool mem_stats_enabled;
+extern MemCounter mem_counters[MEM_CATEGORY_COUNT];
+extern atomic<uint64_t> mem_value_copies;        // kopie Value ze stringiem na stercie albo funkcja (++refcount)
+// Wszystkie alokacje procesu - liczy je globalny operator new w main.cpp
+extern atomic<uint64_t> mem_total_allocations;
+extern atomic<uint64_t> mem_total_bytes;
+
+inline void mem_allocated(MemCategory category, size_t bytes) {
+    MemCounter& counter = mem_counters[category];
+    counter.allocations.fetch_add(1, memory_order_relaxed);
+    counter.bytes.fetch_add(bytes, memory_order_relaxed);
+    int64_t live = counter.live.fetch_add(bytes, memory_order_relaxed) + bytes;
+    int64_t peak = counter.peak.load(memory_order_relaxed);
+    while (live > peak && !counter.peak.compare_exchange_weak(peak, live, memory_order_relaxed)) {}
+}
+
+inline void mem_freed(MemCategory category, size_t bytes) {
+    mem_counters[category].live.fetch_sub(bytes, memory_order_relaxed);
+}
+
+// Alokator kontenerow, ktory liczy pamiec w swojej kategorii. Bez stanu - wszystkie sa sobie rowne.
+template <class T, MemCategory category>
+struct CountingAllocator {
+    using value_type = T;
+    template <class U> struct rebind { using other = CountingAllocator<U, category>; };
+
+    CountingAllocator() = default;
+    template <class U> CountingAllocator(const CountingAllocator<U, category>&) {}
+
+    T* allocate(size_t n) {
+        if (mem_stats_enabled) mem_allocated(category, n * sizeof(T));
+        return allocator<T>().allocate(n);
+    }
+    void deallocate(T* p, size_t n) {
+        if (mem_stats_enabled) mem_freed(category, n * sizeof(T));
+        allocator<T>().deallocate(p, n);
+    }
+    // Kontener wola to przy kopiowaniu calego siebie - tak liczymy kopie srodowisk
+    CountingAllocator select_on_container_copy_construction() const {
+        if (mem_stats_enabled) mem_counters[category].copies.fetch_add(1, memory_order_relaxed);
+        return *this;
+    }
+
+    template <class U> bool operator==(const CountingAllocator<U, category>&) const { return true; }
+    template <class U> bool operator!=(const CountingAllocator<U, category>&) const { return false; }
+};
+
+// Wypisuje tabelke z licznikami i szczytowym RSS procesu
+void print_mem_stats(ostream& out);
@@ -0,0 +1,171 @@
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "optimizer.hpp"
+#include "builtins.hpp"
+
+#include <stdexcept>
+
+static void optimize_node(Ast& ast, Node& node, bool value_position);
+
+// Liczba albo string z juz zdekodowana wartoscia
+static bool is_literal(const Node& node) {
+    const Token& token = node.token;
+    return (token.type == TOKEN_NUMBER || token.type == TOKEN_STRING) && token.constant.type() != TYPE_UNDEFINED;
+}
+
+static void decode_literal(Token& token) {
+    // Stringi z sekwencjami ucieczki sa juz zdekodowane przez lexer
+    if (token.type == TOKEN_STRING && token.constant.type() == TYPE_UNDEFINED) token.constant = Value::string(token.text);
+    if (token.type == TOKEN_NUMBER) {
+        // Za duza liczba zostaje bez wartosci - stoll rzuci blad dopiero gdy program do niej dojdzie
+        try {
+            token.constant = Value::number(stoll(string(token.text)));
+        } catch (const exception&) {}
+    }
+}
+
+// Nowy token nie ma tekstu w zrodle - liczy sie tylko constant
+static Node literal_node(Value val) {
+    Token token{val.type() == TYPE_NUMBER ? TOKEN_NUMBER : TOKEN_STRING, {}};
+    token.constant = std::move(val);
+    return Node{std::move(token)};
+}
+
+// Czy wezel na tym miejscu mozna zamienic na 'with'. Lista na liste - zawsze.
+// Na token tylko tam, gdzie na pewno stoi wartosc: lista na miejscu operatora to inny blad niz token,
+// a slowo kluczowe na poczatku listy zmieniloby jej znaczenie (((do print) 1) to nie (print 1)).
+static bool can_replace(const Node& with, bool value_position) {
+    if (with.is_list()) return true;
+    const Token& token = with.token;
+    if (!value_position) return false;
+    if (token.type == TOKEN_IDENTIFIER) return !is_keyword(token.symbol);
+    return token.type == TOKEN_NUMBER || token.type == TOKEN_STRING;
+}
+
+// Zamiany robimy w miejscu: wezel dostaje kopie innego wezla (elementy listy zostaja tam gdzie byly),
+// a policzony poczatek listy jest z niej wycinany przesunieciem 'first'. Drzewo nigdy nie rosnie.
+static void fold_infix(Ast& ast, Node& node, bool value_position) {
+    span<Node> list = ast.list(node);
+    Value result = list[0].token.constant;
+    size_t folded = 1;  // tyle elementow poczatku listy jest juz w 'result'
+    while (folded + 1 < list.size() && is_literal(list[folded + 1]) && !list[folded].is_list()) {
+        const Token& op = list[folded].token;
+        InfixOp infix = infix_op_of(op);
+        if (op.type != TOKEN_OPERATOR || infix == INFIX_UNKNOWN) break;
+        Value left = result;
+        try {
+            apply_infix(infix, op.text, left, list[folded + 1].token.constant);
+        } catch (const exception&) {
+            break; // blad zostaje na czas wykonania
+        }
+        result = std::move(left);
+        folded += 2;
+    }
+    if (folded == 1) return;
+
+    Node constant = literal_node(std::move(result));
+    if (folded == list.size()) {
+        if (can_replace(constant, value_position)) node = std::move(constant);
+        return;
+    }
+    list[folded - 1] = std::move(constant);
+    node.first += folded - 1;
+    node.count -= folded - 1;
+}
+
+static void optimize_list(Ast& ast, Node& node, bool value_position) {
+    span<Node> list = ast.list(node);
+    if (list.empty()) return;
+
+    const Node& head = list[0];
+    if (head.token.type == TOKEN_IDENTIFIER && is_keyword(head.token.symbol)) {
+        Symbol keyword = head.token.symbol;
+        for (size_t i = 1; i < list.size(); ++i) {
+            // Nazwy w 'def', 'set' i parametry 'fun' zostaja jak sa
+            if (i == 1 && (keyword == KW_DEF || keyword == KW_SET || keyword == KW_FUN)) continue;
+            optimize_node(ast, list[i], true);
+        }
+        if (keyword == KW_IF && list.size() == 3 && is_literal(list[1])) {
+            if (!is_truthy(list[1].token.constant)) {
+                node.count = 0;  // () czyli nil
+            } else if (can_replace(list[2], value_position)) {
+                node = Node(list[2]);
+            }
+        } else if (keyword == KW_DO && list.size() == 2 && can_replace(list[1], value_position)) {
+            node = Node(list[1]);
+        }
+        return;
+    }
+
+    // Wywolanie albo lancuch infiksowy. Na nieparzystych miejscach moze stac operator.
+    for (size_t i = 0; i < list.size(); ++i) optimize_node(ast, list[i], i % 2 == 0);
+    if (is_literal(list[0])) fold_infix(ast, node, value_position);
+}
+
+static void optimize_node(Ast& ast, Node& node, bool value_position) {
+    if (!node.is_list()) {
+        decode_literal(node.token);
+        return;
+    }
+    optimize_list(ast, node, value_position);
+}
+
+void optimize(Ast& ast) {
+    for (Node& node : ast.list(ast[ast.root])) optimize_node(ast, node, true);
+}
+
+static void dump_node(const Ast& ast, const Node& node, ostream& out) {
+    if (node.is_list()) {
+        span<const Node> list = ast.list(node);
+        out << '(';
+        for (size_t i = 0; i < list.size(); ++i) {
+            if (i > 0) out << ' ';
+            dump_node(ast, list[i], out);
+        }
+        out << ')';
+        return;
+    }
+    const Token& token = node.token;
+    // Liczby policzone przez optymalizator nie maja tekstu w zrodle
+    if (token.type == TOKEN_NUMBER && token.text.empty()) {
+        out << token.constant.as_number();
+        return;
+    }
+    if (token.type != TOKEN_STRING) {
+        out << token.text;
+        return;
+    }
+    // Stringi z cudzyslowami i tymi samymi sekwencjami, ktore rozumie lexer
+    out << '"';
+    for (char c : token_text(token)) {
+        switch (c) {
+            case '\n': out << "\\n"; break;
+            case '\t': out << "\\t"; break;
+            case '\r': out << "\\r"; break;
+            case '"': out << "\\\""; break;
+            case '\\': out << "\\\\"; break;
+            default: out << c; break;
+        }
+    }
+    out << '"';
+}
+
+void dump_ast(const Ast& ast, ostream& out) {
+    for (const Node& node : ast.program()) {
+        dump_node(ast, node, out);
+        out << '\n';
+    }
+}
@@ -0,0 +1,33 @@
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include "types.hpp"
+
+#include <ostream>
+
+// Optymalizator drzewa - przebieg miedzy parse() a wykonaniem (w kazdym trybie).
+//
+//  - liczby i stringi dostaja gotowa wartosc w Token::constant (bez stoll przy kazdym wykonaniu),
+//  - stale lancuchy infiksowe sa liczone od razu, od lewej do prawej jak w czasie wykonania:
+//    (100 - 20 + 5) -> 85, a z (1 + 2 + x) zostaje (3 + x),
+//  - (if stala cialo) zamienia sie w cialo albo w () (czyli nil),
+//  - (do x) zamienia sie w x.
+// Program po optymalizacji robi dokladnie to samo, lacznie z bledami - dzialania, ktore rzucaja blad
+// (np. dzielenie przez zero), zostaja na czas wykonania.
+void optimize(Ast& ast);
+
+// Wypisuje drzewo jako S-wyrazenia, jedno wyrazenie glowne w linii (opcja --dump-ast)
+void dump_ast(const Ast& ast, ostream& out);
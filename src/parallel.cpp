@@ -0,0 +1,405 @@
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "parallel.hpp"
+#include "builtins.hpp"
+#include "compiler.hpp"
+#include "io.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+
+size_t thread_count = 0;
+atomic<bool> threads_started{false};
+atomic<bool> host_threads{false};
+thread_local bool in_task = false;
+Value (*call_function)(const Value& function, const Value* args, size_t count) = nullptr;
+
+// Jedno zadanie: spawn, kawalek pmap albo skrypt z --batch. Wynik (albo tekst bledu) czyta ten, kto czeka na done.
+// Gdy watek, ktory je utworzyl, mial przechwycone wyjscie, print w zadaniu pisze do 'output', a po done
+// tekst przejmuje (raz) join, pmap albo SpawnScope::finish. Inaczej print pisze prosto na wyjscie.
+struct Task {
+    function<Value()> work;
+    bool captured = false;
+    string output;
+    atomic<bool> output_taken{false};
+    Value result;
+    string error;
+    bool failed = false;
+    atomic<bool> done{false};
+};
+
+// Kolejka jednego watku. [0] to watek glowny (i kazdy inny spoza puli).
+struct TaskQueue {
+    mutex lock;
+    deque<shared_ptr<Task>> tasks;
+};
+
+// Kolejki i watki robocze. Zmienia je tylko start_pool i parallel_shutdown, pod pool_mutex.
+static vector<unique_ptr<TaskQueue>> queues;
+static vector<thread> workers;
+static mutex pool_mutex;
+static atomic<bool> pool_ready{false};
+static thread_local size_t queue_index = 0;
+static atomic<size_t> queued{0};           // zadania czekajace w kolejkach
+static atomic<size_t> tasks_in_flight{0};  // utworzone i jeszcze nieskonczone
+static atomic<bool> stopping{false};
+// Budzi watki bez pracy i czekajacych w join: nowe zadanie albo koniec zadania
+static mutex wake_mutex;
+static condition_variable wake;
+
+// Uchwyty z spawn dla join: indeks + 1, zwolnione miejsca sa uzywane ponownie
+static mutex handles_mutex;
+static vector<shared_ptr<Task>> handles;
+
+static thread_local SpawnScope* spawn_scope = nullptr;
+
+bool code_writable(const Chunk& chunk) {
+    // Obok kontekstow z bracket.hpp w innych watkach kod moze czytac ktos, kogo tu nie widac
+    if (chunk.frozen || host_threads.load(memory_order_relaxed)) return false;
+    return !threads_started || (!in_task && tasks_in_flight.load(memory_order_acquire) == 0);
+}
+
+static void notify_all() {
+    { lock_guard<mutex> guard(wake_mutex); }
+    wake.notify_all();
+}
+
+// Przechwycone wyjscie skonczonego zadania trafia tam, gdzie pisze ten watek
+static void take_output(Task& task) {
+    if (!task.captured || task.output_taken.exchange(true)) return;
+    output_write(task.output);
+    string().swap(task.output);
+}
+
+static void run_task(Task& task) {
+    bool outer = in_task;
+    string* outer_output = output_capture;
+    in_task = true;
+    output_capture = task.captured ? &task.output : nullptr;
+    {
+        SpawnScope scope;
+        try {
+            task.result = task.work();
+        } catch (const exception& e) {
+            task.error = e.what();
+            task.failed = true;
+        }
+        task.work = nullptr;  // funkcja i argumenty znikaja jeszcze w tym watku
+    }
+    in_task = outer;
+    output_capture = outer_output;
+    task.done.store(true, memory_order_release);
+    tasks_in_flight.fetch_sub(1, memory_order_release);
+    notify_all();
+}
+
+// Najmlodsze zadanie z wlasnej kolejki albo najstarsze z cudzej
+static shared_ptr<Task> take() {
+    if (queued.load(memory_order_acquire) == 0) return nullptr;
+    size_t count = queues.size();
+    for (size_t k = 0; k < count; ++k) {
+        TaskQueue& queue = *queues[(queue_index + k) % count];
+        lock_guard<mutex> guard(queue.lock);
+        if (queue.tasks.empty()) continue;
+        shared_ptr<Task> task;
+        if (k == 0) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        queued.fetch_sub(1, memory_order_relaxed);
+        return task;
+    }
+    return nullptr;
+}
+
+static void worker_loop(size_t index) {
+    queue_index = index;
+    while (!stopping.load(memory_order_acquire)) {
+        if (shared_ptr<Task> task = take()) {
+            run_task(*task);
+            continue;
+        }
+        unique_lock<mutex> guard(wake_mutex);
+        wake.wait(guard, [] { return stopping.load() || queued.load() > 0; });
+    }
+}
+
+// Pula startuje przy pierwszym zadaniu. Zwykle z glownego watku, ale konteksty z bracket.hpp
+// moga tworzyc pierwsze zadania w kilku watkach naraz - wystartuje tylko jeden z nich.
+static void start_pool() {
+    if (pool_ready.load(memory_order_acquire)) return;
+    lock_guard<mutex> guard(pool_mutex);
+    if (pool_ready.load(memory_order_relaxed)) return;
+    size_t size = thread_count ? thread_count : max(1u, thread::hardware_concurrency());
+    for (size_t i = 0; i < size; ++i) queues.push_back(make_unique<TaskQueue>());
+    // Jeden watek: zadania wykonuje ten, kto na nie czeka
+    if (size > 1) {
+        threads_started = true;
+        for (size_t i = 1; i < size; ++i) workers.emplace_back(worker_loop, i);
+    }
+    pool_ready.store(true, memory_order_release);
+}
+
+void parallel_shutdown() {
+    lock_guard<mutex> guard(pool_mutex);
+    if (!pool_ready.load(memory_order_relaxed)) return;
+    // Zadania, na ktore nikt nie czekal (spawn bez join), tez sie wykonuja - przy jednym watku dopiero tutaj.
+    // Ten watek pomaga, jak w join.
+    while (tasks_in_flight.load(memory_order_acquire) > 0) {
+        if (shared_ptr<Task> task = take()) {
+            run_task(*task);
+            continue;
+        }
+        unique_lock<mutex> wait_guard(wake_mutex);
+        wake.wait(wait_guard, [] { return tasks_in_flight.load(memory_order_acquire) == 0 || queued.load() > 0; });
+    }
+    stopping = true;
+    notify_all();
+    for (thread& worker : workers) worker.join();
+    workers.clear();
+    queues.clear();
+    handles.clear();
+    queued = 0;
+    tasks_in_flight = 0;
+    stopping = false;
+    threads_started = false;
+    pool_ready = false;
+}
+
+// Na wypadek wyjscia z programu bez parallel_shutdown
+static struct ShutdownAtExit {
+    ~ShutdownAtExit() { parallel_shutdown(); }
+} shutdown_at_exit;
+
+static void submit(shared_ptr<Task> task) {
+    task->captured = output_capture != nullptr;
+    tasks_in_flight.fetch_add(1, memory_order_relaxed);
+    {
+        TaskQueue& queue = *queues[queue_index];
+        lock_guard<mutex> guard(queue.lock);
+        queue.tasks.push_back(std::move(task));
+    }
+    queued.fetch_add(1, memory_order_release);
+    notify_all();
+}
+
+// Czekajac na zadanie, watek wykonuje inne
+static void wait_for(Task& task) {
+    while (!task.done.load(memory_order_acquire)) {
+        if (shared_ptr<Task> other = take()) {
+            run_task(*other);
+            continue;
+        }
+        unique_lock<mutex> guard(wake_mutex);
+        wake.wait(guard, [&] { return task.done.load(memory_order_acquire) || queued.load() > 0; });
+    }
+}
+
+SpawnScope::SpawnScope() : outer(spawn_scope) {
+    spawn_scope = this;
+}
+
+SpawnScope::~SpawnScope() {
+    finish();
+    spawn_scope = outer;
+}
+
+void SpawnScope::add(shared_ptr<Task> task) {
+    // Przechwycone wyjscie zadania czeka na finish. Pozostale zadania nikogo tu nie obchodza.
+    if (task->captured) tasks.push_back(std::move(task));
+}
+
+void SpawnScope::finish() {
+    for (const auto& task : tasks) {
+        wait_for(*task);
+        take_output(*task);
+    }
+    tasks.clear();
+}
+
+static void freeze_value(const Value& val);
+
+static void freeze_chunk(const Chunk& chunk) {
+    if (chunk.frozen) return;
+    chunk.frozen = true;
+    for (const Value& constant : chunk.constants) freeze_value(constant);
+    for (const auto& function : chunk.functions) freeze_chunk(*function);
+}
+
+// Zamraza wartosc razem ze wszystkim, do czego inny watek moze przez nia dojsc
+static void freeze_value(const Value& val) {
+    if (!val.is_heap() || val.is_frozen()) return;
+    val.freeze();
+    if (val.type() == TYPE_FUNCTION) {
+        const BraceFunction& func = val.as_function();
+        for (const Value& capture : func.captures) freeze_value(capture);
+        if (func.code) freeze_chunk(*func.code);
+    } else if (val.type() == TYPE_ARRAY && !val.as_array().packed) {
+        for (const Value& element : val.as_array().values) freeze_value(element);
+    } else if (val.type() == TYPE_MAP) {
+        for (const MapObject::Entry& entry : val.as_map().entries) {
+            freeze_value(entry.key);
+            freeze_value(entry.value);
+        }
+    }
+}
+
+void freeze_code(const Chunk& chunk) {
+    freeze_chunk(chunk);
+}
+
+void parallel_ordered(size_t count, const function<void(size_t)>& job, const function<void(size_t)>& done) {
+    start_pool();
+    vector<shared_ptr<Task>> tasks(count);
+    size_t window = queues.size() * 4;
+    size_t submitted = 0;
+    for (size_t i = 0; i < count; ++i) {
+        // Watek czekajacy bierze najpierw najmlodsze zadanie z wlasnej kolejki, wiec z przodu trzymamy tylko okno zadan
+        for (; submitted < count && submitted < i + window; ++submitted) {
+            tasks[submitted] = make_shared<Task>();
+            tasks[submitted]->work = [&job, submitted] {
+                job(submitted);
+                return Value{};
+            };
+            submit(tasks[submitted]);
+        }
+        wait_for(*tasks[i]);
+        tasks[i].reset();
+        done(i);
+    }
+}
+
+static void check_function(const Value& function, size_t arg_count, const char* message) {
+    if (function.type() != TYPE_FUNCTION) throw runtime_error(message);
+    const BraceFunction& func = function.as_function();
+    size_t expected = func.code ? func.code->parameter_count : func.parameters.size();
+    if (expected != arg_count) throw runtime_error("Incorrect number of arguments for function call. Expected " + to_string(expected) + ", but got " + to_string(arg_count) + ".");
+    if (!call_function) throw runtime_error("Critical error: No engine to run functions in parallel.");
+}
+
+Value builtin_spawn(const Value* args, size_t count) {
+    check_function(args[0], count - 1, "Type error: The first argument to 'spawn' must be a function.");
+    start_pool();
+    vector<Value> values(args, args + count);
+    if (multithreaded()) {
+        for (const Value& val : values) freeze_value(val);
+    }
+    auto task = make_shared<Task>();
+    task->work = [values = std::move(values)] { return call_function(values[0], values.data() + 1, values.size() - 1); };
+
+    size_t handle;
+    {
+        auto guard = lock_if_threads(handles_mutex);
+        handle = find(handles.begin(), handles.end(), nullptr) - handles.begin();
+        if (handle == handles.size()) handles.push_back(task);
+        else handles[handle] = task;
+    }
+    submit(task);
+    if (spawn_scope) spawn_scope->add(std::move(task));
+    return Value::number(handle + 1);
+}
+
+Value builtin_join(const Value& handle) {
+    shared_ptr<Task> task;
+    {
+        auto guard = lock_if_threads(handles_mutex);
+        if (handle.type() == TYPE_NUMBER) {
+            int_fast64_t index = handle.as_number() - 1;
+            if (index >= 0 && index < (int_fast64_t)handles.size()) task = std::move(handles[index]);
+        }
+    }
+    if (!task) throw runtime_error("Type error: 'join' expects a task handle from 'spawn'.");
+    wait_for(*task);
+    take_output(*task);
+    if (task->failed) throw runtime_error(task->error);
+    return std::move(task->result);
+}
+
+Value builtin_pmap(const Value& function, const Value& text_val) {
+    check_function(function, 1, "Type error: The first argument to 'pmap' must be a function.");
+    if (text_val.type() != TYPE_STRING) throw runtime_error("Type error: The second argument to 'pmap' must be a string.");
+
+    // Rekordy to linie tekstu. Koncowy '\n' nie otwiera pustego rekordu, ale zostaje na koncu wyniku.
+    string_view text = text_val.as_string();
+    bool trailing_newline = !text.empty() && text.back() == '\n';
+    if (trailing_newline) text.remove_suffix(1);
+    if (text.empty() && !trailing_newline) return Value::string("");
+    vector<string_view> records;
+    for (size_t start = 0;;) {
+        size_t end = text.find('\n', start);
+        if (end == string_view::npos) {
+            records.push_back(text.substr(start));
+            break;
+        }
+        records.push_back(text.substr(start, end - start));
+        start = end + 1;
+    }
+
+    vector<string> results(records.size());
+    auto apply = [&](size_t i) {
+        Value record = Value::string(records[i]);
+        results[i] = value_to_string(call_function(function, &record, 1));
+    };
+    // Pierwszy rekord liczymy od razu tutaj, poza zadaniami - maszyna wirtualna moze jeszcze podmienic instrukcje
+    // funkcji na wersje dla typow, ktore zobaczy, i z tego kodu skorzystaja potem wszystkie watki
+    apply(0);
+
+    if (records.size() > 1) {
+        start_pool();
+        if (multithreaded()) freeze_value(function);
+        // Kilka kawalkow na watek, zeby watki, ktore skoncza wczesniej, mialy co podkradac
+        size_t remaining = records.size() - 1;
+        size_t chunks = min(remaining, queues.size() * 4);
+        vector<shared_ptr<Task>> tasks;
+        for (size_t c = 0; c < chunks; ++c) {
+            size_t first = 1 + remaining * c / chunks, last = 1 + remaining * (c + 1) / chunks;
+            auto task = make_shared<Task>();
+            task->work = [&apply, first, last] {
+                for (size_t i = first; i < last; ++i) apply(i);
+                return Value{};
+            };
+            tasks.push_back(task);
+            submit(std::move(task));
+        }
+        // Czekamy na wszystkie (zadania uzywaja zmiennych tej funkcji), blad zglaszamy z pierwszego kawalka
+        for (const auto& task : tasks) {
+            wait_for(*task);
+            take_output(*task);
+        }
+        for (const auto& task : tasks) {
+            if (task->failed) throw runtime_error(task->error);
+        }
+    }
+
+    size_t size = 0;
+    for (const string& result : results) size += result.size() + 1;
+    string out;
+    out.reserve(size);
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (i > 0) out += '\n';
+        out += results[i];
+    }
+    if (trailing_newline) out += '\n';
+    return Value::string(std::move(out));
+}
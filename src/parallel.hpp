@@ -0,0 +1,97 @@
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include "types.hpp"
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+
+struct Chunk;
+struct Task;
+
+// Zadania na wielu watkach: pmap oraz spawn i join.
+//
+// Pula ma thread_count watkow razem z glownym (domyslnie tyle, ile rdzeni) i startuje przy pierwszym zadaniu.
+// Kazdy watek ma wlasna kolejke zadan: nowe zadanie trafia na koniec kolejki watku, ktory je tworzy, i stamtad
+// jest brane (najmlodsze najpierw), a watek bez pracy podkrada najstarsze zadanie z poczatku cudzej kolejki.
+// Watek czekajacy w join albo pmap nie spi, tylko wykonuje inne zadania, wiec zagniezdzone spawn/join nie blokuja puli.
+//
+// Wartosci sa wspoldzielone bez kopiowania. Zanim funkcja i argumenty trafia do innego watku, sa zamrazane
+// (Value::freeze, razem z domknieciami funkcji i stalymi w ich kodzie): licznik referencji staje sie atomowy,
+// a stringi, tablice i slowniki nie sa juz zmieniane w miejscu ('+', array_push, 'set' i map_put w 'def' robia kopie). Domkniecia i tak sie nie zmieniaja.
+// Kod jest wspoldzielony i tylko czytany: zadania nie podmieniaja instrukcji na wyspecjalizowane, nie uzywaja
+// JIT-a ani profilera, a glowny watek podmienia instrukcje tylko wtedy, gdy zadne zadanie nie dziala.
+// Wspolne zasoby (wyjscie, pliki, komendy) maja blokady, ale biora je dopiero, gdy program moze dzialac
+// w kilku watkach naraz: dzialaja watki robocze albo powstal kontekst z bracket.hpp.
+
+// Ile watkow (razem z glownym) ma pula. 0: tyle, ile rdzeni. Ustawiane przez --threads, przed pierwszym zadaniem.
+extern size_t thread_count;
+
+// Czy dzialaja watki robocze. Ustawiane przy starcie puli, zanim wystartuje pierwszy z nich.
+extern atomic<bool> threads_started;
+
+// Czy programy moga wykonywac tez watki spoza puli (kazdy ze swoim kontekstem z bracket.hpp). Raz ustawione zostaje.
+extern atomic<bool> host_threads;
+
+// Czy kod programu moze teraz dzialac w kilku watkach naraz
+inline bool multithreaded() {
+    return threads_started.load(memory_order_acquire) || host_threads.load(memory_order_acquire);
+}
+
+// Czy ten watek wykonuje teraz zadanie
+extern thread_local bool in_task;
+
+// Czy maszyna wirtualna moze teraz podmieniac instrukcje w kodzie (poza zadaniami i gdy zadne nie dziala).
+// Zamrozonego kodu (freeze_code) nie zmienia nigdy - moze go wlasnie wykonywac inny watek.
+bool code_writable(const Chunk& chunk);
+
+// Blokada wspolnego zasobu - w jednym watku nic nie kosztuje
+template <class M>
+unique_lock<M> lock_if_threads(M& mutex) {
+    return multithreaded() ? unique_lock<M>(mutex) : unique_lock<M>();
+}
+
+// Wywolanie funkcji z programu z wnetrza pmap i spawn. Ustawia je silnik, ktory wykonuje program.
+extern Value (*call_function)(const Value& function, const Value* args, size_t count);
+
+// Wykonuje job(0) ... job(count - 1) jako zadania na puli i wola done(i) w tym watku, po kolei, gdy zadanie i
+// sie skonczy. Zadan w kolejkach jest naraz tylko kilka na watek, wiec wyniki czekajace na done nie rosna bez konca.
+// Wyjatki z job nie sa przechwytywane - job ma je obsluzyc sam.
+void parallel_ordered(size_t count, const function<void(size_t)>& job, const function<void(size_t)>& done);
+
+// Zadania z spawn utworzone w tym watku, na ktore nikt jeszcze nie czekal. Otwiera ja kazdy, kto ustawia
+// output_capture (zadanie, skrypt z --batch, BracketContext::run), a przed jego przywroceniem finish czeka
+// na te zadania i dopisuje ich wyjscie w kolejnosci spawn. Zadanie z przechwyconym wyjsciem pisze do wlasnego
+// bufora, ktory trafia dalej dopiero przy join albo finish - dwa watki nigdy nie pisza do jednego stringa.
+class SpawnScope {
+public:
+    SpawnScope();
+    ~SpawnScope();
+    void finish();
+    void add(shared_ptr<Task> task);
+
+private:
+    vector<shared_ptr<Task>> tasks;
+    SpawnScope* outer;
+};
+
+// Zamraza stale kodu (i kodu funkcji w nim), zeby kilka watkow moglo go wykonywac naraz
+void freeze_code(const Chunk& chunk);
+
+// Czeka na wszystkie zadania (te nierozpoczete wykonuje sam) i zatrzymuje watki robocze.
+// Nastepne zadanie uruchomi pule od nowa.
+void parallel_shutdown();
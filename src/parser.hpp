@@ -1,21 +1,48 @@
-/**
- * Copyright 2025 KamilMalicki
- *
- * Licensed under the Apache License, Version 2.0 (the "License");
- * you may not use this file except in compliance with the License.
- * You may obtain a copy of the License at
- *
- * http://www.apache.org/licenses/LICENSE-2.0
- *
- * Unless required by applicable law or agreed to in writing, software
- * distributed under the License is distributed on an "AS IS" BASIS,
- * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
- * See the License for the specific language governing permissions and
- * limitations under the License.
- */
-#pragma once
-#include "types.hpp"
-
-// Deklaracja funkcji parsera.
-// Przerabia liste tokenow na liste wyrazen (drzewo AST).
-ExpressionList parse(vector<Token>& tokens);
\ No newline at end of file
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include "types.hpp"
+#include "lexer.hpp"
+
+// Parser przerabia kod na drzewo AST (jedna tablica wezlow, patrz Ast w types.hpp).
+// Bierze tokeny z lexera na biezaco (jeden token podgladu) i trzyma pozycje u siebie,
+// wiec kilka parserow moze pracowac naraz, np. w roznych watkach.
+//
+// Elementy otwartych list czekaja na stosie 'pending'. Gdy lista sie zamyka, jej elementy
+// trafiaja do drzewa jednym blokiem, a na stosie zostaje sam wezel listy.
+class Parser {
+public:
+    explicit Parser(string_view source) : lexer(source) { ast.source = source; advance(); }
+
+    // Parsujemy wyrazenia tak dlugo, az skoncza sie tokeny
+    Ast parse_program();
+
+private:
+    Lexer lexer;
+    Token current;          // nastepny token do wziecia
+    bool at_end = false;    // czy tokeny sie skonczyly
+    Ast ast;
+    decltype(Ast::nodes) pending;
+
+    void advance() { at_end = !lexer.next(current); }
+    // Jedno wyrazenie (atom albo cala lista w nawiasach) - laduje na stosie 'pending'
+    void parse_expression();
+    // Zamyka liste 'list', ktorej elementy leza na stosie od pozycji 'start'
+    void close_list(Node list, size_t start);
+};
+
+// Skrot: parsuje caly kod. Drzewo wskazuje w 'source', wiec zrodlo musi zyc dluzej niz ono.
+Ast parse(string_view source);
@@ -0,0 +1,242 @@
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "builtins.hpp"
+#include "io.hpp"
+#include "parallel.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
+// Komendy systemowe: sys czeka na wynik, sys_async uruchamia komende w tle i daje uchwyt (liczbe),
+// z ktorego await bierze standardowe wyjscie, a sys_status i sys_stderr - kod wyjscia i standardowe wyjscie bledow.
+//
+// Komenda idzie przez /bin/sh -c, uruchamiana posix_spawn (bez kopiowania pamieci interpretera jak przy fork),
+// a wyjscie czytamy z potokow blokami do 1 MB. Czekajac na jedna komende, poll oproznia potoki wszystkich
+// uruchomionych - inaczej komenda w tle zatrzymalaby sie na pelnym potoku i nikt by na nia nie czekal.
+
+static constexpr size_t PIPE_BLOCK_SIZE = 1 << 20;
+
+struct Process {
+#ifndef _WIN32
+    pid_t pid = -1;
+    int out_fd = -1;      // -1: potok juz zamkniety (komenda skonczyla pisac)
+    int err_fd = -1;
+#endif
+    string out;
+    string err;
+    int status = -1;      // kod wyjscia, -1 dopoki proces dziala
+};
+
+// Uchwyt to indeks + 1, zwolnione miejsca (po await) sa uzywane ponownie
+static vector<unique_ptr<Process>> processes;
+// Tablice i komendy z sys_async obsluguje naraz jeden watek
+static mutex processes_mutex;
+
+static string command_of(const Value& cmd_val, const char* builtin) {
+    if (cmd_val.type() != TYPE_STRING) throw runtime_error(string("Type error: The argument for '") + builtin + "' must be a string.");
+    return string(cmd_val.as_string());
+}
+
+static Process& process_of(const Value& handle, const char* builtin) {
+    if (handle.type() == TYPE_NUMBER) {
+        int_fast64_t index = handle.as_number() - 1;
+        if (index >= 0 && index < (int_fast64_t)processes.size() && processes[index]) return *processes[index];
+    }
+    throw runtime_error(string("Type error: '") + builtin + "' expects a process handle from 'sys_async'.");
+}
+
+#ifndef _WIN32
+static void make_pipe(int fds[2]) {
+#ifdef __linux__
+    if (pipe2(fds, O_CLOEXEC) != 0) throw runtime_error("Failed to execute system command.");
+#else
+    if (pipe(fds) != 0) throw runtime_error("Failed to execute system command.");
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+#endif
+#ifdef F_SETPIPE_SZ
+    // Wiekszy potok: komenda z duzym wyjsciem rzadziej czeka, az je odbierzemy (gdy system nie pozwoli - zostaje 64 KB)
+    fcntl(fds[1], F_SETPIPE_SZ, 1 << 20);
+#endif
+}
+
+// Uruchamia komende. Bez capture_err standardowe wyjscie bledow zostaje wspolne z interpreterem (tak jak w sys).
+static unique_ptr<Process> spawn(const string& command, bool capture_err) {
+    // To, co program juz wypisal, ma byc przed tym, co komenda wypisze na terminal
+    output_flush();
+    auto process = make_unique<Process>();
+    int out[2], err[2] = {-1, -1};
+    make_pipe(out);
+    if (capture_err) {
+        try {
+            make_pipe(err);
+        } catch (...) {
+            close(out[0]);
+            close(out[1]);
+            throw;
+        }
+    }
+
+    // Wszystkie konce potokow maja FD_CLOEXEC, wiec w komendzie zostaja tylko kopie zrobione przez dup2
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, out[1], STDOUT_FILENO);
+    if (capture_err) posix_spawn_file_actions_adddup2(&actions, err[1], STDERR_FILENO);
+    const char* argv[] = {"sh", "-c", command.c_str(), nullptr};
+    int failed = posix_spawn(&process->pid, "/bin/sh", &actions, nullptr, const_cast<char* const*>(argv), environ);
+    posix_spawn_file_actions_destroy(&actions);
+
+    close(out[1]);
+    if (capture_err) close(err[1]);
+    process->out_fd = out[0];
+    process->err_fd = err[0];
+    if (failed) {
+        close(out[0]);
+        if (capture_err) close(err[0]);
+        throw runtime_error("Failed to execute system command.");
+    }
+    return process;
+}
+
+// Dopisuje to, co czeka w potoku. Na koncu danych zamyka potok i ustawia fd na -1.
+static void drain(int& fd, string& into) {
+    static thread_local vector<char> block(PIPE_BLOCK_SIZE);
+    ssize_t got = read(fd, block.data(), block.size());
+    if (got < 0 && errno == EINTR) return;
+    if (got > 0) {
+        into.append(block.data(), got);
+        return;
+    }
+    close(fd);
+    fd = -1;
+}
+
+// Jeden obrot poll po potokach 'target' i (gdy others) wszystkich komend z sys_async. timeout -1: czeka, az cos przyjdzie.
+static void pump(Process* target, int timeout, bool others = true) {
+    vector<pollfd> fds;
+    vector<pair<int*, string*>> sinks;
+    auto watch = [&](Process& process) {
+        if (process.out_fd >= 0) {
+            fds.push_back({process.out_fd, POLLIN, 0});
+            sinks.push_back({&process.out_fd, &process.out});
+        }
+        if (process.err_fd >= 0) {
+            fds.push_back({process.err_fd, POLLIN, 0});
+            sinks.push_back({&process.err_fd, &process.err});
+        }
+    };
+    if (target) watch(*target);
+    for (size_t i = 0; others && i < processes.size(); ++i) {
+        if (processes[i] && processes[i].get() != target) watch(*processes[i]);
+    }
+    if (fds.empty()) return;
+    int ready = poll(fds.data(), fds.size(), timeout);
+    if (ready <= 0) return; // EINTR albo nic gotowego - wolajacy sprobuje jeszcze raz
+    for (size_t i = 0; i < fds.size(); ++i) {
+        if (fds[i].revents) drain(*sinks[i].first, *sinks[i].second);
+    }
+}
+
+// Czeka, az komenda zamknie wyjscia i sie skonczy. Kod wyjscia jak w powloce: zabita sygnalem daje 128 + numer.
+static void finish(Process& process, bool others = true) {
+    while (process.out_fd >= 0 || process.err_fd >= 0) pump(&process, -1, others);
+    if (process.status >= 0) return;
+    int status = 0;
+    while (waitpid(process.pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            process.status = 127;
+            return;
+        }
+    }
+    process.status = WIFEXITED(status) ? WEXITSTATUS(status) : WIFSIGNALED(status) ? 128 + WTERMSIG(status) : 1;
+}
+#else
+// Windows: bez posix_spawn i poll - komenda wykonuje sie od razu przez _popen, a sys_async tylko zapamietuje wynik.
+// Standardowe wyjscie bledow nie jest przechwytywane.
+static unique_ptr<Process> spawn(const string& command, bool) {
+    output_flush();
+    FILE* pipe = _popen(command.c_str(), "r");
+    if (!pipe) throw runtime_error("Failed to execute system command.");
+    auto process = make_unique<Process>();
+    // Bufor jak w drain - 1 MB na stosie to caly domyslny stos watku na Windows
+    static thread_local vector<char> block(PIPE_BLOCK_SIZE);
+    while (size_t got = fread(block.data(), 1, block.size(), pipe)) process->out.append(block.data(), got);
+    process->status = _pclose(pipe);
+    return process;
+}
+
+static void pump(Process*, int, bool = true) {}
+
+static void finish(Process&, bool = true) {}
+#endif
+
+// Wykonanie komendy systemowej
+Value builtin_sys(const Value& cmd_val) {
+    unique_ptr<Process> process = spawn(command_of(cmd_val, "sys"), false);
+    // Z watkami sys nie bierze blokady tablicy, wiec czyta tylko swoj potok (komendy z sys_async odbierze await)
+    finish(*process, !multithreaded());
+    return Value::string(std::move(process->out));
+}
+
+Value builtin_sys_async(const Value& cmd_val) {
+    unique_ptr<Process> process = spawn(command_of(cmd_val, "sys_async"), true);
+    auto guard = lock_if_threads(processes_mutex);
+    // Przy okazji odbieramy to, co juz czeka od wczesniejszych komend
+    pump(nullptr, 0);
+    for (size_t i = 0; i < processes.size(); ++i) {
+        if (!processes[i]) {
+            processes[i] = std::move(process);
+            return Value::number(i + 1);
+        }
+    }
+    processes.push_back(std::move(process));
+    return Value::number(processes.size());
+}
+
+Value builtin_await(const Value& handle) {
+    auto guard = lock_if_threads(processes_mutex);
+    Process& process = process_of(handle, "await");
+    finish(process);
+    Value out = Value::string(std::move(process.out));
+    processes[handle.as_number() - 1].reset();
+    return out;
+}
+
+Value builtin_sys_status(const Value& handle) {
+    auto guard = lock_if_threads(processes_mutex);
+    Process& process = process_of(handle, "sys_status");
+    finish(process);
+    return Value::number(process.status);
+}
+
+Value builtin_sys_stderr(const Value& handle) {
+    auto guard = lock_if_threads(processes_mutex);
+    Process& process = process_of(handle, "sys_stderr");
+    finish(process);
+    return Value::string(process.err);
+}
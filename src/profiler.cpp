@@ -0,0 +1,197 @@
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+bool profile_enabled = false;
+uint64_t profile_builtin_calls[PROFILE_BUILTIN_COUNT] = {};
+atomic<uint64_t> profile_clock{0};
+uint64_t profile_counted = 0;
+
+static const char* BUILTIN_NAMES[PROFILE_BUILTIN_COUNT] = {"print", "input", "sys", "file_read", "file_write", "file_line", "await", "pmap", "join"};
+
+static const Chunk* profiled_program = nullptr;
+static vector<uint32_t> line_starts;                     // pozycje poczatkow linii zrodla
+static unordered_map<string, uint64_t> stacks;           // "main;fib:3;loop:5" -> mikrosekundy
+static unordered_map<const void*, string> frame_names;   // nazwy ramek (Chunk albo petla z JitProfile)
+
+// Watek, ktory co jakis czas przestawia profile_clock
+static thread ticker;
+static mutex ticker_mutex;
+static condition_variable ticker_wake;
+static bool ticker_stopping = false;
+
+static uint64_t now_us() {
+    return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static string with_line(string name, uint32_t offset) {
+    if (offset == NO_SOURCE_OFFSET) return name;
+    size_t line = upper_bound(line_starts.begin(), line_starts.end(), offset) - line_starts.begin();
+    return name + ":" + to_string(line);
+}
+
+// Nazwa funkcji: z 'def' albo "fun", z numerem linii, w ktorej stoi 'fun'. Program glowny to "main".
+static const string& chunk_name(const Chunk& chunk) {
+    string& name = frame_names[&chunk];
+    if (name.empty()) {
+        if (&chunk == profiled_program) name = "main";
+        else name = with_line(chunk.name.empty() ? "fun" : chunk.name, chunk.body_profile.source_offset);
+    }
+    return name;
+}
+
+static const string& loop_name(const JitProfile& loop) {
+    string& name = frame_names[&loop];
+    if (name.empty()) name = with_line("loop", loop.source_offset);
+    return name;
+}
+
+void profile_sample(span<const ProfileFrame> frames, ProfileBuiltin builtin) {
+    uint64_t now = profile_clock.load(memory_order_relaxed);
+    uint64_t elapsed = now - profile_counted;
+    profile_counted = now;
+
+    static string path;
+    static vector<const JitProfile*> loops;
+    path.clear();
+    if (frames.empty() || frames[0].chunk != profiled_program) path = "...";
+    for (const ProfileFrame& frame : frames) {
+        if (!path.empty()) path += ';';
+        path += chunk_name(*frame.chunk);
+        // Petle, w ktorych lezy ip - zewnetrzna zaczyna sie wczesniej niz petle w jej srodku
+        loops.clear();
+        for (const JitProfile& loop : frame.chunk->loops) {
+            if (frame.ip >= loop.start && frame.ip < loop.end) loops.push_back(&loop);
+        }
+        sort(loops.begin(), loops.end(), [](const JitProfile* a, const JitProfile* b) { return a->start < b->start; });
+        for (const JitProfile* loop : loops) {
+            path += ';';
+            path += loop_name(*loop);
+        }
+    }
+    if (builtin != PROFILE_NO_BUILTIN) {
+        path += ';';
+        path += BUILTIN_NAMES[builtin];
+    }
+    stacks[path] += elapsed;
+}
+
+void profile_start(const Chunk& program, string_view source) {
+    profiled_program = &program;
+    line_starts.assign(1, 0);
+    for (size_t i = 0; i < source.size(); ++i) {
+        if (source[i] == '\n') line_starts.push_back(i + 1);
+    }
+    profile_counted = now_us();
+    profile_clock.store(profile_counted);
+    ticker_stopping = false;
+    ticker = thread([] {
+        unique_lock<mutex> guard(ticker_mutex);
+        while (!ticker_wake.wait_for(guard, chrono::microseconds(BRACKET_PROFILE_INTERVAL_US), [] { return ticker_stopping; })) {
+            profile_clock.store(now_us(), memory_order_relaxed);
+        }
+    });
+    profile_enabled = true;
+}
+
+// Wiersz tabelki: czas wlasny (na szczycie stosu), calkowity (gdziekolwiek na stosie) i liczba wykonan
+struct ProfileRow {
+    string name;
+    uint64_t self = 0;
+    uint64_t total = 0;
+    uint64_t count = 0;
+};
+
+// Wywolania funkcji i obroty petli ze wszystkich kawalkow programu
+static void collect_counts(const Chunk& chunk, unordered_map<string, ProfileRow>& rows) {
+    rows[chunk_name(chunk)].count += &chunk == profiled_program ? 1 : chunk.body_profile.profile_count;
+    for (const JitProfile& loop : chunk.loops) rows[loop_name(loop)].count += loop.profile_count;
+    for (const auto& function : chunk.functions) collect_counts(*function, rows);
+}
+
+void profile_finish(ostream& folded, ostream& summary, size_t top) {
+    {
+        lock_guard<mutex> guard(ticker_mutex);
+        ticker_stopping = true;
+    }
+    ticker_wake.notify_all();
+    ticker.join();
+    profile_enabled = false;
+
+    // Stosy posortowane, zeby wynik dalo sie porownywac miedzy uruchomieniami
+    vector<pair<string, uint64_t>> sorted(stacks.begin(), stacks.end());
+    sort(sorted.begin(), sorted.end());
+    for (const auto& [path, time] : sorted) {
+        if (time > 0) folded << path << ' ' << time << '\n';
+    }
+
+    unordered_map<string, ProfileRow> rows;
+    collect_counts(*profiled_program, rows);
+    for (int i = 0; i < PROFILE_BUILTIN_COUNT; ++i) {
+        if (profile_builtin_calls[i] > 0) rows[BUILTIN_NAMES[i]].count += profile_builtin_calls[i];
+    }
+    uint64_t all = 0;
+    vector<string_view> seen;
+    for (const auto& [path, time] : sorted) {
+        all += time;
+        // Rekurencja powtarza ramki na stosie - do czasu calkowitego liczymy kazda tylko raz
+        seen.clear();
+        size_t begin = 0;
+        for (;;) {
+            size_t end = path.find(';', begin);
+            string_view frame = string_view(path).substr(begin, end == string::npos ? string::npos : end - begin);
+            if (find(seen.begin(), seen.end(), frame) == seen.end()) {
+                seen.push_back(frame);
+                rows[string(frame)].total += time;
+            }
+            if (end == string::npos) {
+                rows[string(frame)].self += time;
+                break;
+            }
+            begin = end + 1;
+        }
+    }
+
+    vector<ProfileRow> table;
+    for (auto& [name, row] : rows) {
+        row.name = name;
+        table.push_back(std::move(row));
+    }
+    sort(table.begin(), table.end(), [](const ProfileRow& a, const ProfileRow& b) {
+        if (a.self != b.self) return a.self > b.self;
+        if (a.total != b.total) return a.total > b.total;
+        if (a.count != b.count) return a.count > b.count;
+        return a.name < b.name;
+    });
+    if (table.size() > top) table.resize(top);
+
+    char line[160];
+    snprintf(line, sizeof(line), "Profile: %.1f ms measured (every %d us)\n", all / 1000.0, BRACKET_PROFILE_INTERVAL_US);
+    summary << line;
+    summary << "   self ms   self %   total ms        count  frame\n";
+    for (const ProfileRow& row : table) {
+        snprintf(line, sizeof(line), "%10.1f %7.1f%% %10.1f %12llu  ", row.self / 1000.0,
+                 all > 0 ? 100.0 * row.self / all : 0.0, row.total / 1000.0, (unsigned long long)row.count);
+        summary << line << row.name << '\n';
+    }
+}
@@ -0,0 +1,72 @@
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include "types.hpp"
+#include "compiler.hpp"
+
+#include <atomic>
+#include <ostream>
+
+// Profiler (opcja --profile).
+//
+// Osobny watek co BRACKET_PROFILE_INTERVAL_US mikrosekund zapisuje aktualny czas. Maszyna wirtualna zaglada
+// do niego tylko w kilku miejscach: przy wywolaniu i powrocie z funkcji, na koncu obrotu petli i wokol
+// print/input/sys. Gdy czas sie zmienil, wszystko od poprzedniej zmiany trafia na konto aktualnego stosu:
+// funkcji (po nazwach z 'def'), petli, w ktorych stoimy, i funkcji wbudowanej, jesli to ona trwala.
+// Wywolania funkcji i obroty petli licza sie w JitProfile::profile_count.
+// Bez --profile kazde takie miejsce kosztuje jedno sprawdzenie flagi, z --profile - odczyt jednej liczby.
+//
+// Na koniec wypisuje stosy w formacie "folded" (jedna linia na stos: "main;fib:3;fib:3 1234",
+// czas w mikrosekundach), ktory rozumieja narzedzia do flamegraphow, i tabelke najdrozszych miejsc.
+// Kod skompilowany przez --jit nie ma takich miejsc, wiec jego czas trafia tam, gdzie z niego wyjdziemy.
+
+#ifndef BRACKET_PROFILE_INTERVAL_US
+#define BRACKET_PROFILE_INTERVAL_US 1000
+#endif
+
+// Glebiej niz tyle ramek stos jest ucinany od strony programu glownego (i zaczyna sie od "...")
+#ifndef BRACKET_PROFILE_MAX_FRAMES
+#define BRACKET_PROFILE_MAX_FRAMES 256
+#endif
+
+// Wlaczone od profile_start do profile_finish
+extern bool profile_enabled;
+
+// Funkcje wbudowane z wlasnym miejscem na stosie - te, ktore moga dlugo czekac na wejscie/wyjscie
+enum ProfileBuiltin { PROFILE_PRINT, PROFILE_INPUT, PROFILE_SYS, PROFILE_FILE_READ, PROFILE_FILE_WRITE, PROFILE_FILE_LINE, PROFILE_AWAIT, PROFILE_PMAP, PROFILE_JOIN, PROFILE_BUILTIN_COUNT, PROFILE_NO_BUILTIN = PROFILE_BUILTIN_COUNT };
+extern uint64_t profile_builtin_calls[PROFILE_BUILTIN_COUNT];
+
+// Czas zapisany przez watek profilera i czas, do ktorego wszystko jest juz policzone
+extern atomic<uint64_t> profile_clock;
+extern uint64_t profile_counted;
+
+// Czy od ostatniego razu uplynal czas do rozliczenia
+inline bool profile_due() { return profile_clock.load(memory_order_relaxed) != profile_counted; }
+
+// Ramka stosu: kawalek kodu i miejsce w nim (w ramkach wolajacych to adres powrotu)
+struct ProfileFrame {
+    const Chunk* chunk;
+    uint32_t ip;
+};
+
+// Dopisuje czas od ostatniego razu do stosu 'frames' (od najstarszej ramki do aktualnej funkcji)
+void profile_sample(span<const ProfileFrame> frames, ProfileBuiltin builtin);
+
+// Wlacza profiler dla programu 'program'. 'source' sluzy tylko do zamiany pozycji w zrodle na numery linii.
+void profile_start(const Chunk& program, string_view source);
+
+// Zatrzymuje profiler, zapisuje stosy do 'folded', a 'top' najdrozszych miejsc jako tabelke do 'summary'
+void profile_finish(ostream& folded, ostream& summary, size_t top);
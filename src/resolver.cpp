@@ -0,0 +1,98 @@
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "resolver.hpp"
+
+#include <algorithm>
+
+// Czy lista to wywolanie slowa kluczowego o danej nazwie
+static bool is_form(span<const Node> list, Symbol keyword) {
+    return !list.empty() && list[0].token.type == TOKEN_IDENTIFIER && list[0].token.symbol == keyword;
+}
+
+static void add_unique(vector<Symbol>& names, Symbol name) {
+    if (find(names.begin(), names.end(), name) == names.end()) names.push_back(name);
+}
+
+// Musi rozpoznawac 'def', 'set' i 'fun' dokladnie tak samo jak kompilator,
+// inaczej kompilator szukalby slotu, ktorego nie ma.
+void collect_locals(const Ast& ast, const Node& node, vector<Symbol>& names) {
+    if (!node.is_list()) return;
+    span<const Node> list = ast.list(node);
+
+    if (is_form(list, KW_DEF) && list.size() == 3 && !list[1].is_list()) {
+        add_unique(names, name_symbol(list[1].token));
+    }
+    if (is_form(list, KW_SET) && list.size() == 4 && list[1].token.type == TOKEN_IDENTIFIER) {
+        add_unique(names, list[1].token.symbol);
+    }
+    // Cialo zagniezdzonej funkcji ma wlasna ramke
+    if (is_form(list, KW_FUN)) return;
+
+    for (const Node& item : list) collect_locals(ast, item, names);
+}
+
+static uint32_t add_local(Scope& scope, Symbol name) {
+    Chunk& chunk = *scope.chunk;
+    uint32_t slot = chunk.locals.size();
+    chunk.locals.push_back(name);
+    if (slot >= chunk.parameter_count) chunk.local_init.push_back(-1);
+    scope.local_slots[name] = slot;
+    return slot;
+}
+
+void declare_locals(Scope& scope, const vector<Symbol>& parameters, const vector<Symbol>& locals) {
+    scope.chunk->parameter_count = parameters.size();
+    // Powtorzona nazwa parametru - wygrywa ostatni, tak jak przy wpisywaniu do mapy
+    for (Symbol name : parameters) {
+        scope.chunk->locals.push_back(name);
+        scope.local_slots[name] = scope.chunk->locals.size() - 1;
+    }
+    for (Symbol name : locals) {
+        if (!scope.local_slots.count(name)) add_local(scope, name);
+    }
+}
+
+// Dodaje nazwe do domkniecia funkcji i ustala skad ja skopiowac przy jej tworzeniu
+static uint32_t add_capture(Scope& scope, Symbol name) {
+    Chunk& chunk = *scope.chunk;
+    VarRef source = resolve(*scope.parent, name);
+    chunk.captures.push_back(name);
+    chunk.capture_from.push_back(CaptureSource{source.kind == VarRef::LOCAL, source.index});
+    return chunk.captures.size() - 1;
+}
+
+VarRef resolve(Scope& scope, Symbol name) {
+    auto local = scope.local_slots.find(name);
+    if (local != scope.local_slots.end()) return VarRef{VarRef::LOCAL, local->second};
+
+    // Program glowny: kazda nowa nazwa to kolejna zmienna globalna (na razie pusta)
+    if (!scope.parent) return VarRef{VarRef::LOCAL, add_local(scope, name)};
+
+    auto capture = scope.capture_slots.find(name);
+    if (capture != scope.capture_slots.end()) return VarRef{VarRef::CAPTURE, capture->second};
+
+    uint32_t index = add_capture(scope, name);
+    scope.capture_slots[name] = index;
+    return VarRef{VarRef::CAPTURE, index};
+}
+
+void finish_scope(Scope& scope) {
+    if (!scope.parent) return;
+    Chunk& chunk = *scope.chunk;
+    for (uint32_t slot = chunk.parameter_count; slot < chunk.locals.size(); ++slot) {
+        chunk.local_init[slot - chunk.parameter_count] = add_capture(scope, chunk.locals[slot]);
+    }
+}
@@ -0,0 +1,54 @@
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include "types.hpp"
+#include "compiler.hpp"
+
+// Resolver zamienia nazwy zmiennych na numery slotow juz przy kompilacji.
+//
+// Kazda funkcja (i program glowny) ma swoja ramke - tablice slotow: najpierw parametry,
+// potem zmienne tworzone w jej ciele przez 'def' albo zmieniane przez 'set'.
+// Funkcja widzi srodowisko z chwili, w ktorej powstala (tak jak kopia srodowiska w evaluatorze),
+// wiec wszystkie inne nazwy sa kopiowane do domkniecia przy tworzeniu funkcji ("captures").
+// W programie glownym kazda nazwa jest zmienna globalna, czyli slotem ramki glownej.
+
+// Zakres jednej funkcji w trakcie kompilacji
+struct Scope {
+    Scope* parent = nullptr;       // zakres w ktorym funkcja jest tworzona (nullptr dla programu glownego)
+    Chunk* chunk = nullptr;        // kod do ktorego kompilujemy
+    unordered_map<Symbol, uint32_t> local_slots;
+    unordered_map<Symbol, uint32_t> capture_slots;
+};
+
+// Adres zmiennej - albo slot ramki, albo pozycja w domknieciu
+struct VarRef {
+    enum Kind { LOCAL, CAPTURE } kind;
+    uint32_t index;
+};
+
+// Zbiera nazwy zmiennych tworzonych w ciele funkcji ('def' i 'set'), bez wchodzenia w zagniezdzone 'fun'
+void collect_locals(const Ast& ast, const Node& node, vector<Symbol>& names);
+
+// Przygotowuje sloty zakresu: parametry, potem zmienne z 'def'/'set' w ciele.
+void declare_locals(Scope& scope, const vector<Symbol>& parameters, const vector<Symbol>& locals);
+
+// Znajduje adres nazwy w zakresie. Nieznane nazwy w programie glownym dostaja nowy slot globalny,
+// a w funkcji trafiaja do domkniecia (a ich zrodlo jest szukane w zakresie wyzej).
+VarRef resolve(Scope& scope, Symbol name);
+
+// Wywolywane po skompilowaniu ciala funkcji - zmienne lokalne, ktore istnialy juz
+// w srodowisku tworzenia funkcji, startuja z wartoscia skopiowana z domkniecia.
+void finish_scope(Scope& scope);
@@ -0,0 +1,64 @@
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "runtime.hpp"
+#include "io.hpp"
+#include "parallel.hpp"
+
+#include <iostream>
+
+shared_ptr<Chunk> native_chunk(uint32_t entry, uint32_t parameter_count, vector<int32_t> local_init, vector<CaptureSource> capture_from) {
+    auto chunk = make_shared<Chunk>();
+    chunk->entry = entry;
+    chunk->parameter_count = parameter_count;
+    chunk->local_init = std::move(local_init);
+    chunk->capture_from = std::move(capture_from);
+    return chunk;
+}
+
+void Machine::check_arguments(const Value& head, uint32_t arg_count) {
+    uint32_t expected = head.as_function().code->parameter_count;
+    if (expected != arg_count) throw runtime_error("Incorrect number of arguments for function call. Expected " + to_string(expected) + ", but got " + to_string(arg_count) + ".");
+}
+
+// Program, ktory wykonuje run_native - dla wywolan z pmap i spawn
+static void (*native_program)(Machine&) = nullptr;
+
+static Value native_call(const Value& function, const Value* args, size_t count) {
+    Machine machine(0);
+    machine.start = machine.begin_call(function, args, count);
+    native_program(machine);
+    return std::move(machine.result);
+}
+
+int run_native(void (*program)(Machine&), size_t global_count) {
+    ios::sync_with_stdio(false);
+    cin.tie(nullptr);
+    native_program = program;
+    call_function = native_call;
+    try {
+        Machine machine(global_count);
+        program(machine);
+        parallel_shutdown();
+    }
+    catch (const exception& e) {
+        parallel_shutdown();
+        output_flush();
+        cerr << "Execution error: " << e.what() << endl;
+        return 1;
+    }
+    output_flush();
+    return 0;
+}
@@ -0,0 +1,248 @@
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include "types.hpp"
+#include "compiler.hpp"
+#include "builtins.hpp"
+
+#include <stdexcept>
+
+// Biblioteka uruchomieniowa dla programow z --emit-cpp (libbracket_runtime).
+//
+// Wygenerowany kod to jedna funkcja C++, w ktorej kazda instrukcja bajtkodu jest wywolaniem
+// jednej z metod Machine ponizej, a skoki to goto. Stan jest ten sam co w maszynie wirtualnej
+// (stos wartosci ze slotami ramek i stos wywolan na stercie), dlatego zachowanie, bledy i limit
+// --max-depth sa identyczne, tylko bez petli interpretera i dekodowania instrukcji.
+//
+// Glebokosc stosu w kazdym miejscu kodu jest znana juz przy generowaniu, wiec metody dostaja ja
+// jako stala 'd' (liczba wartosci w ramce przed instrukcja) i pisza prosto do frame[d] - bez push_back.
+// Ramka ma od wejscia do funkcji miejsce na najwieksza glebokosc (frame_size).
+
+// Zapisany stan funkcji, ktora wywolala inna funkcje: miejsce powrotu w wygenerowanym kodzie i jej ramka
+struct NativeFrame {
+    uint32_t resume;
+    size_t slots;
+};
+
+// Numer powrotu oznaczajacy koniec programu
+constexpr uint32_t NATIVE_EXIT = UINT32_MAX;
+
+struct Machine {
+    vector<Value> stack;
+    vector<NativeFrame> frames;
+    size_t slots = 0;
+    Value* frame = nullptr;     // stack.data() + slots, poprawiane po kazdej zmianie rozmiaru stosu
+    uint32_t start = 0;         // cialo funkcji, od ktorego zaczyna program (0: program glowny, inaczej begin_call)
+    Value result;               // wynik funkcji wywolanej przez begin_call
+
+    explicit Machine(size_t global_count) { stack.resize(global_count, Value::undefined()); }
+
+    const BraceFunction& closure() const { return stack[slots - 1].as_function(); }
+
+    [[noreturn]] static void fail(const char* message) { throw runtime_error(message); }
+    [[noreturn]] static void undefined(const char* name) { throw runtime_error(string("Undefined variable: '") + name + "'."); }
+
+    // Miejsce na 'size' wartosci w ramce - na poczatku ciala funkcji i po powrocie z wywolania
+    void frame_size(uint32_t size) {
+        stack.resize(slots + size);
+        frame = stack.data() + slots;
+    }
+
+    void push(uint32_t d, const Value& val) { frame[d] = val; }
+    void nil(uint32_t) {}  // wolne miejsce na stosie zawsze trzyma nil
+    // Zdejmowanie od razu zwalnia wartosc, zeby liczniki referencji byly takie jak w interpreterze
+    void pop(uint32_t d) { frame[d - 1].set_nil(); }
+
+    void load_local(uint32_t d, uint32_t slot, const char* name) {
+        if (frame[slot].type() == TYPE_UNDEFINED) undefined(name);
+        frame[d] = frame[slot];
+    }
+    void load_capture(uint32_t d, uint32_t index, const char* name) {
+        const Value& val = closure().captures[index];
+        if (val.type() == TYPE_UNDEFINED) undefined(name);
+        frame[d] = val;
+    }
+    void def_local(uint32_t d, uint32_t slot) { frame[slot] = frame[d - 1]; }
+    void set_local(uint32_t d, uint32_t slot) {
+        Value& target = frame[slot];
+        if (target.type() != TYPE_STRING && target.type() != TYPE_ARRAY) fail("Type error: Variable for 'set' must exist and be a string or array.");
+        builtin_set(target, frame[d - 2], frame[d - 1]);
+        frame[d - 1].set_nil();
+        frame[d - 2] = target;
+    }
+    void map_put_local(uint32_t d, uint32_t slot) {
+        builtin_map_put_into(frame[slot], move(frame[d - 3]), frame[d - 2], frame[d - 1]);
+        frame[d - 1].set_nil();
+        frame[d - 2].set_nil();
+        frame[d - 3] = frame[slot];
+    }
+    void map_delete_local(uint32_t d, uint32_t slot) {
+        builtin_map_delete_into(frame[slot], move(frame[d - 2]), frame[d - 1]);
+        frame[d - 1].set_nil();
+        frame[d - 2] = frame[slot];
+    }
+
+    // Zdejmuje warunek i mowi, czy byl falszywy
+    bool is_false(uint32_t d) {
+        bool result = !is_truthy(frame[d - 1]);
+        frame[d - 1].set_nil();
+        return result;
+    }
+
+    void make_fun(uint32_t d, const shared_ptr<Chunk>& body) {
+        BraceFunction* func = new BraceFunction();
+        func->code = body;
+        func->captures.reserve(body->capture_from.size());
+        for (const CaptureSource& source : body->capture_from) {
+            func->captures.push_back(source.from_local ? frame[source.index] : closure().captures[source.index]);
+        }
+        frame[d] = Value::function(func);
+    }
+
+    // Czy na stosie lezy funkcja (z dobra liczba argumentow)? Jesli nie - to lancuch infiksowy.
+    bool is_call(uint32_t d, uint32_t arg_count) const {
+        const Value& head = frame[d - 1];
+        if (head.type() != TYPE_FUNCTION) return false;
+        check_arguments(head, arg_count);
+        return true;
+    }
+
+    // Wywolania zwracaja numer ciala funkcji, do ktorego wygenerowany kod ma skoczyc.
+    // Funkcja i argumenty to ostatnie wartosci w ramce, wiec przycinamy stos do glebokosci 'd'.
+    uint32_t call(uint32_t d, uint32_t arg_count, uint32_t resume) {
+        if (frames.size() >= max_call_depth) throw_stack_overflow();
+        stack.resize(slots + d);
+        frames.push_back(NativeFrame{resume, slots});
+        slots = stack.size() - arg_count;
+        return enter();
+    }
+    uint32_t tail_call(uint32_t d, uint32_t arg_count) {
+        size_t base = slots + d - arg_count - 1;
+        for (size_t i = 0; i <= arg_count; ++i) stack[slots - 1 + i] = std::move(stack[base + i]);
+        stack.resize(slots + arg_count);
+        return enter();
+    }
+    // Wywolanie funkcji z zewnatrz (pmap, spawn) na pustej maszynie: po begin_call program startuje od jej ciala
+    // i konczy sie razem z nia, a wynik zostaje w result
+    uint32_t begin_call(const Value& function, const Value* args, uint32_t arg_count) {
+        check_arguments(function, arg_count);
+        stack.push_back(function);
+        stack.insert(stack.end(), args, args + arg_count);
+        slots = 1;
+        return enter();
+    }
+    // Konczy funkcje (wynik w frame[d - 1]) i zwraca miejsce powrotu (NATIVE_EXIT na koncu programu).
+    // Po powrocie wywolujacy sam przywraca rozmiar swojej ramki przez frame_size.
+    uint32_t ret(uint32_t d) {
+        if (frames.empty()) {
+            result = std::move(frame[d - 1]);
+            return NATIVE_EXIT;
+        }
+        stack[slots - 1] = std::move(frame[d - 1]);
+        stack.resize(slots);
+        uint32_t resume = frames.back().resume;
+        slots = frames.back().slots;
+        frames.pop_back();
+        return resume;
+    }
+
+    // Operatory - liczby liczymy od razu, reszta (i bledy) idzie przez apply_infix jak w interpreterze.
+    // Operator jest parametrem szablonu, wiec dla liczb zostaje jedna instrukcja procesora.
+    template <InfixOp op>
+    void infix(uint32_t d, const char* text) {
+        Value& left = frame[d - 2];
+        Value& right = frame[d - 1];
+        if (left.type() == TYPE_NUMBER && right.type() == TYPE_NUMBER && number_infix(op, left, right.as_number())) {
+            right.set_nil();
+            return;
+        }
+        apply_infix(op, text, left, right);
+        right.set_nil();
+    }
+
+    void print(uint32_t d, uint32_t count) {
+        builtin_print(frame + d - count, count);
+        for (uint32_t i = d - count; i < d; ++i) frame[i].set_nil();
+    }
+    void input(uint32_t d, uint32_t count) {
+        if (count == 1) frame[d - 1] = builtin_input(&frame[d - 1]);
+        else frame[d] = builtin_input(nullptr);
+    }
+    void spawn(uint32_t d, uint32_t count) {
+        frame[d - count] = builtin_spawn(frame + d - count, count);
+        for (uint32_t i = d - count + 1; i < d; ++i) frame[i].set_nil();
+    }
+    void array(uint32_t d, uint32_t count) {
+        frame[d - count] = builtin_array(frame + d - count, count);
+        for (uint32_t i = d - count + 1; i < d; ++i) frame[i].set_nil();
+    }
+    void map(uint32_t d, uint32_t count) {
+        frame[d - count] = builtin_map(frame + d - count, count);
+        for (uint32_t i = d - count + 1; i < d; ++i) frame[i].set_nil();
+    }
+    void unary(uint32_t d, Value (*builtin)(const Value&)) { frame[d - 1] = builtin(frame[d - 1]); }
+    void binary(uint32_t d, Value (*builtin)(const Value&, const Value&)) {
+        frame[d - 2] = builtin(frame[d - 2], frame[d - 1]);
+        frame[d - 1].set_nil();
+    }
+    void ternary(uint32_t d, Value (*builtin)(const Value&, const Value&, const Value&)) {
+        frame[d - 3] = builtin(frame[d - 3], frame[d - 2], frame[d - 1]);
+        frame[d - 2].set_nil();
+        frame[d - 1].set_nil();
+    }
+
+private:
+    static void check_arguments(const Value& head, uint32_t arg_count);
+    uint32_t enter() {
+        const Chunk& body = *closure().code;
+        for (int32_t init : body.local_init) {
+            if (init < 0) stack.push_back(Value::undefined());
+            else stack.push_back(closure().captures[init]);
+        }
+        return body.entry;
+    }
+
+    // Dzialanie na dwoch liczbach w miejscu. false gdy trzeba isc przez apply_infix (np. dzielenie przez zero).
+    static bool number_infix(InfixOp op, Value& left, int_fast64_t b) {
+        int_fast64_t a = left.as_number();
+        switch (op) {
+            case INFIX_ADD: left.set_number(a + b); return true;
+            case INFIX_SUB: left.set_number(a - b); return true;
+            case INFIX_MUL: left.set_number(a * b); return true;
+            case INFIX_DIV: if (b == 0) return false; left.set_number(a / b); return true;
+            case INFIX_MOD: if (b == 0) return false; left.set_number(a % b); return true;
+            case INFIX_EQ: left.set_number(a == b); return true;
+            case INFIX_NE: left.set_number(a != b); return true;
+            case INFIX_GT: left.set_number(a > b); return true;
+            case INFIX_LT: left.set_number(a < b); return true;
+            case INFIX_GE: left.set_number(a >= b); return true;
+            case INFIX_LE: left.set_number(a <= b); return true;
+            default: return false;
+        }
+    }
+};
+
+// Stala napisowa wygenerowanego programu. Zamrozona od poczatku, bo moga jej naraz uzywac zadania z roznych watkow.
+inline Value shared_constant(Value val) {
+    val.freeze();
+    return val;
+}
+
+// Metadane ciala funkcji dla wygenerowanego programu (sam kod jest w C++)
+shared_ptr<Chunk> native_chunk(uint32_t entry, uint32_t parameter_count, vector<int32_t> local_init, vector<CaptureSource> capture_from);
+
+// main wygenerowanego programu: uruchamia go i wypisuje bledy tak samo jak interpreter
+int run_native(void (*program)(Machine&), size_t global_count);
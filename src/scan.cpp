@@ -0,0 +1,151 @@
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "scan.hpp"
+
+#if !defined(BRACKET_NO_SIMD) && (defined(__x86_64__) || defined(_M_X64))
+#define BRACKET_SCAN_SSE2 1
+#include <emmintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define BRACKET_SCAN_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
+// Zwykle petle - wzor dla wersji SIMD i koncowki krotsze niz jeden blok
+static inline bool is_blank(unsigned char c) { return c == ' ' || (unsigned char)(c - '\t') <= '\r' - '\t'; }
+static inline bool is_digit(unsigned char c) { return (unsigned char)(c - '0') <= 9; }
+static inline bool is_word(unsigned char c) { return is_digit(c) || (unsigned char)((c | 0x20) - 'a') <= 'z' - 'a' || c == '_'; }
+static inline bool is_plain(unsigned char c) { return c != '"' && c != '\\'; }
+
+template <bool (*match)(unsigned char)>
+static size_t scan_scalar(const char* text, size_t pos, size_t size) {
+    while (pos < size && match(text[pos])) pos++;
+    return pos;
+}
+
+static const ScanKernels scalar_kernels = {
+    "scalar", scan_scalar<is_blank>, scan_scalar<is_word>, scan_scalar<is_digit>, scan_scalar<is_plain>,
+};
+
+#ifdef BRACKET_SCAN_SSE2
+// Kazda klasa znakow to przedzialy [low, low + width] - bajt jest w przedziale, gdy (c - low) bez znaku <= width.
+// Porownania bez znaku nie ma w SSE2, wiec sprawdzamy min(x, width) == x.
+static inline __m128i in_range(__m128i c, char low, char width) {
+    __m128i x = _mm_sub_epi8(c, _mm_set1_epi8(low));
+    return _mm_cmpeq_epi8(_mm_min_epu8(x, _mm_set1_epi8(width)), x);
+}
+
+static inline __m128i blank_mask(__m128i c) { return _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8(' ')), in_range(c, '\t', '\r' - '\t')); }
+static inline __m128i digit_mask(__m128i c) { return in_range(c, '0', 9); }
+static inline __m128i word_mask(__m128i c) {
+    __m128i letter = in_range(_mm_or_si128(c, _mm_set1_epi8(0x20)), 'a', 'z' - 'a');
+    return _mm_or_si128(_mm_or_si128(letter, digit_mask(c)), _mm_cmpeq_epi8(c, _mm_set1_epi8('_')));
+}
+static inline __m128i plain_mask(__m128i c) {
+    return _mm_xor_si128(_mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('"')), _mm_cmpeq_epi8(c, _mm_set1_epi8('\\'))), _mm_set1_epi8(-1));
+}
+
+// Po 16 bajtow: pierwszy niepasujacy bajt to najnizszy zerowy bit maski
+template <__m128i (*mask)(__m128i), bool (*match)(unsigned char)>
+static size_t scan_sse2(const char* text, size_t pos, size_t size) {
+    // Wiekszosc tokenow jest krotka - pierwszy znak sprawdzamy bez ladowania bloku
+    if (pos >= size || !match(text[pos])) return pos;
+    while (pos + 16 <= size) {
+        unsigned bits = _mm_movemask_epi8(mask(_mm_loadu_si128(reinterpret_cast<const __m128i*>(text + pos))));
+        if (bits != 0xFFFF) return pos + __builtin_ctz(~bits);
+        pos += 16;
+    }
+    return scan_scalar<match>(text, pos, size);
+}
+
+static const ScanKernels sse2_kernels = {
+    "sse2",
+    scan_sse2<blank_mask, is_blank>,
+    scan_sse2<word_mask, is_word>,
+    scan_sse2<digit_mask, is_digit>,
+    scan_sse2<plain_mask, is_plain>,
+};
+#endif
+
+#ifdef BRACKET_SCAN_AVX2
+// To samo po 32 bajty. Funkcje maja target("avx2"), wiec reszta programu nadal dziala na starszych procesorach.
+#define BRACKET_AVX2 __attribute__((target("avx2")))
+
+BRACKET_AVX2 static inline __m256i in_range_avx2(__m256i c, char low, char width) {
+    __m256i x = _mm256_sub_epi8(c, _mm256_set1_epi8(low));
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(x, _mm256_set1_epi8(width)), x);
+}
+
+BRACKET_AVX2 static inline __m256i blank_mask_avx2(__m256i c) {
+    return _mm256_or_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8(' ')), in_range_avx2(c, '\t', '\r' - '\t'));
+}
+BRACKET_AVX2 static inline __m256i digit_mask_avx2(__m256i c) { return in_range_avx2(c, '0', 9); }
+BRACKET_AVX2 static inline __m256i word_mask_avx2(__m256i c) {
+    __m256i letter = in_range_avx2(_mm256_or_si256(c, _mm256_set1_epi8(0x20)), 'a', 'z' - 'a');
+    return _mm256_or_si256(_mm256_or_si256(letter, digit_mask_avx2(c)), _mm256_cmpeq_epi8(c, _mm256_set1_epi8('_')));
+}
+BRACKET_AVX2 static inline __m256i plain_mask_avx2(__m256i c) {
+    __m256i special = _mm256_or_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8('"')), _mm256_cmpeq_epi8(c, _mm256_set1_epi8('\\')));
+    return _mm256_xor_si256(special, _mm256_set1_epi8(-1));
+}
+
+template <__m256i (*mask)(__m256i), bool (*match)(unsigned char)>
+BRACKET_AVX2 static size_t scan_avx2(const char* text, size_t pos, size_t size) {
+    if (pos >= size || !match(text[pos])) return pos;
+    while (pos + 32 <= size) {
+        unsigned bits = _mm256_movemask_epi8(mask(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + pos))));
+        if (bits != 0xFFFFFFFFu) return pos + __builtin_ctz(~bits);
+        pos += 32;
+    }
+    return scan_scalar<match>(text, pos, size);
+}
+
+static const ScanKernels avx2_kernels = {
+    "avx2",
+    scan_avx2<blank_mask_avx2, is_blank>,
+    scan_avx2<word_mask_avx2, is_word>,
+    scan_avx2<digit_mask_avx2, is_digit>,
+    scan_avx2<plain_mask_avx2, is_plain>,
+};
+#endif
+
+// Lista wersji od najszybszej, budowana raz przy pierwszym uzyciu
+struct ScanKernelList {
+    const ScanKernels* kernels[3];
+    size_t count = 0;
+
+    ScanKernelList() {
+#ifdef BRACKET_SCAN_AVX2
+        if (__builtin_cpu_supports("avx2")) kernels[count++] = &avx2_kernels;
+#endif
+#ifdef BRACKET_SCAN_SSE2
+        kernels[count++] = &sse2_kernels;
+#endif
+        kernels[count++] = &scalar_kernels;
+    }
+};
+
+static const ScanKernelList& kernel_list() {
+    static const ScanKernelList list;
+    return list;
+}
+
+const ScanKernels& scan_kernels() { return *kernel_list().kernels[0]; }
+
+const ScanKernels* const* available_scan_kernels(size_t& count) {
+    count = kernel_list().count;
+    return kernel_list().kernels;
+}
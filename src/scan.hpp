@@ -0,0 +1,42 @@
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include <cstddef>
+
+// Szybkie przeszukiwanie kodu dla lexera.
+//
+// Kazda funkcja dostaje kod (text, size) i pozycje startowa, a zwraca pozycje pierwszego znaku,
+// ktory juz nie pasuje (albo size). Na x86-64 sprawdzamy 16 (SSE2) albo 32 (AVX2) znaki naraz;
+// wersja jest wybierana raz, wedlug tego co umie procesor. Wszystkie wersje musza dawac dokladnie
+// to samo co zwykla petla z isspace/isalnum/isdigit (w locale "C").
+// -DBRACKET_NO_SIMD zostawia tylko zwykle petle.
+struct ScanKernels {
+    const char* name;
+    // Biale znaki (spacja, \t, \n, \v, \f, \r)
+    size_t (*whitespace)(const char* text, size_t pos, size_t size);
+    // Litery, cyfry i '_' (reszta identyfikatora)
+    size_t (*identifier)(const char* text, size_t pos, size_t size);
+    // Cyfry
+    size_t (*digits)(const char* text, size_t pos, size_t size);
+    // Wszystko poza '"' i '\\' (srodek stringa)
+    size_t (*string_body)(const char* text, size_t pos, size_t size);
+};
+
+// Najszybsza wersja dostepna na tym procesorze
+const ScanKernels& scan_kernels();
+
+// Wszystkie wersje, ktore ten procesor umie wykonac (ostatnia to zwykle petle) - do porownywania wynikow
+const ScanKernels* const* available_scan_kernels(size_t& count);
@@ -0,0 +1,83 @@
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "symbols.hpp"
+
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+// Hash, ktory przyjmuje tez string_view - szukanie nazwy z lexera nie tworzy tymczasowego stringa
+struct NameHash {
+    using is_transparent = void;
+    size_t operator()(string_view text) const { return hash<string_view>{}(text); }
+};
+
+// Tablica jest wspolna dla calego procesu (takze dla watkow programu osadzajacego libbracket).
+// Odczyty ida naraz pod wspolna blokada, na wylacznosc blokujemy tylko dopisanie nowej nazwy.
+// deque nie przenosi elementow przy dopisywaniu, wiec referencje z symbol_name zostaja wazne.
+struct SymbolTable {
+    shared_mutex lock;
+    deque<string> names;
+    unordered_map<string, Symbol, NameHash, equal_to<>> ids;
+
+    SymbolTable() {
+        // Kolejnosc musi sie zgadzac z PredefinedSymbol
+        static const char* predefined[] = {
+            "def", "print", "if", "loop", "do",
+            "String", "Number", "typeof", "fun", "input",
+            "len", "get", "set", "sys", "random", "ord", "chr",
+            "file_read", "file_write", "file_open", "file_line", "file_eof", "file_close",
+            "sys_async", "await", "sys_status", "sys_stderr",
+            "pmap", "spawn", "join",
+            "array", "array_push", "array_slice", "array_sum", "array_min", "array_max", "array_fill", "array_map",
+            "map", "map_put", "map_get", "map_has", "map_delete", "map_keys", "map_size",
+            "+", "-", "*", "/", "%", "==", "!=", ">", "<", ">=", "<="
+        };
+        for (const char* name : predefined) {
+            ids[name] = names.size();
+            names.push_back(name);
+        }
+    }
+};
+
+static SymbolTable& table() {
+    static SymbolTable symbols;
+    return symbols;
+}
+
+Symbol intern(string_view text) {
+    SymbolTable& symbols = table();
+    {
+        shared_lock<shared_mutex> reading(symbols.lock);
+        auto it = symbols.ids.find(text);
+        if (it != symbols.ids.end()) return it->second;
+    }
+    // Miedzy blokadami inny watek mogl dopisac te sama nazwe
+    unique_lock<shared_mutex> writing(symbols.lock);
+    auto it = symbols.ids.find(text);
+    if (it != symbols.ids.end()) return it->second;
+    Symbol symbol = symbols.names.size();
+    symbols.names.emplace_back(text);
+    symbols.ids.emplace(text, symbol);
+    return symbol;
+}
+
+const string& symbol_name(Symbol symbol) {
+    SymbolTable& symbols = table();
+    shared_lock<shared_mutex> reading(symbols.lock);
+    return symbols.names[symbol];
+}
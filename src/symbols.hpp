@@ -0,0 +1,55 @@
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+// Globalna tablica symboli. Kazda nazwa (identyfikator albo operator) dostaje raz swoj numer,
+// a potem porownujemy juz tylko liczby zamiast stringow.
+using Symbol = uint32_t;
+
+// Token bez symbolu (liczby, stringi, nawiasy)
+constexpr Symbol NO_SYMBOL = UINT32_MAX;
+
+// Slowa kluczowe i operatory maja stale numery, zeby mozna bylo robic na nich switch.
+// Operatory ida w tej samej kolejnosci co InfixOp.
+enum PredefinedSymbol : Symbol {
+    KW_DEF, KW_PRINT, KW_IF, KW_LOOP, KW_DO,
+    KW_STRING, KW_NUMBER, KW_TYPEOF, KW_FUN, KW_INPUT,
+    KW_LEN, KW_GET, KW_SET, KW_SYS, KW_RANDOM, KW_ORD, KW_CHR,
+    KW_FILE_READ, KW_FILE_WRITE, KW_FILE_OPEN, KW_FILE_LINE, KW_FILE_EOF, KW_FILE_CLOSE,
+    KW_SYS_ASYNC, KW_AWAIT, KW_SYS_STATUS, KW_SYS_STDERR,
+    KW_PMAP, KW_SPAWN, KW_JOIN,
+    KW_ARRAY, KW_ARRAY_PUSH, KW_ARRAY_SLICE, KW_ARRAY_SUM, KW_ARRAY_MIN, KW_ARRAY_MAX, KW_ARRAY_FILL, KW_ARRAY_MAP,
+    KW_MAP, KW_MAP_PUT, KW_MAP_GET, KW_MAP_HAS, KW_MAP_DELETE, KW_MAP_KEYS, KW_MAP_SIZE,
+    KEYWORD_COUNT,
+
+    SYM_ADD = KEYWORD_COUNT, SYM_SUB, SYM_MUL, SYM_DIV, SYM_MOD,
+    SYM_EQ, SYM_NE, SYM_GT, SYM_LT, SYM_GE, SYM_LE,
+    PREDEFINED_SYMBOL_COUNT
+};
+
+// Zwraca numer nazwy, dopisujac ja do tablicy jesli jej jeszcze nie ma
+Symbol intern(string_view text);
+
+// Nazwa symbolu (do komunikatow bledow)
+const string& symbol_name(Symbol symbol);
+
+inline bool is_keyword(Symbol symbol) { return symbol < KEYWORD_COUNT; }
@@ -0,0 +1,271 @@
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "transpiler.hpp"
+#include "builtins.hpp"
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+// Literal C++ dla dowolnego tekstu. Znaki spoza ASCII i sterujace jako \ooo (zawsze 3 cyfry,
+// wiec cyfra zaraz za nimi nie zostanie wciagnieta do escape'a).
+static string cpp_literal(string_view text) {
+    static const char* digits = "01234567";
+    string result = "\"";
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\') { result += '\\'; result += c; }
+        else if (c >= 0x20 && c < 0x7F && c != '?') result += c;
+        else { result += '\\'; result += digits[c >> 6]; result += digits[(c >> 3) & 7]; result += digits[c & 7]; }
+    }
+    return result + "\"";
+}
+
+// Stala z bajtkodu jako wyrazenie C++
+static string cpp_value(const Value& val) {
+    if (val.type() == TYPE_NUMBER) {
+        if (val.as_number() == INT64_MIN) return "Value::number(INT64_MIN)";
+        return "Value::number(INT64_C(" + to_string(val.as_number()) + "))";
+    }
+    string_view text = val.as_string();
+    if (val.is_heap()) return "shared_constant(Value::string(string_view(" + cpp_literal(text) + ", " + to_string(text.size()) + ")))";
+    return "Value::string(string_view(" + cpp_literal(text) + ", " + to_string(text.size()) + "))";
+}
+
+// Tekst operatora dla komunikatow bledow (tak jak w BRACKET_INFIX_CASE w vm.cpp)
+static const char* INFIX_TEXT[] = {"+", "-", "*", "/", "%", "==", "!=", ">", "<", ">=", "<="};
+static const char* INFIX_NAME[] = {"INFIX_ADD", "INFIX_SUB", "INFIX_MUL", "INFIX_DIV", "INFIX_MOD", "INFIX_EQ", "INFIX_NE", "INFIX_GT", "INFIX_LT", "INFIX_GE", "INFIX_LE"};
+
+// Glebokosc stosu przed kazda instrukcja kawalka (liczba wartosci w ramce, -1 dla kodu, do ktorego nie da sie dojsc).
+// Kompilator zawsze zostawia w danym miejscu tyle samo wartosci, niezaleznie od drogi.
+static vector<int32_t> stack_depths(const Chunk& chunk, uint32_t& max_depth) {
+    const vector<uint32_t>& code = chunk.code;
+    vector<int32_t> depths(code.size(), -1);
+    vector<pair<uint32_t, int32_t>> work = {{0, (int32_t)chunk.locals.size()}};
+    max_depth = chunk.locals.size();
+    while (!work.empty()) {
+        auto [pc, depth] = work.back();
+        work.pop_back();
+        if (depths[pc] >= 0) {
+            if (depths[pc] != depth) throw runtime_error("Critical error: Inconsistent stack depth in compiled code.");
+            continue;
+        }
+        depths[pc] = depth;
+        max_depth = max(max_depth, (uint32_t)depth + 1);
+
+        uint32_t op = code[pc];
+        uint32_t arg = pc + 1 < code.size() ? code[pc + 1] : 0;
+        uint32_t next = pc + instruction_size(op);
+        switch (op) {
+            case OP_CONST: case OP_NIL: case OP_LOAD_LOCAL: case OP_LOAD_CAPTURE: case OP_MAKE_FUN:
+                work.push_back({next, depth + 1}); break;
+            case OP_DEF_LOCAL: case OP_NUMBER: case OP_STRING: case OP_TYPEOF: case OP_LEN:
+            case OP_SYS: case OP_ORD: case OP_CHR:
+            case OP_FILE_READ: case OP_FILE_OPEN: case OP_FILE_LINE: case OP_FILE_EOF: case OP_FILE_CLOSE:
+            case OP_SYS_ASYNC: case OP_AWAIT: case OP_SYS_STATUS: case OP_SYS_STDERR: case OP_JOIN:
+            case OP_ARRAY_SUM: case OP_ARRAY_MIN: case OP_ARRAY_MAX: case OP_MAP_KEYS: case OP_MAP_SIZE:
+                work.push_back({next, depth}); break;
+            case OP_JUMP: case OP_LOOP: work.push_back({arg, depth}); break;
+            case OP_JUMP_IF_FALSE:
+                work.push_back({next, depth - 1});
+                work.push_back({arg, depth - 1});
+                break;
+            case OP_CALL_OR_JUMP:
+                work.push_back({next, depth});
+                work.push_back({code[pc + 2], depth});
+                break;
+            case OP_CALL: work.push_back({next, depth - (int32_t)arg}); break;
+            case OP_PRINT: case OP_SPAWN: case OP_ARRAY: case OP_MAP: work.push_back({next, depth - (int32_t)arg + 1}); break;
+            case OP_ARRAY_SLICE: case OP_MAP_PUT: case OP_MAP_PUT_LOCAL: work.push_back({next, depth - 2}); break;
+            case OP_INPUT: work.push_back({next, arg == 1 ? depth : depth + 1}); break;
+            case OP_TAIL_CALL: case OP_RETURN: case OP_THROW: break;
+            default: work.push_back({next, depth - 1}); break; // POP, SET_LOCAL, MAP_DELETE, GET, RANDOM, FILE_WRITE i operatory
+        }
+    }
+    return depths;
+}
+
+class CppEmitter {
+public:
+    explicit CppEmitter(ostream& out) : out(out) {}
+
+    void emit(const Chunk& program, const string& source_name) {
+        number_chunks(program);
+
+        out << "// Wygenerowane przez bracketLang --emit-cpp z pliku " << source_name << "\n";
+        out << "#include \"runtime.hpp\"\n\n";
+
+        for (size_t id = 0; id < chunks.size(); ++id) {
+            const Chunk& chunk = *chunks[id];
+            for (size_t k = 0; k < chunk.constants.size(); ++k) {
+                out << "static const Value constant_" << id << "_" << k << " = " << cpp_value(chunk.constants[k]) << ";\n";
+            }
+        }
+        out << "\n";
+        for (size_t id = 1; id < chunks.size(); ++id) {
+            const Chunk& chunk = *chunks[id];
+            out << "static const shared_ptr<Chunk> function_" << id << " = native_chunk(" << id << ", " << chunk.parameter_count << ", {";
+            for (size_t i = 0; i < chunk.local_init.size(); ++i) out << (i ? ", " : "") << chunk.local_init[i];
+            out << "}, {";
+            for (size_t i = 0; i < chunk.capture_from.size(); ++i) {
+                out << (i ? ", " : "") << "{" << (chunk.capture_from[i].from_local ? "true" : "false") << ", " << chunk.capture_from[i].index << "}";
+            }
+            out << "});\n";
+        }
+
+        // Ciala wszystkich funkcji, wywolania zbieraja miejsca powrotu
+        ostringstream bodies;
+        for (size_t id = 0; id < chunks.size(); ++id) emit_chunk(id, bodies);
+
+        out << "\nstatic void program(Machine& m) {\n";
+        out << "    uint32_t target = m.start;\n";
+        out << "    if (target) goto enter;\n";
+        out << "    goto chunk_0;\n";
+        // Wejscie do ciala funkcji po wywolaniu
+        out << "enter:\n    switch (target) {\n";
+        for (size_t id = 1; id < chunks.size(); ++id) out << "        case " << id << ": goto chunk_" << id << ";\n";
+        out << "        default: return;\n    }\n";
+        // Koniec funkcji - powrot do miejsca wywolania albo koniec programu
+        out << "leave:\n    switch (target) {\n";
+        for (uint32_t r = 0; r < resume_count; ++r) out << "        case " << r << ": goto resume_" << r << ";\n";
+        out << "        default: return;\n    }\n";
+        out << bodies.str();
+        out << "}\n\n";
+
+        out << "int main() {\n";
+        out << "    max_call_depth = " << max_call_depth << ";\n";
+        out << "    return run_native(program, " << program.locals.size() << ");\n";
+        out << "}\n";
+    }
+
+private:
+    ostream& out;
+    vector<const Chunk*> chunks;    // numer ciala -> kod (0 to program glowny)
+    map<const Chunk*, uint32_t> ids;
+    uint32_t resume_count = 0;
+
+    void number_chunks(const Chunk& chunk) {
+        ids[&chunk] = chunks.size();
+        chunks.push_back(&chunk);
+        for (const auto& function : chunk.functions) number_chunks(*function);
+    }
+
+    void emit_chunk(uint32_t id, ostream& body) {
+        const Chunk& chunk = *chunks[id];
+        const vector<uint32_t>& code = chunk.code;
+        uint32_t max_depth = 0;
+        vector<int32_t> depths = stack_depths(chunk, max_depth);
+        auto label = [&](uint32_t pc) { return "chunk_" + to_string(id) + "_" + to_string(pc); };
+
+        // Instrukcje, do ktorych cos skacze, dostaja etykiety
+        set<uint32_t> targets;
+        for (uint32_t pc = 0; pc < code.size(); pc += instruction_size(code[pc])) {
+            if (depths[pc] < 0) continue;
+            if (code[pc] == OP_JUMP || code[pc] == OP_JUMP_IF_FALSE || code[pc] == OP_LOOP) targets.insert(code[pc + 1]);
+            if (code[pc] == OP_CALL_OR_JUMP) targets.insert(code[pc + 2]);
+        }
+
+        body << "chunk_" << id << ":\n";
+        body << "    m.frame_size(" << max_depth << ");\n";
+        for (uint32_t pc = 0; pc < code.size(); pc += instruction_size(code[pc])) {
+            if (depths[pc] < 0) continue;
+            if (targets.count(pc)) body << label(pc) << ":\n";
+            uint32_t op = code[pc];
+            uint32_t arg = pc + 1 < code.size() ? code[pc + 1] : 0;
+            string d = to_string(depths[pc]);
+            body << "    ";
+            switch (op) {
+                case OP_CONST: body << "m.push(" << d << ", constant_" << id << "_" << arg << ");"; break;
+                case OP_NIL: body << "m.nil(" << d << ");"; break;
+                case OP_POP: body << "m.pop(" << d << ");"; break;
+                case OP_LOAD_LOCAL: body << "m.load_local(" << d << ", " << arg << ", " << cpp_literal(symbol_name(chunk.locals[arg])) << ");"; break;
+                case OP_LOAD_CAPTURE: body << "m.load_capture(" << d << ", " << arg << ", " << cpp_literal(symbol_name(chunk.captures[arg])) << ");"; break;
+                case OP_DEF_LOCAL: body << "m.def_local(" << d << ", " << arg << ");"; break;
+                case OP_SET_LOCAL: body << "m.set_local(" << d << ", " << arg << ");"; break;
+                case OP_JUMP: case OP_LOOP: body << "goto " << label(arg) << ";"; break;
+                case OP_JUMP_IF_FALSE: body << "if (m.is_false(" << d << ")) goto " << label(arg) << ";"; break;
+                case OP_MAKE_FUN: body << "m.make_fun(" << d << ", function_" << ids.at(chunk.functions[arg].get()) << ");"; break;
+                case OP_CALL_OR_JUMP: body << "if (!m.is_call(" << d << ", " << arg << ")) goto " << label(code[pc + 2]) << ";"; break;
+                case OP_CALL:
+                    // Po powrocie ramka wywolujacego znow potrzebuje swojego rozmiaru
+                    body << "target = m.call(" << d << ", " << arg << ", " << resume_count << "); goto enter;\n";
+                    body << "resume_" << resume_count++ << ":\n";
+                    body << "    m.frame_size(" << max_depth << ");";
+                    break;
+                case OP_TAIL_CALL: body << "target = m.tail_call(" << d << ", " << arg << "); goto enter;"; break;
+                case OP_RETURN: body << "target = m.ret(" << d << "); goto leave;"; break;
+                case OP_UNKNOWN_OP: body << "m.infix<INFIX_UNKNOWN>(" << d << ", " << cpp_literal(chunk.names[arg]) << ");"; break;
+                case OP_PRINT: body << "m.print(" << d << ", " << arg << ");"; break;
+                case OP_INPUT: body << "m.input(" << d << ", " << arg << ");"; break;
+                case OP_NUMBER: body << "m.unary(" << d << ", builtin_number);"; break;
+                case OP_STRING: body << "m.unary(" << d << ", builtin_string);"; break;
+                case OP_TYPEOF: body << "m.unary(" << d << ", builtin_typeof);"; break;
+                case OP_LEN: body << "m.unary(" << d << ", builtin_len);"; break;
+                case OP_SYS: body << "m.unary(" << d << ", builtin_sys);"; break;
+                case OP_ORD: body << "m.unary(" << d << ", builtin_ord);"; break;
+                case OP_CHR: body << "m.unary(" << d << ", builtin_chr);"; break;
+                case OP_GET: body << "m.binary(" << d << ", builtin_get);"; break;
+                case OP_RANDOM: body << "m.binary(" << d << ", builtin_random);"; break;
+                case OP_FILE_READ: body << "m.unary(" << d << ", builtin_file_read);"; break;
+                case OP_FILE_WRITE: body << "m.binary(" << d << ", builtin_file_write);"; break;
+                case OP_FILE_OPEN: body << "m.unary(" << d << ", builtin_file_open);"; break;
+                case OP_FILE_LINE: body << "m.unary(" << d << ", builtin_file_line);"; break;
+                case OP_FILE_EOF: body << "m.unary(" << d << ", builtin_file_eof);"; break;
+                case OP_FILE_CLOSE: body << "m.unary(" << d << ", builtin_file_close);"; break;
+                case OP_SYS_ASYNC: body << "m.unary(" << d << ", builtin_sys_async);"; break;
+                case OP_AWAIT: body << "m.unary(" << d << ", builtin_await);"; break;
+                case OP_SYS_STATUS: body << "m.unary(" << d << ", builtin_sys_status);"; break;
+                case OP_SYS_STDERR: body << "m.unary(" << d << ", builtin_sys_stderr);"; break;
+                case OP_PMAP: body << "m.binary(" << d << ", builtin_pmap);"; break;
+                case OP_SPAWN: body << "m.spawn(" << d << ", " << arg << ");"; break;
+                case OP_JOIN: body << "m.unary(" << d << ", builtin_join);"; break;
+                case OP_ARRAY: body << "m.array(" << d << ", " << arg << ");"; break;
+                case OP_ARRAY_PUSH: body << "m.binary(" << d << ", builtin_array_push);"; break;
+                case OP_ARRAY_SLICE: body << "m.ternary(" << d << ", builtin_array_slice);"; break;
+                case OP_ARRAY_SUM: body << "m.unary(" << d << ", builtin_array_sum);"; break;
+                case OP_ARRAY_MIN: body << "m.unary(" << d << ", builtin_array_min);"; break;
+                case OP_ARRAY_MAX: body << "m.unary(" << d << ", builtin_array_max);"; break;
+                case OP_ARRAY_FILL: body << "m.binary(" << d << ", builtin_array_fill);"; break;
+                case OP_ARRAY_MAP: body << "m.binary(" << d << ", builtin_array_map);"; break;
+                case OP_MAP: body << "m.map(" << d << ", " << arg << ");"; break;
+                case OP_MAP_PUT: body << "m.ternary(" << d << ", builtin_map_put);"; break;
+                case OP_MAP_DELETE: body << "m.binary(" << d << ", builtin_map_delete);"; break;
+                case OP_MAP_PUT_LOCAL: body << "m.map_put_local(" << d << ", " << arg << ");"; break;
+                case OP_MAP_DELETE_LOCAL: body << "m.map_delete_local(" << d << ", " << arg << ");"; break;
+                case OP_MAP_GET: body << "m.binary(" << d << ", builtin_map_get);"; break;
+                case OP_MAP_HAS: body << "m.binary(" << d << ", builtin_map_has);"; break;
+                case OP_MAP_KEYS: body << "m.unary(" << d << ", builtin_map_keys);"; break;
+                case OP_MAP_SIZE: body << "m.unary(" << d << ", builtin_map_size);"; break;
+                case OP_THROW: body << "Machine::fail(" << cpp_literal(chunk.constants[arg].as_string()) << ");"; break;
+                default: {
+                    // Operatory (takze wyspecjalizowane, jesli program byl juz wykonywany) - liczby wprost, reszta przez apply_infix
+                    uint32_t kind = op >= OP_ADD_NUM ? op - OP_ADD_NUM : op - OP_ADD;
+                    if (op == OP_ADD_STR) kind = INFIX_ADD;
+                    if (op == OP_EQ_STR) kind = INFIX_EQ;
+                    if (op == OP_NE_STR) kind = INFIX_NE;
+                    body << "m.infix<" << INFIX_NAME[kind] << ">(" << d << ", \"" << INFIX_TEXT[kind] << "\");";
+                    break;
+                }
+            }
+            body << "\n";
+        }
+    }
+};
+
+void emit_cpp(const Chunk& program, const string& source_name, ostream& out) {
+    CppEmitter(out).emit(program, source_name);
+}
@@ -0,0 +1,29 @@
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include "types.hpp"
+#include "compiler.hpp"
+
+#include <ostream>
+
+// Transpiler (opcja --emit-cpp) - zamienia skompilowany program na zrodlo C++.
+//
+// Kazda instrukcja bajtkodu staje sie jedna linijka C++ (wywolanie metody Machine z runtime.hpp),
+// skoki i wywolania funkcji to goto w jednej funkcji. Wynik kompiluje sie zwyklym kompilatorem
+// i linkuje z biblioteka bracket_runtime, np.:
+//     bracketLang --emit-cpp prog.bl > prog.cpp
+//     c++ -std=c++20 -O2 -I src prog.cpp -L build -lbracket_runtime -o prog
+void emit_cpp(const Chunk& program, const string& source_name, ostream& out);
@@ -1,65 +1,118 @@
-/**
- * Copyright 2025 KamilMalicki
- *
- * Licensed under the Apache License, Version 2.0 (the "License");
- * you may not use this file except in compliance with the License.
- * You may obtain a copy of the License at
- *
- * http://www.apache.org/licenses/LICENSE-2.0
- *
- * Unless required by applicable law or agreed to in writing, software
- * distributed under the License is distributed on an "AS IS" BASIS,
- * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
- * See the License for the specific language governing permissions and
- * limitations under the License.
- */
-#pragma once
-
-#include <string>
-#include <vector>
-#include <variant>
-#include <memory>
-#include <unordered_map>
-
-using namespace std;
-
-// Deklaracje z gory, zeby sie nie gryzlo pozniej
-struct Value;
-struct Expression;
-
-// Srodowisko, czyli mapa trzymajaca nasze zmienne. Klucz to nazwa, wartosc to Value.
-using Environment = unordered_map<string, Value>;
-
-// Specjalna struktura dla funkcji, przechowuje parametry, cialo i srodowisko z momentu definicji
-struct BraceFunction {
-    vector<string> parameters;          // nazwy parametrow
-    shared_ptr<Expression> body;        // cialo funkcji (kod do wykonania)
-    shared_ptr<Environment> closure_env; // "domkniecie", czyli srodowisko w ktorym funkcja powstala
-};
-
-// Typy wartosci jakie moga istniec w naszym jezyku
-enum ValueType { TYPE_NUMBER, TYPE_STRING, TYPE_NIL, TYPE_FUNCTION };
-
-// Taka nasza uniwersalna wartosc, moze byc liczba, stringiem, funkcja albo niczym (nil).
-// variant to fajna rzecz, przechowuje jeden z typow w danym momencie.
-struct Value {
-    variant<int_fast64_t, string, BraceFunction> data;
-    ValueType type = TYPE_NIL; // domyslnie wszystko jest nil
-};
-
-
-// Typy tokenow, zeby bylo wiadomo co jest czym po pracy lexera
-enum TokenType { TOKEN_LPAREN, TOKEN_RPAREN, TOKEN_NUMBER, TOKEN_STRING, TOKEN_IDENTIFIER, TOKEN_OPERATOR, TOKEN_INDEX_OP };
-
-// Token, czyli najmniejsza czastka kodu. Ma swoj typ i tekst.
-struct Token { TokenType type; string text; };
-
-// Lista wyrazen, przydatne do przechowywania ciala funkcji albo listy argumentow
-using ExpressionList = vector<Expression>;
-
-// Wyrazenie - moze byc albo pojedynczym tokenem (np. liczba) albo lista innych wyrazen (np. wywolanie funkcji)
-struct Expression { variant<Token, ExpressionList> data; };
-
-// Deklaracje funkcji z main.cpp, zeby mozna bylo z nich korzystac w evaluatorze
-string value_to_string(const Value& val);
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <span>
+#include <unordered_map>
+
+#include "symbols.hpp"
+#include "value.hpp"
+
+using namespace std;
+
+// Deklaracje z gory, zeby sie nie gryzlo pozniej
+struct Ast;
+struct Chunk;
+
+// Numer wezla w drzewie programu (Ast::nodes)
+using NodeId = uint32_t;
+
+// Srodowisko, czyli mapa trzymajaca nasze zmienne. Klucz to symbol nazwy, wartosc to Value.
+// Alokator liczy pamiec i kopie srodowisk dla --mem-stats.
+using Environment = unordered_map<Symbol, Value, hash<Symbol>, equal_to<Symbol>, CountingAllocator<pair<const Symbol, Value>, MEM_ENVIRONMENT>>;
+
+// Specjalna struktura dla funkcji, przechowuje parametry, cialo i wartosci z momentu definicji.
+// Zyje na stercie i jest wspoldzielona przez wszystkie wartosci, ktore na nia wskazuja.
+struct BraceFunction : Object {
+    BraceFunction() {
+        kind = TYPE_FUNCTION;
+        if (mem_stats_enabled) mem_allocated(MEM_CLOSURE, sizeof(BraceFunction));
+    }
+    ~BraceFunction() {
+        if (mem_stats_enabled) mem_freed(MEM_CLOSURE, sizeof(BraceFunction));
+    }
+
+    vector<Symbol> parameters;          // nazwy parametrow
+    const Ast* ast = nullptr;           // drzewo, w ktorym lezy cialo funkcji
+    NodeId body = 0;                    // cialo funkcji (kod do wykonania) - numer wezla, bez kopiowania
+    shared_ptr<const Chunk> code;       // skompilowane cialo (tylko dla funkcji z maszyny wirtualnej)
+    vector<Value, CountingAllocator<Value, MEM_CLOSURE>> captures; // domkniecie - tylko wartosci, ktorych uzywa cialo
+    vector<Symbol, CountingAllocator<Symbol, MEM_CLOSURE>> capture_names; // ich nazwy (tylko dla funkcji z evaluatora drzewa)
+};
+
+// Te dwie funkcje Value potrzebuja pelnej definicji BraceFunction
+inline Value Value::function(BraceFunction* func) { return from_object(func, TYPE_FUNCTION); }
+inline BraceFunction& Value::as_function() const { return *static_cast<BraceFunction*>(object()); }
+
+// Typy tokenow, zeby bylo wiadomo co jest czym po pracy lexera
+enum TokenType { TOKEN_LPAREN, TOKEN_RPAREN, TOKEN_NUMBER, TOKEN_STRING, TOKEN_IDENTIFIER, TOKEN_OPERATOR, TOKEN_INDEX_OP };
+
+// Token, czyli najmniejsza czastka kodu. Ma swoj typ i tekst.
+// Tekst nie jest kopiowany - wskazuje prosto w kod zrodlowy, wiec zrodlo musi zyc dluzej niz tokeny i drzewo.
+// Stringi z sekwencjami ucieczki (np. \n) lexer dekoduje od razu do constant, a text zostaje surowy.
+// Identyfikatory i operatory maja tez symbol z tablicy symboli, zeby evaluator nie porownywal stringow.
+// Liczby i stringi dostaja od optymalizatora gotowa wartosc (constant), zeby nie dekodowac tekstu
+// przy kazdym wykonaniu. TYPE_UNDEFINED znaczy, ze wartosci nie ma (np. liczba za duza dla stoll).
+struct Token { TokenType type; string_view text; Symbol symbol = NO_SYMBOL; Value constant = Value::undefined(); };
+
+// Tekst tokena tak jak widzi go program - w stringach z sekwencjami ucieczki juz zdekodowany
+inline string_view token_text(const Token& token) {
+    return token.type == TOKEN_STRING && token.constant.type() == TYPE_STRING ? token.constant.as_string() : token.text;
+}
+
+// Symbol nazwy z tokena - w 'def' i w parametrach nazwa moze byc dowolnym tokenem (np. liczba)
+inline Symbol name_symbol(const Token& token) { return token.symbol != NO_SYMBOL ? token.symbol : intern(token_text(token)); }
+
+// Wezel drzewa - moze byc albo pojedynczym tokenem (np. liczba) albo lista innych wezlow (np. wywolanie funkcji).
+// Lista to wezel z tokenem TOKEN_LPAREN, a jej elementy to wezly first .. first + count - 1,
+// lezace zawsze obok siebie.
+struct Node {
+    Token token;
+    uint32_t first = 0;
+    uint32_t count = 0;
+
+    bool is_list() const { return token.type == TOKEN_LPAREN; }
+    // Numer i-tego elementu listy
+    NodeId child(size_t i) const { return first + i; }
+};
+
+// Drzewo calego programu w jednej ciaglej tablicy. Parser dokleja elementy kazdej listy jednym blokiem,
+// wiec przejscie po liscie to przejscie po kolejnych komorkach pamieci, a zwolnienie drzewa to jedna dealokacja.
+// Cialo funkcji to po prostu numer wezla. Drzewo musi zyc dluzej niz funkcje z evaluatora.
+struct Ast {
+    vector<Node, CountingAllocator<Node, MEM_AST>> nodes;
+    NodeId root = 0;  // lista wyrazen glownych programu
+    string_view source;  // kod, w ktory wskazuja tokeny (np. do numerow linii w --profile)
+    // Nazwy, ktorych moze uzywac cialo kazdej funkcji (klucz to wezel 'fun'). Wypelnia je evaluator drzewa
+    // przy pierwszym wykonaniu danego 'fun', zeby domkniecie bralo tylko te zmienne zamiast calego srodowiska.
+    mutable unordered_map<NodeId, vector<Symbol>> closure_names;
+
+    const Node& operator[](NodeId id) const { return nodes[id]; }
+    Node& operator[](NodeId id) { return nodes[id]; }
+
+    // Elementy listy
+    span<const Node> list(const Node& node) const { return {nodes.data() + node.first, node.count}; }
+    span<Node> list(const Node& node) { return {nodes.data() + node.first, node.count}; }
+    // Wyrazenia glowne programu
+    span<const Node> program() const { return list(nodes[root]); }
+};
+
+// Deklaracje funkcji z builtins.cpp, zeby mozna bylo z nich korzystac w evaluatorze
+string value_to_string(const Value& val);
 void print_value(const Value& val);
\ No newline at end of file
@@ -0,0 +1,391 @@
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "types.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+// --mem-stats: string na stercie to obiekt i jego bufor
+static size_t string_bytes(const StringObject* obj) { return sizeof(StringObject) + obj->text.capacity(); }
+
+Value Value::string(string_view text) {
+    if (text.size() <= SMALL_STRING_MAX) {
+        Value val;
+        val.tag = TYPE_STRING;
+        val.small_length = text.size();
+        memcpy(val.payload, text.data(), text.size());
+        return val;
+    }
+    StringObject* obj = new StringObject();
+    obj->kind = TYPE_STRING;
+    obj->text = text;
+    if (mem_stats_enabled) mem_allocated(MEM_STRING, string_bytes(obj));
+    return from_buffer(obj);
+}
+
+Value Value::string(std::string&& text) {
+    if (text.size() <= SMALL_STRING_MAX) return string(string_view(text));
+    StringObject* obj = new StringObject();
+    obj->kind = TYPE_STRING;
+    obj->text = std::move(text);
+    if (mem_stats_enabled) mem_allocated(MEM_STRING, string_bytes(obj));
+    return from_buffer(obj);
+}
+
+// Wartosc widzaca caly bufor
+Value Value::from_buffer(StringObject* obj) {
+    Value val = from_object(obj, TYPE_STRING);
+    val.set_heap_length(obj->text.size());
+    return val;
+}
+
+void Value::set_heap_length(size_t length) {
+    if (length > UINT32_MAX) throw runtime_error("String is too long.");
+    uint32_t short_length = length;
+    memcpy(payload + sizeof(Object*), &short_length, sizeof(short_length));
+}
+
+char* Value::mutable_chars() {
+    if (!(tag & HEAP_BIT)) return payload;
+    StringObject* obj = static_cast<StringObject*>(object());
+    if (obj->frozen || obj->refcount > 1) {
+        // Ktos jeszcze trzyma ten bufor (moze w innym watku) - kopiujemy, zeby zmiana byla widoczna tylko tutaj
+        *this = string(as_string());
+        obj = static_cast<StringObject*>(object());
+    }
+    return obj->text.data();
+}
+
+void Value::append(string_view tail) {
+    size_t length = as_string().size();
+    if (!(tag & HEAP_BIT)) {
+        if (length + tail.size() <= SMALL_STRING_MAX) {
+            memcpy(payload + length, tail.data(), tail.size());
+            small_length += tail.size();
+            return;
+        }
+        std::string text;
+        text.reserve(2 * (length + tail.size()));
+        text.append(payload, length);
+        text.append(tail);
+        *this = string(std::move(text));
+        return;
+    }
+
+    StringObject* obj = static_cast<StringObject*>(object());
+    // Jedyny wlasciciel moze uciac to, co ktos kiedys dokleil za nim. Zamrozonego bufora nie ruszamy wcale -
+    // inny watek moze go wlasnie czytac.
+    if (!obj->frozen && obj->refcount == 1) obj->text.resize(length);
+    if (!obj->frozen && obj->text.size() == length) {
+        // Bufor konczy sie dokladnie tam gdzie ta wartosc - dopisujemy w miejscu.
+        // Inne wartosci na tym buforze maja swoje dlugosci, wiec nowych znakow nie zobacza.
+        size_t old_bytes = string_bytes(obj);
+        if (tail.data() >= obj->text.data() && tail.data() < obj->text.data() + obj->text.size()) {
+            obj->text.append(std::string(tail)); // doklejamy kawalek samego siebie, a bufor moze sie przeniesc
+        } else {
+            obj->text.append(tail);
+        }
+        // Bufor urosl - dla statystyk to nowa alokacja w miejsce starej
+        if (mem_stats_enabled && string_bytes(obj) != old_bytes) {
+            mem_freed(MEM_STRING, old_bytes);
+            mem_allocated(MEM_STRING, string_bytes(obj));
+        }
+        set_heap_length(obj->text.size());
+        return;
+    }
+
+    // Ktos juz dopisal cos za nami - potrzebny nowy bufor
+    std::string text;
+    text.reserve(2 * (length + tail.size()));
+    text.append(obj->text.data(), length);
+    text.append(tail);
+    *this = string(std::move(text));
+}
+
+// --mem-stats: tablica i slownik to obiekt i ich bufory
+static size_t object_bytes(const ArrayObject* obj) {
+    return sizeof(ArrayObject) + obj->numbers.capacity() * sizeof(int64_t) + obj->values.capacity() * sizeof(Value);
+}
+static size_t object_bytes(const MapObject* obj) {
+    return sizeof(MapObject) + obj->entries.capacity() * sizeof(MapObject::Entry) + obj->slots.capacity() * sizeof(uint64_t);
+}
+
+Value Value::array(ArrayObject* array) {
+    array->kind = TYPE_ARRAY;
+    if (mem_stats_enabled) mem_allocated(MEM_ARRAY, object_bytes(array));
+    Value val = from_object(array, TYPE_ARRAY);
+    if (array->size() > UINT32_MAX) throw runtime_error("Array is too long.");
+    val.set_heap_length(array->size());
+    return val;
+}
+
+void ArrayObject::unpack() {
+    if (!packed) return;
+    values.reserve(numbers.capacity());
+    for (int64_t num : numbers) values.push_back(Value::number(num));
+    numbers = vector<int64_t>();
+    packed = false;
+}
+
+ArrayObject& Value::own_array() {
+    ArrayObject* obj = &as_array();
+    size_t length = array_length();
+    if (obj->frozen || obj->refcount > 1) {
+        // Ktos jeszcze trzyma ten bufor (moze w innym watku) - kopiujemy nasza czesc
+        ArrayObject* copy = new ArrayObject();
+        copy->packed = obj->packed;
+        if (obj->packed) copy->numbers.assign(obj->numbers.begin(), obj->numbers.begin() + length);
+        else copy->values.assign(obj->values.begin(), obj->values.begin() + length);
+        *this = array(copy);
+        return *copy;
+    }
+    // Jedyny wlasciciel moze uciac to, co ktos kiedys dopisal za nim
+    if (obj->packed) obj->numbers.resize(length);
+    else obj->values.resize(length);
+    return *obj;
+}
+
+// Zmiana bufora w miejscu - dla statystyk stary rozmiar znika, a nowy jest nowa alokacja
+template <class T, class F>
+static void resize_tracked(T& obj, MemCategory category, F&& change) {
+    if (!mem_stats_enabled) {
+        change();
+        return;
+    }
+    size_t old_bytes = object_bytes(&obj);
+    change();
+    if (object_bytes(&obj) != old_bytes) {
+        mem_freed(category, old_bytes);
+        mem_allocated(category, object_bytes(&obj));
+    }
+}
+
+void Value::array_set(size_t index, const Value& element) {
+    Value keep = element;  // element moze byc w tej samej tablicy, ktora zaraz sie zmieni
+    ArrayObject& obj = own_array();
+    if (obj.packed && keep.type() == TYPE_NUMBER) {
+        obj.numbers[index] = keep.as_number();
+        return;
+    }
+    resize_tracked(obj, MEM_ARRAY, [&] { obj.unpack(); });
+    obj.values[index] = std::move(keep);
+}
+
+// Czy przez wartosc da sie dojsc do obiektu. Tablica dopisujaca w miejscu do wspoldzielonego bufora
+// nie moze dostac elementu, ktory ten bufor trzyma - powstalby cykl, ktorego liczniki referencji nigdy nie zwolnia.
+static bool reaches(const Value& val, const Object* target) {
+    if (!val.is_heap() || val.type() == TYPE_STRING) return false;
+    if (val.type() == TYPE_FUNCTION) {
+        for (const Value& capture : val.as_function().captures) {
+            if (reaches(capture, target)) return true;
+        }
+        return false;
+    }
+    if (val.type() == TYPE_MAP) {
+        const MapObject& map = val.as_map();
+        if (&map == target) return true;
+        for (const MapObject::Entry& entry : map.entries) {
+            if (reaches(entry.value, target)) return true;
+        }
+        return false;
+    }
+    const ArrayObject& array = val.as_array();
+    if (&array == target) return true;
+    if (array.packed) return false;
+    for (size_t i = 0; i < val.array_length(); ++i) {
+        if (reaches(array.values[i], target)) return true;
+    }
+    return false;
+}
+
+void Value::array_push(const Value& element) {
+    Value keep = element;
+    ArrayObject* obj = &as_array();
+    size_t length = array_length();
+    if (length + 1 > UINT32_MAX) throw runtime_error("Array is too long.");
+    if (!obj->frozen && obj->refcount == 1) {
+        if (obj->packed) obj->numbers.resize(length);
+        else obj->values.resize(length);
+    }
+    if (obj->frozen || obj->size() != length || (obj->refcount > 1 && reaches(keep, obj))) {
+        // Ktos juz dopisal cos za nami, bufor jest zamrozony albo element go trzyma - potrzebny nowy bufor, od razu z zapasem
+        ArrayObject* copy = new ArrayObject();
+        copy->packed = obj->packed;
+        if (obj->packed) {
+            copy->numbers.reserve(2 * (length + 1));
+            copy->numbers.assign(obj->numbers.begin(), obj->numbers.begin() + length);
+        } else {
+            copy->values.reserve(2 * (length + 1));
+            copy->values.assign(obj->values.begin(), obj->values.begin() + length);
+        }
+        *this = array(copy);
+        obj = copy;
+    }
+    // Bufor konczy sie dokladnie tam gdzie ta wartosc - dopisujemy w miejscu.
+    // Inne wartosci na tym buforze maja swoje dlugosci, wiec nowego elementu nie zobacza.
+    resize_tracked(*obj, MEM_ARRAY, [&] {
+        if (obj->packed && keep.type() == TYPE_NUMBER) {
+            obj->numbers.push_back(keep.as_number());
+            return;
+        }
+        obj->unpack();
+        obj->values.push_back(std::move(keep));
+    });
+    set_heap_length(length + 1);
+}
+
+Value Value::map(MapObject* map) {
+    map->kind = TYPE_MAP;
+    if (mem_stats_enabled) mem_allocated(MEM_MAP, object_bytes(map));
+    return from_object(map, TYPE_MAP);
+}
+
+MapObject& Value::own_map() {
+    MapObject* obj = &as_map();
+    if (obj->frozen || obj->refcount > 1) {
+        // Ktos jeszcze trzyma ten slownik (moze w innym watku) - zmieniamy wlasna kopie
+        MapObject* copy = new MapObject();
+        copy->entries = obj->entries;
+        copy->slots = obj->slots;
+        copy->count = obj->count;
+        *this = map(copy);
+        return *copy;
+    }
+    return *obj;
+}
+
+void Value::map_put(const Value& key, const Value& value) {
+    Value keep = value;  // wartosc moze byc w tym slowniku, ktory zaraz sie zmieni
+    MapObject& obj = own_map();
+    resize_tracked(obj, MEM_MAP, [&] { obj.put(key, keep); });
+}
+
+bool Value::map_erase(const Value& key) {
+    if (!as_map().find(key)) return false;
+    MapObject& obj = own_map();
+    bool erased;
+    resize_tracked(obj, MEM_MAP, [&] { erased = obj.erase(key); });
+    return erased;
+}
+
+// Skrot klucza - szybki, niekryptograficzny. Stringi po 8 bajtow naraz, na koniec mieszanie z MurmurHash3,
+// zeby kolejne liczby (czesty przypadek) nie trafialy w sasiednie sloty.
+static uint64_t mix(uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+static uint64_t hash_key(const Value& key) {
+    if (key.type() == TYPE_NUMBER) return mix(key.as_number());
+    string_view text = key.as_string();
+    uint64_t hash = 0x9e3779b97f4a7c15ULL ^ text.size();
+    size_t i = 0;
+    for (; i + 8 <= text.size(); i += 8) {
+        uint64_t word;
+        memcpy(&word, text.data() + i, 8);
+        hash = (hash ^ word) * 0xbf58476d1ce4e5b9ULL;
+        hash ^= hash >> 29;
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, text.data() + i, text.size() - i);
+    return mix(hash ^ tail);
+}
+
+static bool same_key(const Value& left, const Value& right) {
+    if (left.type() != right.type()) return false;
+    if (left.type() == TYPE_NUMBER) return left.as_number() == right.as_number();
+    return left.as_string() == right.as_string();
+}
+
+// Slot z tym kluczem albo SIZE_MAX
+size_t MapObject::find_slot(const Value& key, uint64_t hash) const {
+    if (slots.empty()) return SIZE_MAX;
+    size_t mask = slots.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        uint64_t slot = slots[i];
+        if (slot == 0) return SIZE_MAX;
+        if (slot != TOMBSTONE && (slot >> 32) == (hash >> 32) && same_key(entries[(uint32_t)slot - 1].key, key)) return i;
+    }
+}
+
+const Value* MapObject::find(const Value& key) const {
+    size_t slot = find_slot(key, hash_key(key));
+    return slot == SIZE_MAX ? nullptr : &entries[(uint32_t)slots[slot] - 1].value;
+}
+
+void MapObject::put(const Value& key, const Value& value) {
+    uint64_t hash = hash_key(key);
+    size_t slot = find_slot(key, hash);
+    if (slot != SIZE_MAX) {
+        entries[(uint32_t)slots[slot] - 1].value = value;
+        return;
+    }
+    if (entries.size() + 1 >= UINT32_MAX) throw runtime_error("Map is too large.");
+    // Kazda para w entries (takze usunieta) zajmuje slot - najwyzej 3/4 slotow moze byc zajete
+    if ((entries.size() + 1) * 4 > slots.size() * 3) rebuild();
+    size_t mask = slots.size() - 1;
+    size_t i = hash & mask;
+    while (slots[i] != 0) i = (i + 1) & mask;
+    entries.push_back(Entry{key, value});
+    slots[i] = (hash & 0xFFFFFFFF00000000ULL) | entries.size();
+    count++;
+}
+
+bool MapObject::erase(const Value& key) {
+    size_t slot = find_slot(key, hash_key(key));
+    if (slot == SIZE_MAX) return false;
+    Entry& entry = entries[(uint32_t)slots[slot] - 1];
+    entry.key = Value::undefined();
+    entry.value.set_nil();
+    slots[slot] = TOMBSTONE;
+    count--;
+    return true;
+}
+
+// Usuniete pary wypadaja, a slotow jest tyle, zeby po przebudowie byly zajete najwyzej w polowie
+void MapObject::rebuild() {
+    if (count != entries.size()) {
+        entries.erase(remove_if(entries.begin(), entries.end(), [](const Entry& entry) { return entry.key.type() == TYPE_UNDEFINED; }), entries.end());
+    }
+    size_t capacity = 8;
+    while (capacity < (count + 1) * 2) capacity *= 2;
+    slots.assign(capacity, 0);
+    size_t mask = capacity - 1;
+    for (size_t index = 0; index < entries.size(); ++index) {
+        uint64_t hash = hash_key(entries[index].key);
+        size_t i = hash & mask;
+        while (slots[i] != 0) i = (i + 1) & mask;
+        slots[i] = (hash & 0xFFFFFFFF00000000ULL) | (index + 1);
+    }
+}
+
+void Value::destroy(Object* obj) {
+    if (obj->kind == TYPE_STRING) {
+        if (mem_stats_enabled) mem_freed(MEM_STRING, string_bytes(static_cast<StringObject*>(obj)));
+        delete static_cast<StringObject*>(obj);
+    } else if (obj->kind == TYPE_ARRAY) {
+        if (mem_stats_enabled) mem_freed(MEM_ARRAY, object_bytes(static_cast<ArrayObject*>(obj)));
+        delete static_cast<ArrayObject*>(obj);
+    } else if (obj->kind == TYPE_MAP) {
+        if (mem_stats_enabled) mem_freed(MEM_MAP, object_bytes(static_cast<MapObject*>(obj)));
+        delete static_cast<MapObject*>(obj);
+    }
+    else delete static_cast<BraceFunction*>(obj);
+}
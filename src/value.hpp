@@ -0,0 +1,272 @@
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "memstats.hpp"
+
+using namespace std;
+
+// Typy wartosci jakie moga istniec w naszym jezyku.
+// TYPE_UNDEFINED nigdy nie trafia do programu - tak maszyna wirtualna oznacza slot zmiennej bez wartosci.
+enum ValueType : uint8_t { TYPE_NUMBER, TYPE_STRING, TYPE_NIL, TYPE_FUNCTION, TYPE_UNDEFINED, TYPE_ARRAY, TYPE_MAP };
+
+// Wspolny poczatek wszystkich obiektow na stercie. Licznik referencji jest w samym obiekcie,
+// wiec kopia wartosci to tylko ++refcount zamiast kopiowania calego stringa czy funkcji.
+// Obiekt zamrozony (frozen) moze byc widziany przez kilka watkow (pmap, spawn): licznik jest wtedy zmieniany
+// atomowo, a obiekt juz nigdy nie jest zmieniany w miejscu.
+struct Object {
+    uint32_t refcount = 0;
+    ValueType kind;
+    bool frozen = false;
+};
+
+// String na stercie - tylko dla dluzszych tekstow, krotkie siedza w samej wartosci.
+// Dziala jak bufor do doklejania: kazda wartosc pamieta swoja dlugosc i widzi tylko poczatek bufora,
+// wiec '+' moze dopisac na koncu bufora bez psucia innych wartosci, ktore go wspoldziela.
+// Znaki w zasiegu jakiejs wartosci sa niezmienne dopoki bufor ma wiecej niz jednego wlasciciela ('set' najpierw robi kopie).
+struct StringObject : Object {
+    string text;
+};
+
+struct BraceFunction;
+struct ArrayObject;
+struct MapObject;
+
+// Nasza uniwersalna wartosc - 16 bajtow.
+// Liczby i stringi do 14 znakow (np. jednoznakowe wyniki get, chr i N') trzymamy w srodku,
+// dluzsze stringi, tablice, slowniki i funkcje to wskaznik na obiekt z licznikiem referencji.
+//
+// Uklad bajtow: [0..13] liczba / wskaznik + dlugosc dlugiego stringa albo tablicy [8..11] / znaki krotkiego stringa,
+// [14] dlugosc krotkiego stringa, [15] znacznik: typ w dolnych bitach i HEAP_BIT gdy wartosc wskazuje na obiekt.
+class Value {
+public:
+    static constexpr size_t SMALL_STRING_MAX = 14;
+    // Uklad bajtow jest tez uzywany przez JIT (jit.cpp), ktory czyta i zapisuje wartosci bezposrednio
+    static constexpr size_t TAG_OFFSET = 15;
+    static constexpr uint8_t HEAP_BIT = 0x80;
+
+    Value() { set_high_word(TYPE_NIL); }
+    Value(const Value& other) { copy_bits(other); retain(); }
+    Value(Value&& other) noexcept { copy_bits(other); other.set_high_word(TYPE_NIL); }
+    ~Value() { release(); }
+
+    Value& operator=(const Value& other) {
+        if (this != &other) {
+            other.retain();
+            release();
+            copy_bits(other);
+        }
+        return *this;
+    }
+    Value& operator=(Value&& other) noexcept {
+        if (this != &other) {
+            release();
+            copy_bits(other);
+            other.set_high_word(TYPE_NIL);
+        }
+        return *this;
+    }
+
+    static Value number(int_fast64_t num) {
+        Value val;
+        val.set_high_word(TYPE_NUMBER);
+        memcpy(val.payload, &num, sizeof(num));
+        return val;
+    }
+    // Zamienia wartosc w miejscu na liczbe (bez tworzenia tymczasowej wartosci)
+    void set_number(int_fast64_t num) {
+        release();
+        set_high_word(TYPE_NUMBER);
+        memcpy(payload, &num, sizeof(num));
+    }
+    // Zamienia wartosc w miejscu na nil
+    void set_nil() {
+        release();
+        set_high_word(TYPE_NIL);
+    }
+    static Value string(string_view text);
+    static Value string(std::string&& text);
+    static Value string(const char* text) { return string(string_view(text)); }
+    // Przejmuje swiezo utworzona funkcje (licznik 0)
+    static Value function(BraceFunction* func);
+    static Value undefined() { Value val; val.set_high_word(TYPE_UNDEFINED); return val; }
+    // Przejmuje swiezo utworzona tablice (licznik 0) - wartosc widzi wszystkie jej elementy
+    static Value array(ArrayObject* array);
+    // Przejmuje swiezo utworzony slownik (licznik 0)
+    static Value map(MapObject* map);
+
+    ValueType type() const { return (ValueType)(tag & ~HEAP_BIT); }
+    // Czy wartosc trzyma obiekt na stercie (kopiowanie i niszczenie zmienia licznik referencji)
+    bool is_heap() const { return tag & HEAP_BIT; }
+    // Zamrazanie obiektu przed oddaniem go innemu watkowi (tylko ten obiekt - domkniecia funkcji zamraza parallel.cpp)
+    bool is_frozen() const { return (tag & HEAP_BIT) && object()->frozen; }
+    void freeze() const { if (tag & HEAP_BIT) object()->frozen = true; }
+    // Czy obie wartosci trzymaja ten sam obiekt na stercie
+    bool same_object(const Value& other) const { return (tag & HEAP_BIT) && (other.tag & HEAP_BIT) && object() == other.object(); }
+
+    int_fast64_t as_number() const {
+        int_fast64_t num;
+        memcpy(&num, payload, sizeof(num));
+        return num;
+    }
+    // Widok na tekst - wazny dopoki wartosc zyje i nie jest zmieniana
+    string_view as_string() const {
+        if (tag & HEAP_BIT) return string_view(static_cast<StringObject*>(object())->text.data(), heap_length());
+        return string_view(payload, small_length);
+    }
+    BraceFunction& as_function() const;
+
+    // Tablice. Wartosc widzi tylko pierwsze array_length() elementow bufora (jak string - patrz ArrayObject).
+    ArrayObject& as_array() const;
+    size_t array_length() const { return heap_length(); }
+    Value array_at(size_t index) const;
+    // Zmiana elementu w miejscu ('set'). Wspoldzielona tablica jest najpierw kopiowana.
+    void array_set(size_t index, const Value& element);
+    // Dopisanie na koniec. Jak append dla stringow: w miejscu, jesli nikt nie dopisal nic za ta wartoscia.
+    void array_push(const Value& element);
+
+    // Slowniki. Zmiany w miejscu ('map_put', 'map_delete') - wspoldzielony slownik jest najpierw kopiowany.
+    MapObject& as_map() const;
+    void map_put(const Value& key, const Value& value);
+    bool map_erase(const Value& key);
+
+    // Znaki stringa do zmiany w miejscu ('set'). Jesli string jest wspoldzielony, najpierw go kopiujemy.
+    char* mutable_chars();
+
+    // Dokleja tekst na koniec stringa. Jesli nikt inny nie dokleil nic za ta wartoscia,
+    // dopisujemy w miejscu do wspolnego bufora, wiec petla 'acc + ch' jest liniowa, a nie kwadratowa.
+    void append(string_view tail);
+
+private:
+
+    static Value from_object(Object* obj, ValueType type) {
+        Value val;
+        val.tag = type | HEAP_BIT;
+        obj->refcount++;
+        memcpy(val.payload, &obj, sizeof(obj));
+        return val;
+    }
+    // Wartosc zapisujemy i kopiujemy zawsze dwoma slowami po 8 bajtow. Gdyby odczyt obejmowal kilka
+    // mniejszych zapisow (np. osobno dlugosc i znacznik), procesor musialby czekac, az trafia do pamieci.
+    void copy_bits(const Value& other) {
+        uint64_t low, high;
+        memcpy(&low, reinterpret_cast<const char*>(&other), sizeof(low));
+        memcpy(&high, reinterpret_cast<const char*>(&other) + 8, sizeof(high));
+        memcpy(reinterpret_cast<char*>(this), &low, sizeof(low));
+        memcpy(reinterpret_cast<char*>(this) + 8, &high, sizeof(high));
+    }
+    // Bajty [8..15] naraz: znacznik, zerowa dlugosc krotkiego stringa i puste miejsce po liczbie
+    void set_high_word(uint8_t new_tag) {
+        uint64_t word = (uint64_t)new_tag << 56;
+        memcpy(reinterpret_cast<char*>(this) + 8, &word, sizeof(word));
+    }
+    static Value from_buffer(StringObject* obj);
+    uint32_t heap_length() const {
+        uint32_t length;
+        memcpy(&length, payload + sizeof(Object*), sizeof(length));
+        return length;
+    }
+    void set_heap_length(size_t length);
+    // Tablica tylko dla tej wartosci (jedyny wlasciciel, bez cudzych elementow za koncem), gotowa do zmiany w miejscu
+    ArrayObject& own_array();
+    // To samo dla slownika
+    MapObject& own_map();
+    Object* object() const {
+        Object* obj;
+        memcpy(&obj, payload, sizeof(obj));
+        return obj;
+    }
+    // Kopie liczy --mem-stats. Tylko te z obiektem na stercie - kopia liczby czy krotkiego stringa
+    // to 16 bajtow bez alokacji, a sprawdzanie flagi przy kazdej kopii spowalnialo maszyne wirtualna.
+    void retain() const {
+        if (tag & HEAP_BIT) {
+            Object* obj = object();
+            if (obj->frozen) atomic_ref<uint32_t>(obj->refcount).fetch_add(1, memory_order_relaxed);
+            else obj->refcount++;
+            if (mem_stats_enabled) mem_value_copies.fetch_add(1, memory_order_relaxed);
+        }
+    }
+    void release() {
+        if (!(tag & HEAP_BIT)) return;
+        Object* obj = object();
+        if (obj->frozen ? atomic_ref<uint32_t>(obj->refcount).fetch_sub(1, memory_order_acq_rel) == 1 : --obj->refcount == 0) destroy(obj);
+    }
+    static void destroy(Object* obj);
+
+    alignas(8) char payload[SMALL_STRING_MAX];
+    uint8_t small_length;
+    uint8_t tag;
+};
+
+static_assert(sizeof(Value) == 16, "Value ma miec 16 bajtow");
+
+// Tablica na stercie. Tak jak StringObject jest buforem do doklejania: kazda wartosc pamieta swoja dlugosc,
+// wiec array_push dopisuje na koncu bufora w miejscu, a inne wartosci na tym samym buforze widza tylko swoj poczatek.
+// Dopoki w tablicy sa same liczby, trzymamy je bez znacznikow typu (numbers) - 8 bajtow na element w ciaglej
+// pamieci, po ktorej array_sum, array_min i array_max ida prostymi petlami. Pierwsza wartosc innego typu
+// przenosi wszystko do values.
+struct ArrayObject : Object {
+    bool packed = true;
+    vector<int64_t> numbers;   // packed
+    vector<Value> values;      // !packed
+
+    size_t size() const { return packed ? numbers.size() : values.size(); }
+    // Przejscie na values (np. przed zapisaniem stringa)
+    void unpack();
+};
+
+inline ArrayObject& Value::as_array() const { return *static_cast<ArrayObject*>(object()); }
+
+inline Value Value::array_at(size_t index) const {
+    const ArrayObject& array = as_array();
+    return array.packed ? number(array.numbers[index]) : array.values[index];
+}
+
+// Slownik na stercie: tablica z otwartym adresowaniem i liniowym probkowaniem.
+// Pary leza ciagiem w entries, w kolejnosci dodawania (map_keys daje zawsze ta sama kolejnosc).
+// slots to potega dwojki 8-bajtowych wpisow: gorne 32 bity skrotu klucza i numer pary, wiec szukanie idzie
+// po kolejnych slotach w tej samej linii pamieci i zaglada do pary dopiero, gdy zgadza sie skrot.
+// Usuniecie zostawia znacznik w slocie i pusta pare w entries - sprzata je nastepne przebudowanie.
+// Klucze to liczby albo stringi, porownywane razem z typem (5 i "5" to rozne klucze).
+struct MapObject : Object {
+    struct Entry {
+        Value key;      // TYPE_UNDEFINED: para usunieta
+        Value value;
+    };
+    static constexpr uint64_t TOMBSTONE = UINT64_MAX;
+
+    vector<Entry> entries;
+    vector<uint64_t> slots;  // 0: wolny, TOMBSTONE: usuniety, inaczej (skrot & 0xFFFFFFFF00000000) | (numer pary + 1)
+    size_t count = 0;        // ile par zyje
+
+    // Wartosc dla klucza albo nullptr
+    const Value* find(const Value& key) const;
+    void put(const Value& key, const Value& value);
+    bool erase(const Value& key);
+
+private:
+    size_t find_slot(const Value& key, uint64_t hash) const;
+    void rebuild();
+};
+
+inline MapObject& Value::as_map() const { return *static_cast<MapObject*>(object()); }
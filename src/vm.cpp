@@ -0,0 +1,573 @@
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "vm.hpp"
+#include "builtins.hpp"
+#include "jit.hpp"
+#include "profiler.hpp"
+#include "parallel.hpp"
+
+#include <stdexcept>
+
+// GCC i clang umieja skakac pod adres etykiety (&&etykieta), wtedy kazda instrukcja
+// skacze bezposrednio do nastepnej zamiast wracac do jednego switcha.
+#if defined(__GNUC__) || defined(__clang__)
+#define BRACKET_COMPUTED_GOTO 1
+#endif
+
+// Zapisany stan funkcji, ktora wywolala inna funkcje.
+// Sloty ramki leza na stosie wartosci, zaraz za wywolywana funkcja.
+struct CallFrame {
+    const Chunk* chunk;
+    uint32_t* ip;         // gdzie wrocic po zakonczeniu wywolania
+    size_t slots;         // pozycja pierwszego slotu ramki na stosie
+};
+
+[[noreturn]] static void throw_undefined(Symbol name) {
+    throw runtime_error("Undefined variable: '" + symbol_name(name) + "'.");
+}
+
+// Wybiera wersje operatora dla typow, ktore wlasnie zobaczylismy (albo zostawia ogolna)
+static uint32_t quickened(uint32_t op, const Value& left, const Value& right) {
+    if (left.type() == TYPE_NUMBER && right.type() == TYPE_NUMBER) return OP_ADD_NUM + (op - OP_ADD);
+    if (left.type() == TYPE_STRING) {
+        if (op == OP_ADD) return OP_ADD_STR;
+        if (op == OP_EQ && right.type() == TYPE_STRING) return OP_EQ_STR;
+        if (op == OP_NE && right.type() == TYPE_STRING) return OP_NE_STR;
+    }
+    return op;
+}
+
+// Operator bez podmieniania instrukcji - gdy kod jest wspoldzielony z zadaniami z pmap/spawn (parallel.hpp)
+static void apply_generic(uint32_t op, vector<Value>& stack) {
+    static const string texts[] = {"+", "-", "*", "/", "%", "==", "!=", ">", "<", ">=", "<="};
+    apply_infix(InfixOp(op - OP_ADD), texts[op - OP_ADD], stack[stack.size() - 2], stack.back());
+    stack.pop_back();
+}
+
+// Wykonuje kod 'entry'. Program glowny (global_env != nullptr) ma na stosie zmienne globalne od slotu 0,
+// a wywolanie funkcji z pmap/spawn ma w stack[0] funkcje, za nia argumenty i reszte jej ramki (slots == 1).
+static Value execute(const Chunk& entry, vector<Value>& stack, size_t slots, Environment* global_env) {
+    vector<CallFrame> frames;
+
+    // Stan aktualnej funkcji trzymamy w zmiennych lokalnych, zeby kompilator trzymal je w rejestrach
+    const Chunk* chunk = &entry;
+    uint32_t* ip = entry.code.data();
+
+    // Profiler widzi tylko program glowny (czas zadan idzie na pmap i join), a JIT-a nie ma w zadaniach
+    // na watkach roboczych - jego liczniki i kod sa w Chunk, ktory czytaja wszystkie watki
+    const bool profiling = profile_enabled && global_env;
+    const bool jit = jit_enabled && (!threads_started || !in_task);
+
+    // Domkniecie aktualnej funkcji - sama funkcja lezy na stosie tuz przed swoimi slotami
+    auto closure = [&]() -> const BraceFunction& { return stack[slots - 1].as_function(); };
+
+    // --jit: liczy wejscia do petli albo funkcji, po przekroczeniu progu kompiluje ja do kodu maszynowego
+    // i od tej pory wykonuje ten kod, az trafi na cos, czego nie obsluguje - wtedy interpreter jedzie dalej od tego miejsca
+    auto enter_jit = [&](JitProfile& profile) {
+        uint32_t depth = stack.size() - slots;
+        if (!profile.code) {
+            // Zamrozony kod moze wykonywac naraz kilka watkow - liczniki i kod JIT-a sa w nim, wiec go nie ruszamy
+            if (chunk->frozen || profile.failed || ++profile.counter < BRACKET_JIT_THRESHOLD) return;
+            profile.code = jit_compile(*chunk, profile.start, profile.end, depth);
+            if (!profile.code) { profile.failed = true; return; }
+        }
+        const JitCode& code = *profile.code;
+        if (jit_entry_depth(code) != depth) return;
+        stack.resize(slots + jit_max_depth(code));
+        JitExit exit = jit_run(code, stack.data() + slots, slots == 0 ? nullptr : closure().captures.data());
+        stack.resize(slots + exit.depth);
+        ip = chunk->code.data() + exit.resume;
+    };
+
+    // --profile: gdy watek profilera przestawil zegar, czas od poprzedniego razu idzie na aktualny stos
+    auto profile = [&](ProfileBuiltin builtin) {
+        if (!profile_due()) return;
+        vector<ProfileFrame> path;
+        size_t first = frames.size() > BRACKET_PROFILE_MAX_FRAMES ? frames.size() - BRACKET_PROFILE_MAX_FRAMES : 0;
+        path.reserve(frames.size() - first + 1);
+        for (size_t i = first; i < frames.size(); ++i) {
+            path.push_back(ProfileFrame{frames[i].chunk, uint32_t(frames[i].ip - frames[i].chunk->code.data())});
+        }
+        path.push_back(ProfileFrame{chunk, uint32_t(ip - chunk->code.data())});
+        profile_sample(path, builtin);
+    };
+
+#ifdef BRACKET_COMPUTED_GOTO
+    static void* dispatch_table[] = {
+#define BRACKET_OPCODE_LABEL(name) &&do_##name,
+        BRACKET_OPCODES(BRACKET_OPCODE_LABEL)
+#undef BRACKET_OPCODE_LABEL
+    };
+// Uwaga: skok pod adres etykiety nie wywoluje destruktorow zmiennych lokalnych,
+// wiec instrukcje nie moga trzymac w zmiennych niczego z destruktorem (np. Value) - pracuja na stosie.
+#define CASE(name) do_##name:
+#define DISPATCH() goto *dispatch_table[*ip++]
+    DISPATCH();
+#else
+#define CASE(name) case name:
+#define DISPATCH() continue
+    for (;;) switch (*ip++) {
+#endif
+
+    CASE(OP_CONST) {
+        stack.push_back(chunk->constants[*ip++]);
+        DISPATCH();
+    }
+    CASE(OP_NIL) {
+        stack.push_back(Value{});
+        DISPATCH();
+    }
+    CASE(OP_POP) {
+        stack.pop_back();
+        DISPATCH();
+    }
+    CASE(OP_LOAD_LOCAL) {
+        uint32_t slot = *ip++;
+        if (stack[slots + slot].type() == TYPE_UNDEFINED) throw_undefined(chunk->locals[slot]);
+        stack.push_back(stack[slots + slot]);
+        DISPATCH();
+    }
+    CASE(OP_LOAD_CAPTURE) {
+        uint32_t index = *ip++;
+        const Value& val = closure().captures[index];
+        if (val.type() == TYPE_UNDEFINED) throw_undefined(chunk->captures[index]);
+        stack.push_back(val);
+        DISPATCH();
+    }
+    CASE(OP_DEF_LOCAL) {
+        stack[slots + *ip++] = stack.back();
+        DISPATCH();
+    }
+    CASE(OP_SET_LOCAL) {
+        Value& target = stack[slots + *ip++];
+        if (target.type() != TYPE_STRING && target.type() != TYPE_ARRAY) throw runtime_error("Type error: Variable for 'set' must exist and be a string or array.");
+        size_t top = stack.size();
+        builtin_set(target, stack[top - 2], stack[top - 1]);
+        stack.resize(top - 2);
+        stack.push_back(target);
+        DISPATCH();
+    }
+    CASE(OP_MAP_PUT_LOCAL) {
+        Value& target = stack[slots + *ip++];
+        size_t top = stack.size();
+        builtin_map_put_into(target, move(stack[top - 3]), stack[top - 2], stack[top - 1]);
+        stack.resize(top - 3);
+        stack.push_back(target);
+        DISPATCH();
+    }
+    CASE(OP_MAP_DELETE_LOCAL) {
+        Value& target = stack[slots + *ip++];
+        size_t top = stack.size();
+        builtin_map_delete_into(target, move(stack[top - 2]), stack[top - 1]);
+        stack.resize(top - 2);
+        stack.push_back(target);
+        DISPATCH();
+    }
+    CASE(OP_JUMP) {
+        ip = chunk->code.data() + *ip;
+        DISPATCH();
+    }
+    CASE(OP_LOOP) {
+        // Skok na poczatek petli - tu JIT liczy obroty
+        uint32_t target = *ip++;
+        JitProfile& loop = chunk->loops[*ip++];
+        ip = chunk->code.data() + target;
+        if (profiling) {
+            ++loop.profile_count;
+            profile(PROFILE_NO_BUILTIN);
+        }
+        if (jit) enter_jit(loop);
+        DISPATCH();
+    }
+    CASE(OP_JUMP_IF_FALSE) {
+        uint32_t target = *ip++;
+        if (!is_truthy(stack.back())) ip = chunk->code.data() + target;
+        stack.pop_back();
+        DISPATCH();
+    }
+    CASE(OP_MAKE_FUN) {
+        const shared_ptr<Chunk>& body = chunk->functions[*ip++];
+        // Zamiast kopiowac cale srodowisko, kopiujemy tylko wartosci, ktorych funkcja uzywa
+        BraceFunction* func = new BraceFunction();
+        func->code = body;
+        func->captures.reserve(body->capture_from.size());
+        for (const CaptureSource& source : body->capture_from) {
+            func->captures.push_back(source.from_local ? stack[slots + source.index] : closure().captures[source.index]);
+        }
+        stack.push_back(Value::function(func));
+        DISPATCH();
+    }
+    CASE(OP_CALL_OR_JUMP) {
+        uint32_t arg_count = *ip++;
+        uint32_t infix_target = *ip++;
+        const Value& head = stack.back();
+        if (head.type() != TYPE_FUNCTION) {
+            ip = chunk->code.data() + infix_target;
+            DISPATCH();
+        }
+        uint32_t expected = head.as_function().code->parameter_count;
+        if (expected != arg_count) throw runtime_error("Incorrect number of arguments for function call. Expected " + to_string(expected) + ", but got " + to_string(arg_count) + ".");
+        DISPATCH();
+    }
+    // Wejscie do funkcji lezacej na stosie tuz przed slotem 'slots'. Argumenty juz leza na stosie -
+    // to sa pierwsze sloty nowej ramki. Reszta slotow startuje z wartosciami z domkniecia albo jako puste.
+#define BRACKET_ENTER_FUNCTION() \
+    chunk = closure().code.get(); \
+    ip = chunk->code.data(); \
+    for (int32_t init : chunk->local_init) { \
+        if (init < 0) stack.push_back(Value::undefined()); \
+        else stack.push_back(closure().captures[init]); \
+    }
+    CASE(OP_CALL) {
+        uint32_t arg_count = *ip++;
+        if (frames.size() >= max_call_depth) throw_stack_overflow();
+        if (profiling) profile(PROFILE_NO_BUILTIN);
+        frames.push_back(CallFrame{chunk, ip, slots});
+        slots = stack.size() - arg_count;
+        BRACKET_ENTER_FUNCTION()
+        if (profiling) ++chunk->body_profile.profile_count;
+        if (jit) enter_jit(chunk->body_profile);
+        DISPATCH();
+    }
+    CASE(OP_TAIL_CALL) {
+        // Aktualna funkcja i tak by tylko zwrocila wynik, wiec wywolywana funkcja z argumentami
+        // zajmuje jej miejsce na stosie, a stos ramek nie rosnie
+        uint32_t arg_count = *ip++;
+        if (profiling) profile(PROFILE_NO_BUILTIN);
+        size_t base = stack.size() - arg_count - 1;
+        for (size_t i = 0; i <= arg_count; ++i) stack[slots - 1 + i] = std::move(stack[base + i]);
+        stack.resize(slots + arg_count);
+        BRACKET_ENTER_FUNCTION()
+        if (profiling) ++chunk->body_profile.profile_count;
+        if (jit) enter_jit(chunk->body_profile);
+        DISPATCH();
+    }
+#undef BRACKET_ENTER_FUNCTION
+    CASE(OP_RETURN) {
+        if (profiling) profile(PROFILE_NO_BUILTIN);
+        if (frames.empty()) {
+            // Koniec programu - oddajemy zmienne globalne do srodowiska (albo koniec funkcji z pmap/spawn)
+            if (global_env) {
+                for (size_t i = 0; i < entry.locals.size(); ++i) {
+                    if (stack[i].type() != TYPE_UNDEFINED) (*global_env)[entry.locals[i]] = std::move(stack[i]);
+                }
+            }
+            return std::move(stack.back());
+        }
+
+        // Wynik laduje w miejscu wywolanej funkcji, reszta ramki znika
+        stack[slots - 1] = std::move(stack.back());
+        stack.resize(slots);
+
+        const CallFrame& caller = frames.back();
+        chunk = caller.chunk;
+        ip = caller.ip;
+        slots = caller.slots;
+        frames.pop_back();
+        DISPATCH();
+    }
+
+    // Operatory infiksowe. Tekst operatora jest potrzebny tylko do komunikatu o zlych typach.
+    // Przy okazji instrukcja jest podmieniana na wersje dla typow, ktore tu wlasnie przyszly -
+    // w petli za drugim razem trafimy juz prosto do szybkiej wersji ponizej.
+#define BRACKET_INFIX_CASE(name, op, text) \
+    CASE(name) { \
+        static const string op_text = text; \
+        if (code_writable(*chunk)) ip[-1] = quickened(name, stack[stack.size() - 2], stack.back()); \
+        apply_infix(op, op_text, stack[stack.size() - 2], stack.back()); \
+        stack.pop_back(); \
+        DISPATCH(); \
+    }
+    BRACKET_INFIX_CASE(OP_ADD, INFIX_ADD, "+")
+    BRACKET_INFIX_CASE(OP_SUB, INFIX_SUB, "-")
+    BRACKET_INFIX_CASE(OP_MUL, INFIX_MUL, "*")
+    BRACKET_INFIX_CASE(OP_DIV, INFIX_DIV, "/")
+    BRACKET_INFIX_CASE(OP_MOD, INFIX_MOD, "%")
+    BRACKET_INFIX_CASE(OP_EQ, INFIX_EQ, "==")
+    BRACKET_INFIX_CASE(OP_NE, INFIX_NE, "!=")
+    BRACKET_INFIX_CASE(OP_GT, INFIX_GT, ">")
+    BRACKET_INFIX_CASE(OP_LT, INFIX_LT, "<")
+    BRACKET_INFIX_CASE(OP_GE, INFIX_GE, ">=")
+    BRACKET_INFIX_CASE(OP_LE, INFIX_LE, "<=")
+#undef BRACKET_INFIX_CASE
+
+    // Wyspecjalizowane operatory. Jesli typy nie pasuja (albo trzeba rzucic blad, np. dzielenie przez zero),
+    // wracamy do ogolnej instrukcji i wykonujemy ja jeszcze raz od poczatku.
+#define BRACKET_DEOPTIMIZE(generic) { \
+        if (!code_writable(*chunk)) { apply_generic(generic, stack); DISPATCH(); } \
+        ip[-1] = generic; --ip; DISPATCH(); \
+    }
+#define BRACKET_NUMBER_CASE(name, generic, valid, expr) \
+    CASE(name) { \
+        Value& left = stack[stack.size() - 2]; \
+        const Value& right = stack.back(); \
+        if (left.type() != TYPE_NUMBER || right.type() != TYPE_NUMBER) BRACKET_DEOPTIMIZE(generic) \
+        int_fast64_t a = left.as_number(), b = right.as_number(); \
+        if (!(valid)) BRACKET_DEOPTIMIZE(generic) \
+        left.set_number(expr); \
+        stack.pop_back(); \
+        DISPATCH(); \
+    }
+    BRACKET_NUMBER_CASE(OP_ADD_NUM, OP_ADD, true, a + b)
+    BRACKET_NUMBER_CASE(OP_SUB_NUM, OP_SUB, true, a - b)
+    BRACKET_NUMBER_CASE(OP_MUL_NUM, OP_MUL, true, a * b)
+    BRACKET_NUMBER_CASE(OP_DIV_NUM, OP_DIV, b != 0, a / b)
+    BRACKET_NUMBER_CASE(OP_MOD_NUM, OP_MOD, b != 0, a % b)
+    BRACKET_NUMBER_CASE(OP_EQ_NUM, OP_EQ, true, a == b)
+    BRACKET_NUMBER_CASE(OP_NE_NUM, OP_NE, true, a != b)
+    BRACKET_NUMBER_CASE(OP_GT_NUM, OP_GT, true, a > b)
+    BRACKET_NUMBER_CASE(OP_LT_NUM, OP_LT, true, a < b)
+    BRACKET_NUMBER_CASE(OP_GE_NUM, OP_GE, true, a >= b)
+    BRACKET_NUMBER_CASE(OP_LE_NUM, OP_LE, true, a <= b)
+#undef BRACKET_NUMBER_CASE
+
+    CASE(OP_ADD_STR) {
+        Value& left = stack[stack.size() - 2];
+        const Value& right = stack.back();
+        if (left.type() != TYPE_STRING) BRACKET_DEOPTIMIZE(OP_ADD)
+        static const string op_text = "+";
+        if (right.type() == TYPE_STRING) left.append(right.as_string());
+        else apply_infix(INFIX_ADD, op_text, left, right);
+        stack.pop_back();
+        DISPATCH();
+    }
+    CASE(OP_EQ_STR) {
+        Value& left = stack[stack.size() - 2];
+        const Value& right = stack.back();
+        if (left.type() != TYPE_STRING || right.type() != TYPE_STRING) BRACKET_DEOPTIMIZE(OP_EQ)
+        left.set_number(left.as_string() == right.as_string());
+        stack.pop_back();
+        DISPATCH();
+    }
+    CASE(OP_NE_STR) {
+        Value& left = stack[stack.size() - 2];
+        const Value& right = stack.back();
+        if (left.type() != TYPE_STRING || right.type() != TYPE_STRING) BRACKET_DEOPTIMIZE(OP_NE)
+        left.set_number(left.as_string() != right.as_string());
+        stack.pop_back();
+        DISPATCH();
+    }
+#undef BRACKET_DEOPTIMIZE
+
+    CASE(OP_UNKNOWN_OP) {
+        const string& op_text = chunk->names[*ip++];
+        apply_infix(INFIX_UNKNOWN, op_text, stack[stack.size() - 2], stack.back());
+        stack.pop_back();
+        DISPATCH();
+    }
+
+    // --profile: czas przed funkcja wbudowana idzie na miejsce wywolania, a czas w niej - na nia sama
+#define BRACKET_PROFILED(builtin, call) \
+    if (profiling) { \
+        profile(PROFILE_NO_BUILTIN); \
+        ++profile_builtin_calls[builtin]; \
+        call; \
+        profile(builtin); \
+    } else { \
+        call; \
+    }
+    CASE(OP_PRINT) {
+        uint32_t count = *ip++;
+        BRACKET_PROFILED(PROFILE_PRINT, builtin_print(stack.data() + stack.size() - count, count))
+        stack.resize(stack.size() - count);
+        stack.push_back(Value{});
+        DISPATCH();
+    }
+    CASE(OP_INPUT) {
+        if (*ip++ == 1) {
+            BRACKET_PROFILED(PROFILE_INPUT, stack.back() = builtin_input(&stack.back()))
+        } else {
+            BRACKET_PROFILED(PROFILE_INPUT, stack.push_back(builtin_input(nullptr)))
+        }
+        DISPATCH();
+    }
+    CASE(OP_NUMBER) { stack.back() = builtin_number(stack.back()); DISPATCH(); }
+    CASE(OP_STRING) { stack.back() = builtin_string(stack.back()); DISPATCH(); }
+    CASE(OP_TYPEOF) { stack.back() = builtin_typeof(stack.back()); DISPATCH(); }
+    CASE(OP_LEN) { stack.back() = builtin_len(stack.back()); DISPATCH(); }
+    CASE(OP_SYS) {
+        BRACKET_PROFILED(PROFILE_SYS, stack.back() = builtin_sys(stack.back()))
+        DISPATCH();
+    }
+    CASE(OP_ORD) { stack.back() = builtin_ord(stack.back()); DISPATCH(); }
+    CASE(OP_CHR) { stack.back() = builtin_chr(stack.back()); DISPATCH(); }
+    CASE(OP_GET) {
+        size_t top = stack.size();
+        stack[top - 2] = builtin_get(stack[top - 2], stack[top - 1]);
+        stack.pop_back();
+        DISPATCH();
+    }
+    CASE(OP_FILE_READ) {
+        BRACKET_PROFILED(PROFILE_FILE_READ, stack.back() = builtin_file_read(stack.back()))
+        DISPATCH();
+    }
+    CASE(OP_FILE_WRITE) {
+        size_t top = stack.size();
+        BRACKET_PROFILED(PROFILE_FILE_WRITE, stack[top - 2] = builtin_file_write(stack[top - 2], stack[top - 1]))
+        stack.pop_back();
+        DISPATCH();
+    }
+    CASE(OP_FILE_OPEN) { stack.back() = builtin_file_open(stack.back()); DISPATCH(); }
+    CASE(OP_FILE_LINE) {
+        BRACKET_PROFILED(PROFILE_FILE_LINE, stack.back() = builtin_file_line(stack.back()))
+        DISPATCH();
+    }
+    CASE(OP_FILE_EOF) { stack.back() = builtin_file_eof(stack.back()); DISPATCH(); }
+    CASE(OP_FILE_CLOSE) { stack.back() = builtin_file_close(stack.back()); DISPATCH(); }
+    CASE(OP_SYS_ASYNC) { stack.back() = builtin_sys_async(stack.back()); DISPATCH(); }
+    // await, sys_status i sys_stderr czekaja na komende - w profilu to wszystko "await"
+    CASE(OP_AWAIT) {
+        BRACKET_PROFILED(PROFILE_AWAIT, stack.back() = builtin_await(stack.back()))
+        DISPATCH();
+    }
+    CASE(OP_SYS_STATUS) {
+        BRACKET_PROFILED(PROFILE_AWAIT, stack.back() = builtin_sys_status(stack.back()))
+        DISPATCH();
+    }
+    CASE(OP_SYS_STDERR) {
+        BRACKET_PROFILED(PROFILE_AWAIT, stack.back() = builtin_sys_stderr(stack.back()))
+        DISPATCH();
+    }
+    CASE(OP_PMAP) {
+        size_t top = stack.size();
+        BRACKET_PROFILED(PROFILE_PMAP, stack[top - 2] = builtin_pmap(stack[top - 2], stack[top - 1]))
+        stack.pop_back();
+        DISPATCH();
+    }
+    CASE(OP_SPAWN) {
+        uint32_t count = *ip++;
+        size_t first = stack.size() - count;
+        stack[first] = builtin_spawn(stack.data() + first, count);
+        stack.resize(first + 1);
+        DISPATCH();
+    }
+    CASE(OP_JOIN) {
+        BRACKET_PROFILED(PROFILE_JOIN, stack.back() = builtin_join(stack.back()))
+        DISPATCH();
+    }
+#undef BRACKET_PROFILED
+    CASE(OP_ARRAY) {
+        uint32_t count = *ip++;
+        size_t first = stack.size() - count;
+        if (count == 0) stack.push_back(builtin_array(nullptr, 0));
+        else stack[first] = builtin_array(stack.data() + first, count);
+        stack.resize(first + 1);
+        DISPATCH();
+    }
+    CASE(OP_ARRAY_PUSH) {
+        size_t top = stack.size();
+        stack[top - 2] = builtin_array_push(stack[top - 2], stack[top - 1]);
+        stack.pop_back();
+        DISPATCH();
+    }
+    CASE(OP_ARRAY_SLICE) {
+        size_t top = stack.size();
+        stack[top - 3] = builtin_array_slice(stack[top - 3], stack[top - 2], stack[top - 1]);
+        stack.resize(top - 2);
+        DISPATCH();
+    }
+    CASE(OP_ARRAY_SUM) { stack.back() = builtin_array_sum(stack.back()); DISPATCH(); }
+    CASE(OP_ARRAY_MIN) { stack.back() = builtin_array_min(stack.back()); DISPATCH(); }
+    CASE(OP_ARRAY_MAX) { stack.back() = builtin_array_max(stack.back()); DISPATCH(); }
+    CASE(OP_ARRAY_FILL) {
+        size_t top = stack.size();
+        stack[top - 2] = builtin_array_fill(stack[top - 2], stack[top - 1]);
+        stack.pop_back();
+        DISPATCH();
+    }
+    CASE(OP_ARRAY_MAP) {
+        size_t top = stack.size();
+        stack[top - 2] = builtin_array_map(stack[top - 2], stack[top - 1]);
+        stack.pop_back();
+        DISPATCH();
+    }
+    CASE(OP_MAP) {
+        uint32_t count = *ip++;
+        size_t first = stack.size() - count;
+        if (count == 0) stack.push_back(builtin_map(nullptr, 0));
+        else stack[first] = builtin_map(stack.data() + first, count);
+        stack.resize(first + 1);
+        DISPATCH();
+    }
+    CASE(OP_MAP_PUT) {
+        size_t top = stack.size();
+        stack[top - 3] = builtin_map_put(stack[top - 3], stack[top - 2], stack[top - 1]);
+        stack.resize(top - 2);
+        DISPATCH();
+    }
+    CASE(OP_MAP_DELETE) {
+        size_t top = stack.size();
+        stack[top - 2] = builtin_map_delete(stack[top - 2], stack[top - 1]);
+        stack.pop_back();
+        DISPATCH();
+    }
+    CASE(OP_MAP_GET) {
+        size_t top = stack.size();
+        stack[top - 2] = builtin_map_get(stack[top - 2], stack[top - 1]);
+        stack.pop_back();
+        DISPATCH();
+    }
+    CASE(OP_MAP_HAS) {
+        size_t top = stack.size();
+        stack[top - 2] = builtin_map_has(stack[top - 2], stack[top - 1]);
+        stack.pop_back();
+        DISPATCH();
+    }
+    CASE(OP_MAP_KEYS) { stack.back() = builtin_map_keys(stack.back()); DISPATCH(); }
+    CASE(OP_MAP_SIZE) { stack.back() = builtin_map_size(stack.back()); DISPATCH(); }
+    CASE(OP_RANDOM) {
+        size_t top = stack.size();
+        stack[top - 2] = builtin_random(stack[top - 2], stack[top - 1]);
+        stack.pop_back();
+        DISPATCH();
+    }
+    CASE(OP_NATIVE) {
+        stack.push_back(chunk->native(stack.data() + slots, chunk->parameter_count));
+        DISPATCH();
+    }
+    CASE(OP_THROW) {
+        throw runtime_error(string(chunk->constants[*ip].as_string()));
+    }
+
+#ifndef BRACKET_COMPUTED_GOTO
+        default: throw runtime_error("Critical error: Unknown instruction.");
+    }
+#endif
+#undef CASE
+#undef DISPATCH
+}
+
+Value run(const Chunk& program, Environment& global_env) {
+    // Ramka programu glownego to zmienne globalne. Startuja z wartosciami ze srodowiska (jesli sa).
+    vector<Value> stack;
+    for (Symbol name : program.locals) {
+        auto it = global_env.find(name);
+        stack.push_back(it != global_env.end() ? it->second : Value::undefined());
+    }
+    return execute(program, stack, 0, &global_env);
+}
+
+Value run_function(const Value& function, const Value* args, size_t count) {
+    const BraceFunction& func = function.as_function();
+    const Chunk& body = *func.code;
+    if (body.parameter_count != count) throw runtime_error("Incorrect number of arguments for function call. Expected " + to_string(body.parameter_count) + ", but got " + to_string(count) + ".");
+    vector<Value> stack;
+    stack.reserve(1 + count + body.local_init.size());
+    stack.push_back(function);
+    stack.insert(stack.end(), args, args + count);
+    for (int32_t init : body.local_init) stack.push_back(init < 0 ? Value::undefined() : func.captures[init]);
+    return execute(body, stack, 1, nullptr);
+}
@@ -0,0 +1,25 @@
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include "types.hpp"
+#include "compiler.hpp"
+
+// Deklaracja maszyny wirtualnej.
+// Wykonuje skompilowany program w podanym srodowisku i zwraca wartosc ostatniego wyrazenia.
+Value run(const Chunk& program, Environment& env);
+
+// Wywolanie funkcji z programu spoza maszyny wirtualnej (call_function dla pmap i spawn)
+Value run_function(const Value& function, const Value* args, size_t count);
@@ -0,0 +1,57 @@
+# Uruchamia PROGRAM z ARGS (argumenty rozdzielone spacjami) i porownuje standardowe wyjscie oraz kod wyjscia:
+#   EXPECTED        - plik z oczekiwanym wyjsciem (kod wyjscia EXIT_CODE, domyslnie 0)
+#   REFERENCE_ARGS  - albo drugie uruchomienie (REFERENCE_PROGRAM, domyslnie ten sam program), ktore ma dac to samo
+#   ERROR_REGEX     - wyrazenie, ktore musi pasowac do standardowego wyjscia bledow (pierwszego uruchomienia)
+#   INPUT           - plik podawany na standardowe wejscie (obu uruchomien)
+#   WORKING_DIR     - katalog, w ktorym dzialaja programy
+# Uzycie w ctest: cmake -DPROGRAM=... -DARGS="..." -DEXPECTED=... -P check_output.cmake
+if (NOT WORKING_DIR)
+    set(WORKING_DIR ${CMAKE_CURRENT_BINARY_DIR})
+endif()
+
+function(run_program program args out_var code_var err_var)
+    separate_arguments(arg_list UNIX_COMMAND "${args}")
+    set(input_option)
+    if (INPUT)
+        set(input_option INPUT_FILE ${INPUT})
+    endif()
+    execute_process(COMMAND ${program} ${arg_list}
+            WORKING_DIRECTORY ${WORKING_DIR}
+            ${input_option}
+            OUTPUT_VARIABLE out
+            ERROR_VARIABLE err
+            RESULT_VARIABLE code)
+    set(${out_var} "${out}" PARENT_SCOPE)
+    set(${code_var} "${code}" PARENT_SCOPE)
+    set(${err_var} "${err}" PARENT_SCOPE)
+    if (err)
+        message("stderr of ${program} ${args}:\n${err}")
+    endif()
+endfunction()
+
+run_program(${PROGRAM} "${ARGS}" actual actual_code actual_err)
+
+if (DEFINED REFERENCE_ARGS)
+    if (NOT REFERENCE_PROGRAM)
+        set(REFERENCE_PROGRAM ${PROGRAM})
+    endif()
+    run_program(${REFERENCE_PROGRAM} "${REFERENCE_ARGS}" expected expected_code expected_err)
+    set(what "${REFERENCE_PROGRAM} ${REFERENCE_ARGS}")
+else()
+    file(READ ${EXPECTED} expected)
+    set(expected_code 0)
+    if (DEFINED EXIT_CODE)
+        set(expected_code ${EXIT_CODE})
+    endif()
+    set(what "${EXPECTED}")
+endif()
+
+if (NOT actual_code STREQUAL expected_code)
+    message(FATAL_ERROR "${PROGRAM} ${ARGS}: exit code ${actual_code}, expected ${expected_code} (${what})")
+endif()
+if (DEFINED ERROR_REGEX AND NOT actual_err MATCHES "${ERROR_REGEX}")
+    message(FATAL_ERROR "${PROGRAM} ${ARGS}: standard error does not match '${ERROR_REGEX}'")
+endif()
+if (NOT actual STREQUAL expected)
+    message(FATAL_ERROR "${PROGRAM} ${ARGS}: output differs from ${what}\n--- expected\n${expected}\n--- actual\n${actual}")
+endif()
@@ -0,0 +1,94 @@
+/**
+ * Copyright 2025 KamilMalicki
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+// libbracket w kilku watkach naraz: kazdy watek ma swoj kontekst, wszystkie wykonuja ten sam program
+// i pisza na wspolne wyjscie, a pierwsze pmap i spawn moga wystartowac pule w kilku watkach jednoczesnie.
+// Wypisuje "ok" albo to, co sie nie zgadza, i konczy sie kodem 1.
+#include "bracket.hpp"
+#include "io.hpp"
+#include "parallel.hpp"
+
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+static constexpr int THREADS = 4;
+static constexpr int PRINTS = 5000;
+
+int main() {
+    thread_count = 4;
+    BracketProgram program = bracket_compile(
+        "(def i 0)"
+        "(loop (i < count) (do (print id \" \" i \"\\n\") (def i (i + 1))))"
+        "(def double (fun (x) ((Number x) * 2)))"
+        "(def doubled (pmap double \"1\\n2\\n3\\n4\\n5\\n6\\n7\\n8\\n\"))"
+        "(def task (spawn (fun (n) (n + id)) 1000))"
+        "(def joined (join task))");
+
+    ostringstream out;
+    output_stream = &out;
+    vector<string> errors(THREADS);
+    vector<thread> threads;
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&, t] {
+            try {
+                BracketContext context;
+                context.set("id", Value::number(t));
+                context.set("count", Value::number(PRINTS));
+                context.run(program);
+                if (value_to_string(context.get("doubled")) != "2\n4\n6\n8\n10\n12\n14\n16\n") errors[t] = "pmap: '" + value_to_string(context.get("doubled")) + "'";
+                if (context.get("joined").as_number() != 1000 + t) errors[t] = "wrong join result";
+
+                // Z 'output' wyjscie kontekstu trafia tylko do jego stringa
+                string captured;
+                context.set("count", Value::number(3));
+                context.run(program, &captured);
+                string expected = to_string(t) + " 0\n" + to_string(t) + " 1\n" + to_string(t) + " 2\n";
+                if (captured != expected) errors[t] = "captured output: '" + captured + "'";
+            } catch (const exception& e) {
+                errors[t] = e.what();
+            }
+        });
+    }
+    for (thread& worker : threads) worker.join();
+    output_flush();
+    output_stream = nullptr;
+
+    // Kazda linia w calosci i kazda dokladnie raz, w kolejnosci swojego watku
+    vector<int> next(THREADS, 0);
+    istringstream lines(out.str());
+    string line;
+    size_t count = 0;
+    while (getline(lines, line)) {
+        int id = -1, i = -1;
+        if (sscanf(line.c_str(), "%d %d", &id, &i) != 2 || id < 0 || id >= THREADS || i != next[id]) {
+            cout << "bad line: '" << line << "'" << endl;
+            return 1;
+        }
+        next[id]++;
+        count++;
+    }
+    bool failed = count != (size_t)THREADS * PRINTS;
+    if (failed) cout << "lines: " << count << ", expected " << THREADS * PRINTS << endl;
+    for (int t = 0; t < THREADS; ++t) {
+        if (!errors[t].empty()) {
+            cout << "thread " << t << ": " << errors[t] << endl;
+            failed = true;
+        }
+    }
+    if (failed) return 1;
+    cout << "ok" << endl;
+    return 0;
+}
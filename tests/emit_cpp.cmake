@@ -0,0 +1,12 @@
+# Zapisuje wynik "PROGRAM --emit-cpp SOURCE" do pliku OUTPUT. Gdy tlumaczenie sie nie uda, pliku nie ma.
+get_filename_component(output_dir ${OUTPUT} DIRECTORY)
+file(MAKE_DIRECTORY ${output_dir})
+execute_process(COMMAND ${PROGRAM} --emit-cpp ${SOURCE}
+        OUTPUT_FILE ${OUTPUT}.tmp
+        ERROR_VARIABLE err
+        RESULT_VARIABLE code)
+if (NOT code EQUAL 0)
+    file(REMOVE ${OUTPUT}.tmp)
+    message(FATAL_ERROR "${PROGRAM} --emit-cpp ${SOURCE} failed (${code}):\n${err}")
+endif()
+file(RENAME ${OUTPUT}.tmp ${OUTPUT})